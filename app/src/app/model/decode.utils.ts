@@ -18,6 +18,9 @@ import {
 import {ALEXA_MAX_DEVICE_NAME_LENGTH, AlexaIntegrationSettings} from './alexa-integration-settings.model';
 import {HttpCredentials, MAX_HTTP_PASSWORD_LENGTH, MAX_HTTP_USERNAME_LENGTH} from '../http-credentials.model';
 import {
+  LOOP_PROFILE_SECTION_NAME_BYTE_SIZE,
+  LoopProfileSection,
+  WEB_SOCKET_BATCH_LENGTH_BYTE_SIZE,
   WEB_SOCKET_MESSAGE_TYPE_BYTE_SIZE,
   WebSocketAlexaIntegrationSettingsMessage,
   WebSocketBleStatusMessage,
@@ -27,6 +30,7 @@ import {
   WebSocketEspNowDevicesMessage,
   WebSocketFirmwareVersionMessage,
   WebSocketHeapInfoMessage,
+  WebSocketLoopProfileMessage,
   WebSocketMessageType,
   WebSocketOtaProgressMessage,
   WebSocketWiFiDetailsMessage,
@@ -34,7 +38,13 @@ import {
 } from './websocket-message.model';
 import {LightState} from './light.model';
 import {OUTPUT_STATE_BYTE_SIZE, OutputState} from './output.model';
-import {ESP_NOW_DEVICE_LENGTH, ESP_NOW_DEVICE_NAME_TOTAL_LENGTH, EspNowDevice} from './esp-now.model';
+import {
+  ESP_NOW_DEVICE_LENGTH,
+  ESP_NOW_DEVICE_NAME_TOTAL_LENGTH,
+  ESP_NOW_DEVICES_PAGE_HEADER_LENGTH,
+  EspNowDevice,
+  EspNowDevicePage
+} from './esp-now.model';
 
 export const textDecoder = new TextDecoder('utf-8');
 
@@ -68,6 +78,12 @@ export class BufferReader {
     return this.buffer[this.offset++];
   }
 
+  readUint16(): number {
+    const value = this.buffer[this.offset] | (this.buffer[this.offset + 1] << 8);
+    this.offset += 2;
+    return value;
+  }
+
   readUint32(): number {
     const value =
       this.buffer[this.offset] |
@@ -87,6 +103,10 @@ export class BufferReader {
   readCString(length: number): string {
     return decodeCString(this.readBytes(length));
   }
+
+  remaining(): number {
+    return this.buffer.length - this.offset;
+  }
 }
 
 export function decodeWiFiStatus(buffer: Uint8Array) {
@@ -190,16 +210,16 @@ export function decodeEspNowController(data: Uint8Array) {
   return {address};
 }
 
-export function decodeEspNowDevice(data: Uint8Array): EspNowDevice[] {
-  const count = data[0];
+export function decodeEspNowDevicePage(data: Uint8Array): EspNowDevicePage {
+  const [total, start, count] = data;
   const espNowDevices = new Array<EspNowDevice>(count);
   for (let i = 0; i < count; i++) {
-    const offset = 1 + i * ESP_NOW_DEVICE_LENGTH;
+    const offset = ESP_NOW_DEVICES_PAGE_HEADER_LENGTH + i * ESP_NOW_DEVICE_LENGTH;
     const name = decodeCString(data.subarray(offset, offset + ESP_NOW_DEVICE_NAME_TOTAL_LENGTH));
     const address = macBytesToString(data.subarray(offset + ESP_NOW_DEVICE_NAME_TOTAL_LENGTH, offset + ESP_NOW_DEVICE_LENGTH));
     espNowDevices[i] = {name, address};
   }
-  return espNowDevices;
+  return {total, start, devices: espNowDevices};
 }
 
 export function decodeDeviceNameMessage(buffer: ArrayBuffer): WebSocketDeviceNameMessage {
@@ -256,12 +276,30 @@ export function decodeWebSocketHeapInfoMessage(buffer: ArrayBuffer): WebSocketHe
   };
 }
 
+export function decodeWebSocketLoopProfileMessage(buffer: ArrayBuffer): WebSocketLoopProfileMessage {
+  const reader = new BufferReader(new Uint8Array(buffer));
+  const type = reader.readByte() as WebSocketMessageType.ON_LOOP_PROFILE;
+  const cpuMhz = reader.readUint16();
+  const sectionCount = reader.readByte();
+  const sections: LoopProfileSection[] = [];
+  for (let i = 0; i < sectionCount; i++) {
+    sections.push({
+      name: reader.readCString(LOOP_PROFILE_SECTION_NAME_BYTE_SIZE),
+      count: reader.readUint32(),
+      minUs: reader.readUint32(),
+      avgUs: reader.readUint32(),
+      p99Us: reader.readUint32(),
+      maxUs: reader.readUint32(),
+    });
+  }
+  return {type, cpuMhz, sections};
+}
+
 export function decodeWebSocketEspNowDevicesMessage(buffer: ArrayBuffer): WebSocketEspNowDevicesMessage {
   const data = new Uint8Array(buffer);
-  const devices = decodeEspNowDevice(data.subarray(1));
   return {
     type: WebSocketMessageType.ON_ESP_NOW_DEVICES,
-    devices
+    ...decodeEspNowDevicePage(data.subarray(1))
   };
 }
 
@@ -305,3 +343,22 @@ export function decodeWebSocketAlexaMessage(buffer: ArrayBuffer): WebSocketAlexa
     settings: integrationSettings
   };
 }
+
+/**
+ * Splits an ON_BATCH frame into the messages it carries. Each entry is a
+ * little-endian uint16 length followed by a complete message.
+ */
+export function decodeWebSocketBatchMessage(buffer: ArrayBuffer): ArrayBuffer[] {
+  const reader = new BufferReader(new Uint8Array(buffer));
+  reader.readByte();
+  const messages: ArrayBuffer[] = [];
+  while (reader.remaining() >= WEB_SOCKET_BATCH_LENGTH_BYTE_SIZE) {
+    const length = reader.readUint16();
+    if (length > reader.remaining()) {
+      throw new Error(`Invalid batch entry length: ${length}`);
+    }
+    const bytes = reader.readBytes(length);
+    messages.push(bytes.buffer.slice(bytes.byteOffset, bytes.byteOffset + bytes.byteLength));
+  }
+  return messages;
+}
@@ -5,7 +5,11 @@ import {
   AlexaIntegrationSettings
 } from './alexa-integration-settings.model';
 import {HttpCredentials, MAX_HTTP_PASSWORD_LENGTH, MAX_HTTP_USERNAME_LENGTH} from '../http-credentials.model';
-import {WebSocketMessageType} from './websocket-message.model';
+import {
+  COLOR_DELTA_HAS_TRANSITION,
+  COLOR_DELTA_HEADER_BYTE_SIZE,
+  WebSocketMessageType
+} from './websocket-message.model';
 import {
   EAPWiFiConnectionCredentials,
   isEnterprise,
@@ -19,9 +23,15 @@ import {
   WiFiConnectionDetails
 } from './wifi.model';
 import {BleStatus} from './ble.model';
-import {LightState} from './light.model';
+import {LIGHT_STATE_BYTE_SIZE, LightState} from './light.model';
 import {OUTPUT_STATE_BYTE_SIZE, OutputState} from './output.model';
-import {ESP_NOW_DEVICE_LENGTH, ESP_NOW_DEVICE_NAME_MAX_LENGTH, EspNowDevice} from './esp-now.model';
+import {
+  ESP_NOW_DEVICE_LENGTH,
+  ESP_NOW_DEVICE_NAME_MAX_LENGTH,
+  ESP_NOW_DEVICES_PAGE_HEADER_LENGTH,
+  ESP_NOW_DEVICES_PAGE_SIZE,
+  EspNowDevice
+} from './esp-now.model';
 
 export const textEncoder = new TextEncoder();
 
@@ -39,6 +49,11 @@ export class BufferWriter {
     this.buffer[this.offset++] = value;
   }
 
+  writeUint16(value: number): void {
+    this.buffer[this.offset++] = value & 0xFF;
+    this.buffer[this.offset++] = (value >> 8) & 0xFF;
+  }
+
   writeCString(str: string, maxLength: number): void {
     const bytes = textEncoder.encode(str);
     const length = Math.min(bytes.length, maxLength);
@@ -126,6 +141,41 @@ export function encodeColorMessage(values: [LightState, LightState, LightState,
   return encodeOutputState({values}, writer);
 }
 
+/**
+ * Encodes only the channels that differ from `previous` (all of them when it
+ * is null). Returns null when nothing changed and no transition is requested.
+ */
+export function encodeColorDeltaMessage(
+  sequence: number,
+  values: LightState[],
+  previous: LightState[] | null,
+  transitionMs?: number
+): Uint8Array | null {
+  const changed = values
+    .map((state, index) => !previous || previous[index].on !== state.on || previous[index].value !== state.value);
+  const channels = changed.reduce((mask, isChanged, index) => isChanged ? mask | (1 << index) : mask, 0);
+  if (!channels && transitionMs === undefined) {
+    return null;
+  }
+  const hasTransition = transitionMs !== undefined;
+  const length = COLOR_DELTA_HEADER_BYTE_SIZE + (hasTransition ? 2 : 0) +
+    changed.filter(Boolean).length * LIGHT_STATE_BYTE_SIZE;
+  const writer = new BufferWriter(new Uint8Array(length));
+  writer.writeUint8(WebSocketMessageType.ON_COLOR_DELTA);
+  writer.writeUint16(sequence & 0xFFFF);
+  writer.writeUint8(channels | (hasTransition ? COLOR_DELTA_HAS_TRANSITION : 0));
+  if (transitionMs !== undefined) {
+    writer.writeUint16(transitionMs);
+  }
+  values.forEach(({on, value}, index) => {
+    if (changed[index]) {
+      writer.writeBoolean(on);
+      writer.writeUint8(value);
+    }
+  });
+  return writer.buffer;
+}
+
 export function encodeHttpCredentialsMessage(credentials: HttpCredentials): Uint8Array {
   const credentialsBuffer = encodeHttpCredentials(credentials);
   const buffer = new Uint8Array(1 + credentialsBuffer.length);
@@ -175,9 +225,17 @@ export function encodeEspNowController(address: string) {
   return writer.buffer;
 }
 
-export function encodeEspNowDevices(devices: EspNowDevice[]) {
-  const writer = new BufferWriter(new Uint8Array(1 + ESP_NOW_DEVICE_LENGTH * devices.length));
-  writer.writeUint8(devices.length);
-  devices.forEach(dev => encodeEspNowDevice(dev, writer));
-  return writer.buffer;
+/** One buffer per page, to be written in order; an empty list still takes one */
+export function encodeEspNowDevices(devices: EspNowDevice[]): Uint8Array[] {
+  const pages: Uint8Array[] = [];
+  for (let start = 0; start === 0 || start < devices.length; start += ESP_NOW_DEVICES_PAGE_SIZE) {
+    const page = devices.slice(start, start + ESP_NOW_DEVICES_PAGE_SIZE);
+    const writer = new BufferWriter(new Uint8Array(ESP_NOW_DEVICES_PAGE_HEADER_LENGTH + ESP_NOW_DEVICE_LENGTH * page.length));
+    writer.writeUint8(devices.length);
+    writer.writeUint8(start);
+    writer.writeUint8(page.length);
+    page.forEach(dev => encodeEspNowDevice(dev, writer));
+    pages.push(writer.buffer);
+  }
+  return pages;
 }
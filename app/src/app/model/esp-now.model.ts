@@ -2,10 +2,44 @@ export const ESP_NOW_DEVICE_NAME_MAX_LENGTH = 23;
 export const ESP_NOW_DEVICE_NAME_TOTAL_LENGTH = ESP_NOW_DEVICE_NAME_MAX_LENGTH + 1; // +1 for null terminator
 export const ESP_NOW_DEVICE_MAC_LENGTH = 6;
 export const ESP_NOW_DEVICE_LENGTH = ESP_NOW_DEVICE_NAME_TOTAL_LENGTH + ESP_NOW_DEVICE_MAC_LENGTH;
-export const ESP_NOW_MAX_DEVICES_PER_MESSAGE = 10;
-export const ESP_NOW_MESSAGE_LENGTH = 1 + ESP_NOW_DEVICE_LENGTH * ESP_NOW_MAX_DEVICES_PER_MESSAGE; // 1 byte for device count
+export const ESP_NOW_MAX_DEVICES = 32;
+export const ESP_NOW_DEVICES_PAGE_SIZE = 8;
+export const ESP_NOW_DEVICES_PAGE_HEADER_LENGTH = 3; // total, start and count
 
 export interface EspNowDevice {
   name: string;
   address: string
 }
+
+export interface EspNowDevicePage {
+  total: number;
+  start: number;
+  devices: EspNowDevice[];
+}
+
+/**
+ * Puts a device list back together from its pages, which come in order
+ * starting at 0. A page that does not continue the list drops what was
+ * collected so far.
+ */
+export class EspNowDevicePages {
+  private devices: EspNowDevice[] = [];
+
+  /** Returns the list once the page reaching its total arrived */
+  add({total, start, devices}: EspNowDevicePage): EspNowDevice[] | null {
+    if (start === 0) {
+      this.devices = [];
+    }
+    if (start !== this.devices.length) {
+      this.devices = [];
+      return null;
+    }
+    this.devices.push(...devices);
+    if (this.devices.length < total) {
+      return null;
+    }
+    const complete = this.devices;
+    this.devices = [];
+    return complete;
+  }
+}
@@ -4,9 +4,13 @@ import {WiFiDetails, WiFiConnectionDetails, WiFiScanStatus, WiFiStatus} from "./
 import {BleStatus} from './ble.model';
 import {LightState} from './light.model';
 import {OtaState} from './ota.model';
-import {EspNowDevice} from "./esp-now.model";
+import {EspNowDevicePage} from "./esp-now.model";
 
 export const WEB_SOCKET_MESSAGE_TYPE_BYTE_SIZE = 1;
+export const WEB_SOCKET_BATCH_LENGTH_BYTE_SIZE = 2;
+export const COLOR_DELTA_HEADER_BYTE_SIZE = 4;
+export const COLOR_DELTA_HAS_TRANSITION = 0x80;
+export const LOOP_PROFILE_SECTION_NAME_BYTE_SIZE = 16;
 
 export enum WebSocketMessageType {
   ON_HEAP,
@@ -23,6 +27,9 @@ export enum WebSocketMessageType {
   ON_ALEXA_INTEGRATION_SETTINGS,
   ON_ESP_NOW_DEVICES,
   ON_ESP_NOW_CONTROLLER,
+  ON_BATCH,
+  ON_COLOR_DELTA,
+  ON_LOOP_PROFILE,
 }
 
 export interface WebSocketColorMessage {
@@ -65,6 +72,22 @@ export interface WebSocketWiFiStatusMessage {
   status: WiFiStatus
 }
 
+/** Times of one profiled section of the firmware main loop, in microseconds */
+export interface LoopProfileSection {
+  name: string;
+  count: number;
+  minUs: number;
+  avgUs: number;
+  p99Us: number;
+  maxUs: number;
+}
+
+export interface WebSocketLoopProfileMessage {
+  type: WebSocketMessageType.ON_LOOP_PROFILE;
+  cpuMhz: number;
+  sections: LoopProfileSection[];
+}
+
 export interface WebSocketWiFiScanStatusMessage {
   type: WebSocketMessageType.ON_WIFI_SCAN_STATUS;
   status: WiFiScanStatus;
@@ -74,9 +97,9 @@ export interface WebSocketOtaProgressMessage extends OtaState {
   type: WebSocketMessageType.ON_OTA_PROGRESS;
 }
 
-export interface WebSocketEspNowDevicesMessage {
+/** One page of the device list, see EspNowDevicePages */
+export interface WebSocketEspNowDevicesMessage extends EspNowDevicePage {
   type: WebSocketMessageType.ON_ESP_NOW_DEVICES;
-  devices: EspNowDevice[];
 }
 
 export interface WebSocketEspNowControllerMessage {
@@ -112,6 +135,7 @@ export type WebSocketMessage =
   | WebSocketBleStatusMessage
   | WebSocketAlexaIntegrationSettingsMessage
   | WebSocketHeapInfoMessage
+  | WebSocketLoopProfileMessage
   | WebSocketWiFiStatusMessage
   | WebSocketWiFiScanStatusMessage
   | WebSocketOtaProgressMessage
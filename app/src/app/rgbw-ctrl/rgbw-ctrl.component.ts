@@ -12,7 +12,7 @@ import {
   decodeAlexaIntegrationSettings,
   decodeCString,
   decodeEspNowController,
-  decodeEspNowDevice,
+  decodeEspNowDevicePage,
   decodeHttpCredentials,
   decodeWiFiDetails,
   decodeWiFiScanResult,
@@ -24,7 +24,10 @@ import {
   encodeHttpCredentials,
   encodeWiFiConnectionDetails,
   ESP_NOW_DEVICE_NAME_MAX_LENGTH,
-  ESP_NOW_MAX_DEVICES_PER_MESSAGE,
+  ESP_NOW_DEVICES_PAGE_SIZE,
+  ESP_NOW_MAX_DEVICES,
+  EspNowDevice,
+  EspNowDevicePages,
   isEnterprise,
   textEncoder,
   WiFiConnectionDetails,
@@ -129,7 +132,7 @@ export class RgbwCtrlComponent implements OnDestroy {
   readonly MAX_HTTP_USERNAME_LENGTH = MAX_HTTP_USERNAME_LENGTH;
   readonly MAX_HTTP_PASSWORD_LENGTH = MAX_HTTP_PASSWORD_LENGTH;
   readonly ESP_NOW_DEVICE_NAME_MAX_LENGTH = ESP_NOW_DEVICE_NAME_MAX_LENGTH;
-  readonly ESP_NOW_MAX_DEVICES_PER_MESSAGE = ESP_NOW_MAX_DEVICES_PER_MESSAGE;
+  readonly ESP_NOW_MAX_DEVICES = ESP_NOW_MAX_DEVICES;
 
   protected server: BluetoothRemoteGATTServer | null = null;
 
@@ -203,7 +206,7 @@ export class RgbwCtrlComponent implements OnDestroy {
   espNowDevicesForm = new FormArray<FormGroup<{
     name: FormControl<string>,
     address: FormControl<string>
-  }>>([], {validators: Validators.maxLength(ESP_NOW_MAX_DEVICES_PER_MESSAGE)});
+  }>>([], {validators: Validators.maxLength(ESP_NOW_MAX_DEVICES)});
 
   espNowControllerForm = new FormControl<string>('', {
     nonNullable: true,
@@ -520,8 +523,9 @@ export class RgbwCtrlComponent implements OnDestroy {
     const loading = this.matDialog.open(LoadingComponent, {disableClose: true});
     try {
       const value = this.espNowDevicesForm.getRawValue();
-      const buffer = encodeEspNowDevices(value);
-      await this.characteristics.espNowRemotes!.writeValue(buffer);
+      for (const page of encodeEspNowDevices(value)) {
+        await this.characteristics.espNowRemotes!.writeValue(page);
+      }
     } catch (e) {
       console.error('Failed to update ESP-NOW devices:', e);
       this.snackBar.open('Failed to update ESP-NOW devices', 'Close', {duration: 3000});
@@ -649,8 +653,7 @@ export class RgbwCtrlComponent implements OnDestroy {
     this.espNowControllerForm.reset(address);
   }
 
-  private espNowDevicesChanged(view: DataView) {
-    const devices = decodeEspNowDevice(new Uint8Array(view.buffer));
+  private espNowDevicesChanged(devices: EspNowDevice[]) {
     while (this.espNowDevicesForm.length > devices.length) {
       this.espNowDevicesForm.removeAt(0);
     }
@@ -723,8 +726,18 @@ export class RgbwCtrlComponent implements OnDestroy {
     if (!this.characteristics.espNowRemotes) return;
     this.readingEspNowDevices = true;
     try {
-      const view = await this.characteristics.espNowRemotes.readValue();
-      this.espNowDevicesChanged(view);
+      // Every read returns the next page, so a list read halfway before takes up to twice its pages
+      const pages = new EspNowDevicePages();
+      const maxReads = 2 * Math.ceil(ESP_NOW_MAX_DEVICES / ESP_NOW_DEVICES_PAGE_SIZE);
+      for (let read = 0; read < maxReads; read++) {
+        const view = await this.characteristics.espNowRemotes.readValue();
+        const devices = pages.add(decodeEspNowDevicePage(new Uint8Array(view.buffer)));
+        if (devices) {
+          this.espNowDevicesChanged(devices);
+          return;
+        }
+      }
+      console.error('Incomplete ESP-NOW device list');
     } finally {
       this.readingEspNowDevices = false;
     }
@@ -1,7 +1,10 @@
 import {
   AlexaIntegrationSettings,
+  decodeWebSocketBatchMessage,
+  decodeWebSocketOnColorMessage,
   encodeAlexaIntegrationSettingsMessage,
   encodeBleStatusMessage,
+  encodeColorDeltaMessage,
   encodeColorMessage,
   encodeDeviceNameMessage,
   encodeHttpCredentialsMessage,
@@ -19,6 +22,8 @@ export const webSocketHandlers = new Map<WebSocketMessageType, (data: ArrayBuffe
 let timeoutChecker: ReturnType<typeof setInterval> | null = null;
 let lastReceivedMessageTime = Date.now();
 let socket: WebSocket | null = null;
+let colorSequence = 0;
+let lastKnownColor: LightState[] | null = null;
 
 export function initWebSocket(url: string, onConnected?: () => void, onDisconnected?: () => void) {
   if (!socket) {
@@ -48,6 +53,8 @@ function connectWebSocket(url: string, onConnected?: () => void, onDisconnected?
   socket = new WebSocket(url);
   socket.binaryType = "arraybuffer";
   lastReceivedMessageTime = Date.now();
+  colorSequence = 0;
+  lastKnownColor = null;
 
   socket.onopen = () => {
     console.info("WebSocket connected");
@@ -83,6 +90,14 @@ function handleMessage(message: ArrayBuffer) {
   const data = new Uint8Array(message);
   const type = data[0] as WebSocketMessageType;
 
+  if (type === WebSocketMessageType.ON_BATCH) {
+    decodeWebSocketBatchMessage(message).forEach(handleMessage);
+    return;
+  }
+  if (type === WebSocketMessageType.ON_COLOR) {
+    lastKnownColor = decodeWebSocketOnColorMessage(message).values;
+  }
+
   const handler = webSocketHandlers.get(type);
   if (handler) {
     handler(message);
@@ -95,6 +110,24 @@ export function sendColorMessage(state: [LightState, LightState, LightState, Lig
   send(encodeColorMessage(state));
 }
 
+/**
+ * Sends only the channels that differ from the last color sent or received,
+ * for streaming slider drags. The sequence number lets the device drop
+ * frames arriving late.
+ */
+export function sendColorDelta(state: [LightState, LightState, LightState, LightState], transitionMs?: number): void {
+  if (socket?.readyState !== WebSocket.OPEN) {
+    return;
+  }
+  const message = encodeColorDeltaMessage(colorSequence + 1, state, lastKnownColor, transitionMs);
+  if (!message) {
+    return;
+  }
+  colorSequence = (colorSequence + 1) & 0xFFFF;
+  lastKnownColor = state.map(light => ({...light}));
+  send(message);
+}
+
 export function sendDeviceName(name: string): void {
   send(encodeDeviceNameMessage(name));
 }
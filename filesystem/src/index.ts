@@ -6,7 +6,7 @@ import {
 import {
   initWebSocket,
   sendBleStatus,
-  sendColorMessage,
+  sendColorDelta,
   webSocketHandlers
 } from "../../app/src/app/websocket.handler.ts";
 import {
@@ -23,6 +23,7 @@ import {
   decodeWebSocketWiFiDetailsMessage,
   decodeWebSocketWiFiStatusMessage,
   EspNowDevice,
+  EspNowDevicePages,
   LightState,
   otaStatusToString,
   WebSocketMessageType,
@@ -72,7 +73,7 @@ switches.forEach((switchEl, index) => {
       slider.value = "255";
       slider.dispatchEvent(new Event('input'));
     } else {
-      sendColorMessage(getOutputState());
+      sendColorDelta(getOutputState());
     }
   });
 });
@@ -87,8 +88,8 @@ from(sliders).pipe(
       switchEl.checked = true;
     }
   }),
-  throttleTime(200, undefined, {leading: true, trailing: true}),
-).subscribe(() => sendColorMessage(getOutputState()));
+  throttleTime(16, undefined, {leading: true, trailing: true}),
+).subscribe(() => sendColorDelta(getOutputState()));
 
 webSocketHandlers.set(WebSocketMessageType.ON_BLE_STATUS, (message: ArrayBuffer) => {
   const {status} = decodeWebSocketOnBleStatusMessage(message);
@@ -127,9 +128,13 @@ webSocketHandlers.set(WebSocketMessageType.ON_HEAP, (message: ArrayBuffer) => {
   updateText("heap", `${freeHeap}`);
 });
 
+const espNowDevicePages = new EspNowDevicePages();
+
 webSocketHandlers.set(WebSocketMessageType.ON_ESP_NOW_DEVICES, (message: ArrayBuffer) => {
-  const {devices} = decodeWebSocketEspNowDevicesMessage(message);
-  updateEspNowDevices(devices);
+  const devices = espNowDevicePages.add(decodeWebSocketEspNowDevicesMessage(message));
+  if (devices) {
+    updateEspNowDevices(devices);
+  }
 });
 
 webSocketHandlers.set(WebSocketMessageType.ON_ESP_NOW_CONTROLLER, (message: ArrayBuffer) => {
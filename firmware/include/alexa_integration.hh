@@ -3,13 +3,18 @@
 #include "ArduinoJson.h"
 #include "async_esp_alexa_manager.hh"
 #include "async_esp_alexa_color_utils.hh"
+#include "change_bus.hh"
+#include "event_loop.hh"
 
+#include "gamma_table.hh"
 #include "output_manager.hh"
 
 class AlexaIntegration final : public BLE::Service, public StateJsonFiller
 {
     static constexpr auto LOG_TAG = "AlexaIntegration";
     static constexpr unsigned long OUTPUT_STATE_UPDATE_INTERVAL_MS = 500;
+    /** AsyncEspAlexa gives no hint when it has work, so its loop() is polled at this pace */
+    static constexpr unsigned long LOOP_INTERVAL_MS = 50;
 
 public:
 #pragma pack(push, 1)
@@ -98,6 +103,7 @@ private:
     ModeDevice devices = {};
     Output::State outputState;
     unsigned long lastOutputStateUpdate = 0;
+    ChangeBus::Subscription outputChanges{ChangeBus::maskOf(ChangeBus::Topic::Output)};
 
 public:
     explicit AlexaIntegration(Output::Manager& output): outputManager(output)
@@ -120,9 +126,10 @@ public:
     void handle(const unsigned long now)
     {
         espAlexaManager.loop();
-        if (now - lastOutputStateUpdate >= OUTPUT_STATE_UPDATE_INTERVAL_MS)
+        if (outputChanges.pending() && now - lastOutputStateUpdate >= OUTPUT_STATE_UPDATE_INTERVAL_MS)
         {
             lastOutputStateUpdate = now;
+            (void)outputChanges.take();
             if (const auto newOutputState = outputManager.getState();
                 outputState != newOutputState)
             {
@@ -132,6 +139,13 @@ public:
         }
     }
 
+    void schedule(EventLoop::Deadline& next) const
+    {
+        next.in(LOOP_INTERVAL_MS);
+        if (outputChanges.pending())
+            next.at(lastOutputStateUpdate + OUTPUT_STATE_UPDATE_INTERVAL_MS);
+    }
+
     [[nodiscard]] AsyncWebHandler* createAsyncWebHandler() const
     {
         return espAlexaManager.createAlexaAsyncWebHandler();
@@ -148,6 +162,7 @@ public:
         savePreferences();
         clearDevices();
         setupDevices();
+        ChangeBus::publish(ChangeBus::Topic::AlexaSettings);
     }
 
 private:
@@ -253,7 +268,7 @@ private:
         const auto [h, s, v] = AsyncEspAlexaColorUtils::rgbwToHsv(r, g, b, w);
         const auto on = outputManager.anyOn();
         devices.rgbw.device = new AsyncEspAlexaExtendedColorDevice(
-            deviceName, on, v, h, s, 500,
+            deviceName, on, toAlexaBrightness(v), h, s, 500,
             AsyncEspAlexaExtendedColorDevice::ColorMode::hs);
         espAlexaManager.addDevice(devices.rgbw.device);
 
@@ -289,7 +304,7 @@ private:
             AsyncEspAlexaColorUtils::rgbToHsv(r, g, b);
 
         devices.rgb.rgbDevice = new AsyncEspAlexaColorDevice(
-            settings.deviceNames[0].data(), on, v, h, s);
+            settings.deviceNames[0].data(), on, toAlexaBrightness(v), h, s);
         espAlexaManager.addDevice(devices.rgb.rgbDevice);
 
         devices.rgb.rgbDevice->setColorCallback([this](const bool isOn, const uint8_t brightness,
@@ -330,7 +345,7 @@ private:
         ESP_LOGI(LOG_TAG, "Adding single device: %s", name);
         const auto value = outputManager.getValue(color);
         const auto on = outputManager.isOn(color);
-        const auto device = new AsyncEspAlexaDimmableDevice(name, on, value);
+        const auto device = new AsyncEspAlexaDimmableDevice(name, on, toAlexaBrightness(value));
 
 
         device->setBrightnessCallback([this, name, color](const bool isOn, const uint8_t brightness)
@@ -346,13 +361,9 @@ private:
         ESP_LOGI(LOG_TAG, "Received HS command: on=%d, brightness=%u, hue=%u, saturation=%u",
                  isOn, brightness, hue, saturation);
         const auto [r, g, b,w]
-            = AsyncEspAlexaColorUtils::hsvToRgbw(hue, saturation, brightness);
+            = AsyncEspAlexaColorUtils::hsvToRgbw(hue, saturation, fromAlexaBrightness(brightness));
         ESP_LOGI(LOG_TAG, "Converted RGBW: r=%u, g=%u, b=%u, w=%u", r, g, b, w);
-        outputManager.setColor(r, g, b, w);
-        outputManager.setOn(isOn, Color::Red);
-        outputManager.setOn(isOn, Color::Green);
-        outputManager.setOn(isOn, Color::Blue);
-        outputManager.setOn(isOn, Color::White);
+        outputManager.setState({{{{isOn, r}, {isOn, g}, {isOn, b}, {isOn, w}}}});
     }
 
     void handleRgbwCommand(const bool isOn, const uint8_t brightness,
@@ -361,13 +372,9 @@ private:
         ESP_LOGI(LOG_TAG, "Received CT command: on=%d, brightness=%u, colorTemperature=%u",
                  isOn, brightness, colorTemperature);
         const auto [r, g, b, w]
-            = AsyncEspAlexaColorUtils::ctToRgbw(brightness, colorTemperature);
+            = AsyncEspAlexaColorUtils::ctToRgbw(fromAlexaBrightness(brightness), colorTemperature);
         ESP_LOGI(LOG_TAG, "Converted RGBW: r=%u, g=%u, b=%u, w=%u", r, g, b, w);
-        outputManager.setColor(r, g, b, w);
-        outputManager.setOn(isOn, Color::Red);
-        outputManager.setOn(isOn, Color::Green);
-        outputManager.setOn(isOn, Color::Blue);
-        outputManager.setOn(isOn, Color::White);
+        outputManager.setState({{{{isOn, r}, {isOn, g}, {isOn, b}, {isOn, w}}}});
     }
 
     void handleRgbCommand(const bool isOn, const uint8_t brightness,
@@ -375,20 +382,36 @@ private:
     {
         ESP_LOGI(LOG_TAG, "Received HS command: brightness=%u, hue=%u, saturation=%u",
                  brightness, hue, saturation);
-        const auto [r, g, b] = AsyncEspAlexaColorUtils::hsvToRgb(hue, saturation, brightness);
+        const auto [r, g, b] = AsyncEspAlexaColorUtils::hsvToRgb(hue, saturation, fromAlexaBrightness(brightness));
         ESP_LOGI(LOG_TAG, "Converted RGB: r=%u, g=%u, b=%u", r, g, b);
-        outputManager.setColor(r, g, b);
-        outputManager.setOn(isOn, Color::Red);
-        outputManager.setOn(isOn, Color::Green);
-        outputManager.setOn(isOn, Color::Blue);
+        outputManager.setChannels({{{{isOn, r}, {isOn, g}, {isOn, b}, {}}}},
+                                  Output::Manager::ALL_CHANNELS & ~Output::Manager::channelOf(Color::White));
     }
 
     void handleSingleChannelCommand(__unused const char* name, const Color color,
                                     const bool isOn, const uint8_t brightness) const
     {
         ESP_LOGI(LOG_TAG, "Received %s command: on=%d, brightness=%u", name, isOn, brightness);
-        outputManager.setOn(isOn, color);
-        outputManager.setValue(brightness < 128 ? brightness : brightness + 1, color);
+        Output::State state;
+        state.values[static_cast<size_t>(color)] = {isOn, fromAlexaBrightness(brightness)};
+        outputManager.setChannels(state, Output::Manager::channelOf(color));
+    }
+
+    /**
+     * Alexa brightness is perceptual while channel values are PWM duties,
+     * so both directions go through the gamma table.
+     */
+    static uint8_t toAlexaBrightness(const uint8_t duty)
+    {
+        return std::clamp(Gamma::Perceptual::toPerceptual(duty),
+                          AsyncEspAlexaColorUtils::ALEXA_MIN_BRI_VAL,
+                          AsyncEspAlexaColorUtils::ALEXA_MAX_BRI_VAL);
+    }
+
+    static uint8_t fromAlexaBrightness(const uint8_t brightness)
+    {
+        if (brightness >= AsyncEspAlexaColorUtils::ALEXA_MAX_BRI_VAL) return Light::MAX_BRIGHTNESS;
+        return std::max(Gamma::Perceptual::toDuty(brightness), Light::MIN_BRIGHTNESS);
     }
 
     void updateRgbwDevice() const
@@ -401,7 +424,7 @@ private:
         const auto [h, s, v] = AsyncEspAlexaColorUtils::rgbwToHsv(r, g, b, w);
         devices.rgbw.device->setOn(outputState.anyOn());
         devices.rgbw.device->setColor(h, s);
-        devices.rgbw.device->setBrightness(v);
+        devices.rgbw.device->setBrightness(toAlexaBrightness(v));
     }
 
     void updateRgbDevice() const
@@ -416,7 +439,7 @@ private:
         const auto on = outputState.isOn(Color::Red) || outputState.isOn(Color::Green) || outputState.isOn(Color::Blue);
         devices.rgb.rgbDevice->setOn(on);
         devices.rgb.rgbDevice->setColor(h, s);
-        devices.rgb.rgbDevice->setBrightness(v);
+        devices.rgb.rgbDevice->setBrightness(toAlexaBrightness(v));
     }
 
     void updateStandaloneDevice() const
@@ -435,9 +458,7 @@ private:
     void updateDevice(AsyncEspAlexaDimmableDevice* device, const Color color) const
     {
         if (!device) return;
-        const auto brightness = std::clamp(outputState.getValue(color),
-                                           AsyncEspAlexaColorUtils::ALEXA_MIN_BRI_VAL,
-                                           AsyncEspAlexaColorUtils::ALEXA_MAX_BRI_VAL);
+        const auto brightness = toAlexaBrightness(outputState.getValue(color));
 
         const auto on = outputState.isOn(color);
         device->setOn(on);
@@ -451,6 +472,16 @@ public:
         getSettings().toJson(root["alexa"].to<JsonObject>());
     }
 
+    [[nodiscard]] const char* getStateFields() const override
+    {
+        return "alexa";
+    }
+
+    [[nodiscard]] ChangeBus::Mask getStateTopics() const override
+    {
+        return ChangeBus::maskOf(ChangeBus::Topic::AlexaSettings);
+    }
+
     void createServiceAndCharacteristics(NimBLEServer* server) override
     {
         const auto service = server->createService(BLE::UUID::ALEXA_SERVICE);
@@ -481,7 +512,8 @@ private:
             Settings settings;
             if (pCharacteristic->getValue().size() != sizeof(Settings))
             {
-                ESP_LOGE(LOG_TAG, "Received invalid Alexa settings length: %d", pCharacteristic->getValue().size());
+                ESP_LOGE(LOG_TAG, "Received invalid Alexa settings length: %u",
+                         static_cast<unsigned>(pCharacteristic->getValue().size()));
                 return;
             }
             memcpy(&settings, pCharacteristic->getValue().data(), sizeof(Settings));
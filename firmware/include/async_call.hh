@@ -1,6 +1,40 @@
 #pragma once
 
 #include <cstdint>
-#include <functional>
 
-void async_call(std::function<void()> callback, uint32_t usStackDepth, uint32_t delayMs);
+#include "inplace_function.hh"
+
+/**
+ * Runs the callback on a small pool of worker tasks after delayMs.
+ *
+ * Calls share WORKER_COUNT long-lived tasks with WORKER_STACK_SIZE bytes of
+ * stack, so nothing is created per call. At most MAX_PENDING calls can be
+ * queued or waiting on their delay; beyond that the call is rejected and
+ * false is returned. The callback is stored in the pending slot itself, so
+ * whatever it captures has to fit into Callback.
+ */
+namespace AsyncCall
+{
+    static constexpr uint8_t WORKER_COUNT = 2;
+    static constexpr uint32_t WORKER_STACK_SIZE = 4096;
+    static constexpr uint8_t MAX_PENDING = 16;
+    /** Resolution of delayed calls */
+    static constexpr uint32_t TICK_MS = 10;
+
+    using Callback = InplaceFunction<void(), 32>;
+
+    struct Stats
+    {
+        uint32_t executed = 0;
+        uint32_t rejected = 0;
+        uint8_t pending = 0;
+        uint8_t maxPending = 0;
+        /** Time from when a call was due until a worker started it */
+        uint32_t lastLatencyUs = 0;
+        uint32_t maxLatencyUs = 0;
+    };
+
+    Stats getStats();
+}
+
+bool async_call(AsyncCall::Callback callback, uint32_t delayMs = 0);
@@ -5,7 +5,9 @@
 #include <string>
 
 #include "alexa_integration.hh"
+#include "change_bus.hh"
 #include "device_manager.hh"
+#include "event_loop.hh"
 #include "http_manager.hh"
 
 namespace BLE
@@ -22,6 +24,7 @@ namespace BLE
         const std::vector<Service*> services;
 
         NimBLEServer* server = nullptr;
+        Status lastPublishedStatus = Status::OFF;
 
     public:
         explicit Manager(
@@ -56,6 +59,13 @@ namespace BLE
         void handle(const unsigned long now)
         {
             handleAdvertisementTimeout(now);
+            publishStatusChange();
+        }
+
+        void schedule(EventLoop::Deadline& next) const
+        {
+            if (server != nullptr && getStatus() != Status::CONNECTED)
+                next.at(bluetoothAdvertisementTimeout + 1);
         }
 
         void stop()
@@ -118,6 +128,16 @@ namespace BLE
             ble["status"] = getStatusString();
         }
 
+        [[nodiscard]] const char* getStateFields() const override
+        {
+            return "ble";
+        }
+
+        [[nodiscard]] ChangeBus::Mask getStateTopics() const override
+        {
+            return ChangeBus::maskOf(ChangeBus::Topic::BleStatus);
+        }
+
         AsyncWebHandler* createAsyncWebHandler() override
         {
             return new AsyncRestWebHandler(this);
@@ -151,6 +171,19 @@ namespace BLE
             }
         }
 
+        /**
+         * Connections come and go on the NimBLE host task, so the status is
+         * compared once per loop and published only when it differs.
+         */
+        void publishStatusChange()
+        {
+            if (const auto status = getStatus(); status != lastPublishedStatus)
+            {
+                lastPublishedStatus = status;
+                ChangeBus::publish(ChangeBus::Topic::BleStatus);
+            }
+        }
+
         class AsyncRestWebHandler final : public AsyncWebHandler
         {
             Manager* bleManager;
@@ -189,9 +222,15 @@ namespace BLE
 
         class BLEServerCallback final : public NimBLEServerCallbacks
         {
+            void onConnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo) override
+            {
+                EventLoop::wake();
+            }
+
             void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason) override
             {
                 pServer->startAdvertising(); // NOLINT
+                EventLoop::wake();
             }
         };
     };
@@ -39,9 +39,11 @@ namespace BLE
 
         static constexpr auto ESP_NOW_CONTROLLER_SERVICE = "12345678-1234-1234-1234-123456789004";
         static constexpr auto ESP_NOW_REMOTES_CHARACTERISTIC = "aaaaaaaa-bbbb-cccc-dddd-eeeeeeee4001";
+        static constexpr auto ESP_NOW_GROUPS_CHARACTERISTIC = "aaaaaaaa-bbbb-cccc-dddd-eeeeeeee4002";
 
         static constexpr auto ESP_NOW_REMOTE_SERVICE = "12345678-1234-1234-1234-123456789005";
         static constexpr auto ESP_NOW_CONTROLLER_CHARACTERISTIC = "aaaaaaaa-bbbb-cccc-dddd-eeeeeeee5001";
+        static constexpr auto ESP_NOW_GROUP_CHARACTERISTIC = "aaaaaaaa-bbbb-cccc-dddd-eeeeeeee5002";
 
         static constexpr auto WIFI_SERVICE = "12345678-1234-1234-1234-123456789006";
         static constexpr auto WIFI_DETAILS_CHARACTERISTIC = "aaaaaaaa-bbbb-cccc-dddd-eeeeeeee6001";
@@ -4,15 +4,18 @@
 #include <Arduino.h>
 
 #include "color.hh"
+#include "gamma_table.hh"
 #include "light.hh"
 #include "ble_manager.hh"
+#include "event_loop.hh"
 #include "wifi_model.hh"
 
 class BoardLED
 {
     static constexpr uint8_t MAX_BRIGHTNESS = 32;
-    static constexpr unsigned long BLINK_INTERVAL_MS = 20;
-    static constexpr int TRANSITION_STEP = 4;
+    static constexpr unsigned long BLINK_INTERVAL_MS = 10;
+    static constexpr int TRANSITION_STEP = 16;
+    static constexpr int MAX_FADE_LEVEL = 255;
 
     std::array<Light, 3> leds;
     static_assert(static_cast<size_t>(Color::Blue) < 3, "Color enum out of bounds for BoardLED");
@@ -20,6 +23,8 @@ class BoardLED
     unsigned long lastBlinkTime = 0;
     int fadeValue = 0;
     int fadeDirection = TRANSITION_STEP;
+    /** Whether the last handle() showed a blinking pattern */
+    bool blinking = false;
 
 public:
     explicit BoardLED(const gpio_num_t red, const gpio_num_t green, const gpio_num_t blue)
@@ -44,6 +49,7 @@ public:
                 const WifiScanStatus wifiScanStatus, const WiFiStatus wifiStatus,
                 const bool isOtaUpdateRunning)
     {
+        blinking = false;
         // If OTA update is running, blink purple
         if (isOtaUpdateRunning)
         {
@@ -81,17 +87,29 @@ public:
         this->setColor({MAX_BRIGHTNESS, 0, 0});
     }
 
+    /** Steady colors only change on status changes, which wake the loop */
+    void schedule(EventLoop::Deadline& next) const
+    {
+        if (blinking)
+            next.at(lastBlinkTime + BLINK_INTERVAL_MS);
+    }
+
 private:
+    /**
+     * Steps the fade in perceptual space and maps it back through the gamma
+     * table, so the blink looks evenly paced instead of lingering near full.
+     */
     uint8_t getFadeValue(const unsigned long now)
     {
+        blinking = true;
         if (now - lastBlinkTime >= BLINK_INTERVAL_MS)
         {
             lastBlinkTime = now;
             fadeValue += fadeDirection;
 
-            if (fadeValue >= MAX_BRIGHTNESS)
+            if (fadeValue >= MAX_FADE_LEVEL)
             {
-                fadeValue = MAX_BRIGHTNESS;
+                fadeValue = MAX_FADE_LEVEL;
                 fadeDirection = -TRANSITION_STEP;
             }
             else if (fadeValue <= 0)
@@ -100,7 +118,8 @@ private:
                 fadeDirection = TRANSITION_STEP;
             }
         }
-        return static_cast<uint8_t>(fadeValue);
+        const auto duty = Gamma::Perceptual::toDuty(static_cast<uint8_t>(fadeValue));
+        return static_cast<uint8_t>((duty * MAX_BRIGHTNESS + Light::MAX_BRIGHTNESS / 2) / Light::MAX_BRIGHTNESS);
     }
 
     void setColor(const std::array<uint8_t, 3>& rgb)
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <Arduino.h>
+
+/**
+ * Publish/subscribe bus for state changes.
+ *
+ * Producers call ChangeBus::publish(topic) whenever the state behind a topic
+ * changes; every Subscription accumulates the topics it cares about as dirty
+ * bits, and consumers take() them when they are ready to react. Publishing is
+ * lock-free and safe from any task, so consumers no longer need to rebuild and
+ * compare snapshots on every loop.
+ */
+namespace ChangeBus
+{
+    enum class Topic : uint8_t
+    {
+        Output,
+        BleStatus,
+        DeviceName,
+        OtaState,
+        EspNowDevices,
+        EspNowController,
+        WiFiDetails,
+        WiFiStatus,
+        AlexaSettings,
+        COUNT
+    };
+
+    using Mask = uint32_t;
+
+    static_assert(static_cast<size_t>(Topic::COUNT) <= sizeof(Mask) * 8, "Too many topics for Mask");
+
+    constexpr Mask maskOf(const Topic topic)
+    {
+        return Mask{1} << static_cast<uint8_t>(topic);
+    }
+
+    template <typename... Topics>
+    constexpr Mask maskOf(const Topic first, const Topics... rest)
+    {
+        return maskOf(first) | maskOf(rest...);
+    }
+
+    static constexpr Mask ALL_TOPICS = (Mask{1} << static_cast<uint8_t>(Topic::COUNT)) - 1;
+
+    class Subscription
+    {
+        const Mask interest;
+        std::atomic<Mask> dirty;
+
+    public:
+        /**
+         * Subscriptions must outlive the bus usage; they are registered for the
+         * lifetime of the program. All topics start dirty so the first take()
+         * delivers the initial state.
+         */
+        explicit Subscription(Mask interest = ALL_TOPICS);
+
+        Subscription(const Subscription&) = delete;
+        Subscription& operator=(const Subscription&) = delete;
+
+        void mark(const Mask topics)
+        {
+            if (const auto relevant = topics & interest)
+                dirty.fetch_or(relevant, std::memory_order_release);
+        }
+
+        void mark(const Topic topic)
+        {
+            mark(maskOf(topic));
+        }
+
+        [[nodiscard]] Mask take()
+        {
+            return dirty.exchange(0, std::memory_order_acquire);
+        }
+
+        [[nodiscard]] bool pending() const
+        {
+            return dirty.load(std::memory_order_relaxed) != 0;
+        }
+    };
+
+    class Registry
+    {
+    public:
+        static constexpr uint8_t MAX_SUBSCRIPTIONS = 16;
+
+    private:
+        std::array<std::atomic<Subscription*>, MAX_SUBSCRIPTIONS> subscriptions = {};
+        std::atomic<uint8_t> count = 0;
+
+        /** Bumped on every publish; each topic remembers the value of its last change */
+        std::atomic<uint32_t> version = 0;
+        std::array<std::atomic<uint32_t>, static_cast<size_t>(Topic::COUNT)> topicVersions = {};
+
+        std::atomic<void (*)()> listener = nullptr;
+
+    public:
+        static Registry& get()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        /** False once MAX_SUBSCRIPTIONS are registered; the subscription then never gets marked */
+        [[nodiscard]] bool add(Subscription* subscription)
+        {
+            const auto index = count.fetch_add(1);
+            if (index >= MAX_SUBSCRIPTIONS)
+            {
+                count.fetch_sub(1);
+                return false;
+            }
+            subscriptions[index].store(subscription, std::memory_order_release);
+            return true;
+        }
+
+        void publish(const Mask topics)
+        {
+            const auto current = version.fetch_add(1, std::memory_order_relaxed) + 1;
+            for (uint8_t i = 0; i < topicVersions.size(); ++i)
+                if (topics & maskOf(static_cast<Topic>(i)))
+                    topicVersions[i].store(current, std::memory_order_relaxed);
+
+            const auto n = std::min<uint8_t>(count.load(std::memory_order_acquire), MAX_SUBSCRIPTIONS);
+            for (uint8_t i = 0; i < n; ++i)
+                if (auto* subscription = subscriptions[i].load(std::memory_order_acquire))
+                    subscription->mark(topics);
+
+            if (const auto callback = listener.load(std::memory_order_acquire))
+                callback();
+        }
+
+        /** Called on the publishing task after every publish, e.g. to wake the main loop */
+        void setListener(void (*callback)())
+        {
+            listener.store(callback, std::memory_order_release);
+        }
+
+        /**
+         * Monotonic version of the given topics: it only moves when one of
+         * them is published, so equal versions mean nothing changed.
+         */
+        [[nodiscard]] uint32_t versionOf(const Mask topics) const
+        {
+            uint32_t result = 0;
+            for (uint8_t i = 0; i < topicVersions.size(); ++i)
+                if (topics & maskOf(static_cast<Topic>(i)))
+                    result = std::max(result, topicVersions[i].load(std::memory_order_relaxed));
+            return result;
+        }
+    };
+
+    inline Subscription::Subscription(const Mask interest)
+        : interest(interest), dirty(interest)
+    {
+        if (!Registry::get().add(this))
+            ESP_LOGE("ChangeBus", "All %u subscriptions taken, this one will never be notified",
+                     Registry::MAX_SUBSCRIPTIONS);
+    }
+
+    inline void publish(const Topic topic)
+    {
+        Registry::get().publish(maskOf(topic));
+    }
+
+    inline uint32_t versionOf(const Mask topics)
+    {
+        return Registry::get().versionOf(topics);
+    }
+}
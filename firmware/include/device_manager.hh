@@ -7,6 +7,7 @@
 #include "NimBLECharacteristic.h"
 #include "throttled_value.hh"
 #include "ble_service.hh"
+#include "change_bus.hh"
 #include "http_manager.hh"
 #include "state_json_filler.hh"
 #include "async_call.hh"
@@ -24,6 +25,7 @@ public:
 private:
     static constexpr auto LOG_TAG = "DeviceManager";
     static constexpr auto PREFERENCES_NAME = "device-config";
+    static constexpr unsigned long VOLTAGE_NOTIFICATION_INTERVAL_MS = 1000;
 
     Sensor sensor{ControllerHardware::Pin::Input::VOLTAGE};
 
@@ -50,6 +52,16 @@ public:
         sendInputVoltageNotification(now);
     }
 
+    void schedule(EventLoop::Deadline& next)
+    {
+        sensor.schedule(next);
+        std::lock_guard bleLock(getBleMutex());
+        if (bleDeviceHeapCharacteristic != nullptr)
+            next.afterWindow(heapNotificationThrottle.getLastSendTime(), heapNotificationThrottle.getInterval());
+        if (bleInputVoltageCharacteristic != nullptr)
+            next.at(lastVoltageNotification + VOLTAGE_NOTIFICATION_INTERVAL_MS);
+    }
+
     char* getDeviceName() const
     {
         std::lock_guard lock(getDeviceNameMutex());
@@ -89,6 +101,7 @@ public:
         prefs.end();
 
         deviceName[0] = '\0'; // Invalidate cached name
+        ChangeBus::publish(ChangeBus::Topic::DeviceName);
         WiFiClass::setHostname(safeName);
         WiFi.reconnect();
 
@@ -110,6 +123,24 @@ public:
         root["deviceName"] = getDeviceName();
         root["firmwareVersion"] = FIRMWARE_VERSION;
         root["heap"] = esp_get_free_heap_size();
+        const auto stats = AsyncCall::getStats();
+        const auto asyncCall = root["asyncCall"].to<JsonObject>();
+        asyncCall["executed"] = stats.executed;
+        asyncCall["rejected"] = stats.rejected;
+        asyncCall["pending"] = stats.pending;
+        asyncCall["maxPending"] = stats.maxPending;
+        asyncCall["lastLatencyUs"] = stats.lastLatencyUs;
+        asyncCall["maxLatencyUs"] = stats.maxLatencyUs;
+    }
+
+    [[nodiscard]] const char* getStateFields() const override
+    {
+        return "deviceName,firmwareVersion,heap,asyncCall";
+    }
+
+    [[nodiscard]] ChangeBus::Mask getStateTopics() const override
+    {
+        return ChangeBus::maskOf(ChangeBus::Topic::DeviceName);
     }
 
     void createServiceAndCharacteristics(NimBLEServer* server) override
@@ -207,7 +238,7 @@ private:
 
     void sendInputVoltageNotification(const unsigned long now)
     {
-        if (now - lastVoltageNotification < 1000) return; // no more than 1 notification per second
+        if (now - lastVoltageNotification < VOLTAGE_NOTIFICATION_INTERVAL_MS) return;
         lastVoltageNotification = now;
 
         std::lock_guard bleLock(getBleMutex());
@@ -229,7 +260,7 @@ private:
                 async_call([this]
                 {
                     esp_restart();
-                }, 2048, 50);
+                }, 50);
             }
             else
             {
@@ -341,7 +372,7 @@ private:
                 async_call([]
                 {
                     esp_restart();
-                }, 2048, 0);
+                });
             });
             return sendMessageJsonResponse(request, "Restarting...");
         }
@@ -354,7 +385,7 @@ private:
                 {
                     nvs_flash_erase();
                     esp_restart();
-                }, 4096, 0);
+                });
             });
             return sendMessageJsonResponse(request, "Resetting to factory defaults...");
         }
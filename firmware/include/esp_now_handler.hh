@@ -1,8 +1,13 @@
 #pragma once
 
-#pragma pack(push, 1)
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <esp_now.h>
+
 namespace EspNow
 {
+#pragma pack(push, 1)
     struct Message
     {
         enum class Type : uint8_t
@@ -16,9 +21,140 @@ namespace EspNow
             TurnOnAll,
             IncreaseBrightness,
             DecreaseBrightness,
+            /** values[0] on every selected channel, on/off left alone */
+            SetBrightness,
+            /** values of the selected channels, on/off left alone */
+            SetColor,
+            /** values and on of the selected channels, as one change */
+            SetState,
+            /** steps perceptual brightness steps at once, negative to dim */
+            StepBrightness,
         };
 
+        static constexpr uint8_t ALL_CHANNELS = 0x0F;
+
         Type type;
+        /** Bit per Color the absolute types apply to */
+        uint8_t channels = ALL_CHANNELS;
+        /** Bit per Color that SetState turns on */
+        uint8_t on = 0;
+        std::array<uint8_t, 4> values = {};
+        int8_t steps = 0;
+
+        static Message setBrightness(const uint8_t value, const uint8_t channels = ALL_CHANNELS)
+        {
+            return {Type::SetBrightness, channels, 0, {value}};
+        }
+
+        static Message setColor(const std::array<uint8_t, 4>& values, const uint8_t channels = ALL_CHANNELS)
+        {
+            return {Type::SetColor, channels, 0, values};
+        }
+
+        static Message setState(const std::array<uint8_t, 4>& values, const uint8_t on,
+                                const uint8_t channels = ALL_CHANNELS)
+        {
+            return {Type::SetState, channels, on, values};
+        }
+
+        static Message stepBrightness(const int8_t steps)
+        {
+            return {Type::StepBrightness, ALL_CHANNELS, 0, {}, steps};
+        }
+    };
+
+    /**
+     * Starts every frame. Remotes from before frames send the bare Message
+     * type, which the controller still accepts, unacknowledged.
+     */
+    struct FrameHeader
+    {
+        static constexpr uint8_t VERSION = 2;
+
+        enum class Kind : uint8_t
+        {
+            Command,
+            Ack,
+            GroupCommand,
+        };
+
+        uint8_t version = VERSION;
+        Kind kind = Kind::Command;
+        /** Drawn at random on every boot, so a remote starting its sequence over is not taken for a duplicate */
+        uint32_t remoteId = 0;
+        uint16_t sequence = 0;
+        /** 0 for the first transmission, counting up with every retry */
+        uint8_t attempt = 0;
+    };
+
+    struct CommandFrame
+    {
+        FrameHeader header;
+        Message message;
+    };
+
+    /** Sent back for every command frame, repeating its header with Kind::Ack */
+    struct AckFrame
+    {
+        FrameHeader header;
+    };
+
+    /**
+     * Broadcast to every controller subscribed to the group, repeated
+     * instead of acked. applyInUs counts down from the first transmission,
+     * so controllers that caught different copies still apply the message
+     * at the same moment.
+     */
+    struct GroupFrame
+    {
+        /** Groups are numbered from 1; 0 on a remote means it sends to its controller alone */
+        static constexpr uint8_t MAX_GROUP = 32;
+        /** Longer delays are cut to this, so a corrupt frame cannot hold a command back */
+        static constexpr uint32_t MAX_APPLY_IN_US = 1000000;
+
+        FrameHeader header;
+        uint8_t group = 0;
+        uint32_t applyInUs = 0;
+        Message message;
     };
-}
 #pragma pack(pop)
+
+    static constexpr std::array<uint8_t, ESP_NOW_ETH_ALEN> BROADCAST_ADDRESS = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+    static_assert(sizeof(Message::Type) == 1, "Bare messages are the type byte alone");
+    static_assert(sizeof(CommandFrame) != sizeof(Message::Type),
+                  "Frames are told apart from bare messages by length");
+    static_assert(sizeof(GroupFrame) != sizeof(CommandFrame) && sizeof(GroupFrame) != sizeof(AckFrame),
+                  "Group frames are told apart from the other frames by length");
+
+    /**
+     * Registers the address as a unicast peer unless it is one. Returns
+     * false when ESP-NOW refuses it, for instance with the peer table full;
+     * ESP-NOW is left running, as reinitializing it would drop the send and
+     * receive callbacks the handlers registered.
+     */
+    inline bool addPeer(const uint8_t* address)
+    {
+        static constexpr auto LOG_TAG = "EspNow";
+        if (esp_now_is_peer_exist(address)) return true;
+
+        esp_now_peer_info_t peerInfo = {
+            .peer_addr = {},
+            .lmk = {},
+            .channel = 0,
+            .ifidx = WIFI_IF_STA,
+            .encrypt = false,
+            .priv = nullptr,
+        };
+        std::copy_n(address, ESP_NOW_ETH_ALEN, peerInfo.peer_addr);
+        if (const auto result = esp_now_add_peer(&peerInfo); result != ESP_OK)
+        {
+            ESP_LOGE(LOG_TAG, "Failed to add peer %02X:%02X:%02X:%02X:%02X:%02X (error 0x%x)",
+                     address[0], address[1], address[2], address[3], address[4], address[5],
+                     static_cast<unsigned>(result));
+            return false;
+        }
+        ESP_LOGI(LOG_TAG, "Peer added successfully");
+        return true;
+    }
+}
@@ -1,12 +1,21 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <cstring>
 #include <mutex>
 #include <optional>
 #include <algorithm>
 #include <Preferences.h>
 #include <NimBLEServer.h>
 
+#include "change_bus.hh"
+#include "esp_now_handler.hh"
+#include "event_loop.hh"
+#include "inplace_function.hh"
+#include "mac_table.hh"
+#include "spsc_ring.hh"
+
 namespace EspNow
 {
 #pragma pack(push, 1)
@@ -35,10 +44,10 @@ namespace EspNow
 
     struct DeviceData
     {
-        static constexpr uint8_t MAX_DEVICES_PER_MESSAGE = 10;
+        static constexpr uint8_t MAX_DEVICES = 32;
 
         uint8_t deviceCount = 0;
-        std::array<Device, MAX_DEVICES_PER_MESSAGE> devices = {};
+        std::array<Device, MAX_DEVICES> devices = {};
 
         bool operator==(const DeviceData& other) const
         {
@@ -50,8 +59,69 @@ namespace EspNow
             return deviceCount != other.deviceCount || devices != other.devices;
         }
     };
+
+    /**
+     * A slice of the device list as BLE and the WebSocket carry it. Only
+     * count devices go over the wire; a list is sent as pages in order,
+     * the first one starting at 0, and is complete with the page that
+     * reaches total.
+     */
+    struct DevicePage
+    {
+        static constexpr uint8_t PAGE_SIZE = 8;
+        static constexpr uint8_t MAX_PAGES = (DeviceData::MAX_DEVICES + PAGE_SIZE - 1) / PAGE_SIZE;
+        static constexpr size_t HEADER_SIZE = 3;
+
+        uint8_t total = 0;
+        uint8_t start = 0;
+        uint8_t count = 0;
+        std::array<Device, PAGE_SIZE> devices = {};
+
+        /** An empty list still takes one page */
+        static uint8_t pageCount(const DeviceData& data)
+        {
+            return std::max<uint8_t>(1, (data.deviceCount + PAGE_SIZE - 1) / PAGE_SIZE);
+        }
+
+        static DevicePage of(const DeviceData& data, const uint8_t index)
+        {
+            DevicePage page;
+            page.total = data.deviceCount;
+            page.start = std::min<uint8_t>(index * PAGE_SIZE, data.deviceCount);
+            page.count = std::min<uint8_t>(PAGE_SIZE, data.deviceCount - page.start);
+            std::copy_n(data.devices.begin() + page.start, page.count, page.devices.begin());
+            return page;
+        }
+
+        [[nodiscard]] size_t size() const
+        {
+            return HEADER_SIZE + count * sizeof(Device);
+        }
+    };
+
+    static_assert(sizeof(DevicePage) == DevicePage::HEADER_SIZE + DevicePage::PAGE_SIZE * sizeof(Device),
+                  "Unexpected DevicePage size");
 #pragma pack(pop)
 
+    /**
+     * Receives commands from the paired remotes.
+     *
+     * The receive callback runs on the Wi-Fi task, so it only copies the
+     * frame into a fixed ring and wakes the output task; a full ring drops
+     * the frame, which the remote then retries. handle() runs on the output
+     * task and does everything else: the allowlist, the ack, deduplication
+     * and the message callback.
+     *
+     * The allowlist is a MacTable rebuilt whenever the device list changes,
+     * so a lookup costs the same for any number of remotes and never waits
+     * for the device list mutex.
+     *
+     * Group frames are broadcast to every controller subscribed to their
+     * group and taken only from allowed remotes, without an ack. Their
+     * message is held until the apply time the frame counts down to,
+     * measured from when the Wi-Fi task received it, so all controllers of
+     * a group change together however late their output task gets to it.
+     */
     class ControllerHandler final : public BLE::Service, public StateJsonFiller
     {
         static constexpr auto LOG_TAG = "ControllerEspNowHandler";
@@ -59,13 +129,98 @@ namespace EspNow
         static constexpr auto PREFERENCES_NAME = "esp-now";
         static constexpr auto PREFERENCES_COUNT_KEY = "devCount";
         static constexpr auto PREFERENCES_DATA_KEY = "devData";
+        static constexpr auto PREFERENCES_GROUPS_KEY = "groups";
+
+    public:
+        static constexpr size_t RECEIVE_QUEUE_SIZE = 16;
+        static constexpr size_t SCHEDULE_SIZE = 8;
+
+        using MessageCallback = InplaceFunction<void(const Message&)>;
+
+        struct DeliveryStats
+        {
+            uint32_t received = 0;
+            /** Repeats of a command already applied, acked again but not applied */
+            uint32_t duplicates = 0;
+            /** Frames the remote sent more than once */
+            uint32_t retried = 0;
+            /** Bare message types from remotes before frames, applied without an ack */
+            uint32_t legacy = 0;
+            uint32_t invalid = 0;
+            uint32_t acks = 0;
+            uint32_t ackFailures = 0;
+            /** Frames the Wi-Fi task found the receive queue full for */
+            uint32_t queueDropped = 0;
+            /** Most frames the receive queue held at once */
+            uint32_t queueHighWater = 0;
+            /** Group frames for a subscribed group, repeats included */
+            uint32_t group = 0;
+            /** Most a group command was applied after its apply time */
+            uint32_t maxApplyLagUs = 0;
+        };
+
+    private:
+        /** A frame as the Wi-Fi task got it; longer frames keep their length but not their bytes */
+        struct ReceivedFrame
+        {
+            std::array<uint8_t, Device::MAC_SIZE> mac = {};
+            uint16_t len = 0;
+            uint32_t receivedUs = 0;
+            std::array<uint8_t, std::max(sizeof(CommandFrame), sizeof(GroupFrame))> data = {};
+        };
+
+        /** A group command waiting for its apply time; output task only */
+        struct Scheduled
+        {
+            Message message;
+            uint32_t dueUs = 0;
+        };
+
+        /** Newest sequence applied per remote, at its position in the device list; output task only */
+        struct RemoteSequence
+        {
+            std::array<uint8_t, Device::MAC_SIZE> address = {};
+            uint32_t remoteId = 0;
+            uint16_t sequence = 0;
+            bool used = false;
+        };
 
+        // Guarded by getMutex()
         DeviceData deviceData = {};
+        /** Pages written over BLE so far, taken over with the last one */
+        DeviceData incomingDevices = {};
+        uint8_t nextReadPage = 0;
+
+        MacTable<DeviceData::MAX_DEVICES> allowlist;
+        std::array<RemoteSequence, DeviceData::MAX_DEVICES> sequences = {};
+        /** Bit n - 1 set for every group n subscribed to */
+        std::atomic<uint32_t> groups = 0;
+        std::array<Scheduled, SCHEDULE_SIZE> scheduled = {};
+        size_t scheduledCount = 0;
+        /** Remotes registered as ESP-NOW peers to be acked, least recently acked first; output task only */
+        std::array<std::array<uint8_t, Device::MAC_SIZE>, ESP_NOW_MAX_TOTAL_PEER_NUM> ackPeers = {};
+        size_t ackPeerCount = 0;
+
+        std::atomic<uint32_t> received = 0;
+        std::atomic<uint32_t> duplicates = 0;
+        std::atomic<uint32_t> retried = 0;
+        std::atomic<uint32_t> legacy = 0;
+        std::atomic<uint32_t> invalid = 0;
+        std::atomic<uint32_t> acks = 0;
+        std::atomic<uint32_t> ackFailures = 0;
+
+        SpscRing<ReceivedFrame, RECEIVE_QUEUE_SIZE> receiveQueue;
+        std::atomic<uint32_t> queueDropped = 0;
+        std::atomic<uint32_t> queueHighWater = 0;
+        std::atomic<uint32_t> group = 0;
+        std::atomic<uint32_t> maxApplyLagUs = 0;
+        MessageCallback messageCallback;
 
     public:
         void begin()
         {
             restoreDevices();
+            restoreGroups();
         }
 
         [[nodiscard]] DeviceData getDeviceData() const
@@ -78,30 +233,161 @@ namespace EspNow
         {
             std::lock_guard lock(getMutex());
             deviceData = data;
+            deviceData.deviceCount = std::min(deviceData.deviceCount, DeviceData::MAX_DEVICES);
+            updateAllowlist();
             persistDevices();
+            ChangeBus::publish(ChangeBus::Topic::EspNowDevices);
         }
 
-        bool isMacAllowed(const uint8_t* mac)
+        /** Any task, without a lock */
+        [[nodiscard]] bool isMacAllowed(const uint8_t* mac) const
+        {
+            return allowlist.find(mac).has_value();
+        }
+
+        /** Bit n - 1 for group n */
+        [[nodiscard]] uint32_t getGroups() const
+        {
+            return groups.load(std::memory_order_relaxed);
+        }
+
+        void setGroups(const uint32_t mask)
         {
-            std::lock_guard lock(getMutex());
-            for (uint8_t i = 0; i < deviceData.deviceCount; ++i)
             {
-                if (const auto& [name, address] = deviceData.devices[i];
-                    std::equal(address.begin(), address.end(), mac))
-                    return true;
+                std::lock_guard lock(getMutex());
+                if (groups.exchange(mask, std::memory_order_relaxed) == mask) return;
+                persistGroups(mask);
             }
-            return false;
+            ChangeBus::publish(ChangeBus::Topic::EspNowDevices);
         }
 
-        std::optional<Device> findDeviceByMac(const uint8_t* mac) const
+        [[nodiscard]] bool isSubscribed(const uint8_t group) const
         {
-            std::lock_guard lock(getMutex());
-            for (uint8_t i = 0; i < deviceData.deviceCount; ++i)
+            return group != 0 && group <= GroupFrame::MAX_GROUP && (getGroups() & 1u << (group - 1)) != 0;
+        }
+
+        /** Called for every fresh message, on the output task */
+        void onMessage(const MessageCallback& callback)
+        {
+            messageCallback = callback;
+        }
+
+        /** Receive callback on the Wi-Fi task: queues the frame without locking, logging or waiting */
+        void onDataReceived(const uint8_t* mac, const uint8_t* data, const int len)
+        {
+            if (len < 0) return;
+            ReceivedFrame frame;
+            std::copy_n(mac, frame.mac.size(), frame.mac.begin());
+            frame.len = static_cast<uint16_t>(len);
+            frame.receivedUs = micros();
+            std::copy_n(data, std::min<size_t>(len, frame.data.size()), frame.data.begin());
+            if (!receiveQueue.push(frame))
             {
-                if (const auto& device = deviceData.devices[i];
-                    std::equal(device.address.begin(), device.address.end(), mac))
-                    return device;
+                queueDropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (const uint32_t depth = receiveQueue.size(); depth > queueHighWater.load(std::memory_order_relaxed))
+                queueHighWater.store(depth, std::memory_order_relaxed);
+            EventLoop::wake(EventLoop::Task::Output);
+        }
+
+        /**
+         * Output task: handles every queued frame and applies the group
+         * commands that are due; new frames wake the task themselves.
+         */
+        void handle(const unsigned long)
+        {
+            while (const auto frame = receiveQueue.front())
+            {
+                const auto& mac = frame->mac;
+                ESP_LOGD(LOG_TAG, "Data received from %02X:%02X:%02X:%02X:%02X:%02X, length: %u",
+                         mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], frame->len);
+                if (const auto message = receive(mac.data(), frame->data.data(), frame->len, frame->receivedUs);
+                    message && messageCallback)
+                    messageCallback(message.value());
+                receiveQueue.pop();
+            }
+            const auto nowUs = static_cast<uint32_t>(micros());
+            while (scheduledCount != 0 && !isBefore(nowUs, scheduled[0].dueUs))
+                applyScheduled(nowUs);
+        }
+
+        /** Output task; wakes it for the next group command due */
+        void schedule(EventLoop::Deadline& next) const
+        {
+            if (scheduledCount == 0) return;
+            const auto remainingUs = static_cast<int32_t>(scheduled[0].dueUs - static_cast<uint32_t>(micros()));
+            next.in(remainingUs > 0 ? (remainingUs + 999) / 1000 : 0);
+        }
+
+        /**
+         * Decodes a frame, dropping it unless the remote is allowed. Command
+         * frames are acked, repeats included, and the message comes back only
+         * the first time its sequence number is seen. Group frames never come
+         * back; their message waits for handle() to apply it on time.
+         */
+        std::optional<Message> receive(const uint8_t* mac, const uint8_t* data, const size_t len,
+                                       const uint32_t receivedUs = micros())
+        {
+            if (len == sizeof(GroupFrame))
+            {
+                receiveGroup(mac, data, receivedUs);
+                return std::nullopt;
+            }
+
+            const auto position = allowlist.find(mac);
+            if (!position)
+            {
+                ESP_LOGW(LOG_TAG, "MAC address not allowed, ignoring packet");
+                return std::nullopt;
+            }
+
+            if (len == sizeof(Message::Type))
+            {
+                legacy.fetch_add(1, std::memory_order_relaxed);
+                return Message{static_cast<Message::Type>(data[0])};
             }
+
+            CommandFrame frame;
+            if (len != sizeof(frame))
+                return rejectFrame(len);
+            std::memcpy(&frame, data, sizeof(frame));
+            if (frame.header.version != FrameHeader::VERSION || frame.header.kind != FrameHeader::Kind::Command)
+                return rejectFrame(len);
+
+            received.fetch_add(1, std::memory_order_relaxed);
+            if (frame.header.attempt != 0)
+                retried.fetch_add(1, std::memory_order_relaxed);
+            const bool fresh = acceptSequence(sequences[position.value()], mac, frame.header);
+            acknowledge(mac, frame.header);
+            if (fresh)
+                return frame.message;
+            duplicates.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+
+        [[nodiscard]] DeliveryStats getDeliveryStats() const
+        {
+            return {
+                received.load(std::memory_order_relaxed),
+                duplicates.load(std::memory_order_relaxed),
+                retried.load(std::memory_order_relaxed),
+                legacy.load(std::memory_order_relaxed),
+                invalid.load(std::memory_order_relaxed),
+                acks.load(std::memory_order_relaxed),
+                ackFailures.load(std::memory_order_relaxed),
+                queueDropped.load(std::memory_order_relaxed),
+                queueHighWater.load(std::memory_order_relaxed),
+                group.load(std::memory_order_relaxed),
+                maxApplyLagUs.load(std::memory_order_relaxed)
+            };
+        }
+
+        std::optional<Device> findDeviceByMac(const uint8_t* mac) const
+        {
+            std::lock_guard lock(getMutex());
+            if (const auto position = allowlist.find(mac))
+                return deviceData.devices[position.value()];
             return std::nullopt;
         }
 
@@ -118,41 +404,57 @@ namespace EspNow
             return std::nullopt;
         }
 
-        [[nodiscard]] std::vector<uint8_t> getDevicesBuffer()
+        /** Each BLE read returns the next page, starting over after the last one */
+        [[nodiscard]] std::vector<uint8_t> readDevicesPage()
         {
             std::lock_guard lock(getMutex());
-            std::vector<uint8_t> buffer;
-            buffer.reserve(1 + deviceData.deviceCount * sizeof(Device));
-            buffer.push_back(deviceData.deviceCount);
-            for (const auto& [name, address] : deviceData.devices)
-            {
-                buffer.insert(buffer.end(), name.begin(), name.end());
-                buffer.insert(buffer.end(), address.begin(), address.end());
-            }
-            return buffer;
+            if (nextReadPage >= DevicePage::pageCount(deviceData))
+                nextReadPage = 0;
+            const auto page = DevicePage::of(deviceData, nextReadPage++);
+            if (nextReadPage == DevicePage::pageCount(deviceData))
+                nextReadPage = 0;
+            const auto bytes = reinterpret_cast<const uint8_t*>(&page);
+            return {bytes, bytes + page.size()};
         }
 
-        void setDevicesBuffer(const uint8_t* data, const size_t length)
+        /**
+         * Collects the pages of a BLE write and takes the list over once the
+         * page reaching its total arrived. A page out of order drops what was
+         * collected so far.
+         */
+        void writeDevicesPage(const uint8_t* data, const size_t length)
         {
-            if (!data || length < 1) return;
+            if (!data || length < DevicePage::HEADER_SIZE) return;
 
-            const uint8_t count = data[0];
-            if (const size_t expectedSize = 1 + count * sizeof(Device);
-                length < expectedSize)
+            DevicePage page;
+            std::memcpy(static_cast<void*>(&page), data, DevicePage::HEADER_SIZE);
+            if (page.total > DeviceData::MAX_DEVICES || page.count > DevicePage::PAGE_SIZE ||
+                page.start + page.count > page.total || length < page.size())
+            {
+                ESP_LOGW(LOG_TAG, "Ignoring malformed device page of %u bytes", static_cast<unsigned>(length));
                 return;
+            }
+            std::memcpy(page.devices.data(), data + DevicePage::HEADER_SIZE, page.count * sizeof(Device));
 
-            DeviceData newData = {};
-            newData.deviceCount = std::min(count, DeviceData::MAX_DEVICES_PER_MESSAGE);
-
-            for (uint8_t i = 0; i < newData.deviceCount; ++i)
+            DeviceData complete;
             {
-                const size_t offset = 1 + i * sizeof(Device);
-                std::copy_n(&data[offset], Device::NAME_TOTAL_LENGTH, newData.devices[i].name.begin());
-                std::copy_n(&data[offset + Device::NAME_TOTAL_LENGTH], Device::MAC_SIZE,
-                            newData.devices[i].address.begin());
+                std::lock_guard lock(getMutex());
+                if (page.start != 0 && (page.start != incomingDevices.deviceCount))
+                {
+                    ESP_LOGW(LOG_TAG, "Device page at %u out of order, expected %u", page.start,
+                             incomingDevices.deviceCount);
+                    incomingDevices = {};
+                    return;
+                }
+                if (page.start == 0)
+                    incomingDevices = {};
+                std::copy_n(page.devices.begin(), page.count, incomingDevices.devices.begin() + page.start);
+                incomingDevices.deviceCount = page.start + page.count;
+                if (incomingDevices.deviceCount != page.total) return;
+                complete = incomingDevices;
+                incomingDevices = {};
             }
-
-            setDeviceData(newData);
+            setDeviceData(complete);
         }
 
         void createServiceAndCharacteristics(NimBLEServer* server) override
@@ -162,6 +464,10 @@ namespace EspNow
                 BLE::UUID::ESP_NOW_REMOTES_CHARACTERISTIC,
                 READ | WRITE
             )->setCallbacks(new EspNowDevicesCallback(this));
+            bleService->createCharacteristic(
+                BLE::UUID::ESP_NOW_GROUPS_CHARACTERISTIC,
+                READ | WRITE
+            )->setCallbacks(new EspNowGroupsCallback(this));
             bleService->start();
         }
 
@@ -175,7 +481,7 @@ namespace EspNow
             const auto espNow = root["espNow"].to<JsonObject>();
             const auto arr = espNow["devices"].to<JsonArray>();
             std::lock_guard lock(getMutex());
-            for (uint8_t i = 0; i < deviceData.deviceCount && i < DeviceData::MAX_DEVICES_PER_MESSAGE; ++i)
+            for (uint8_t i = 0; i < deviceData.deviceCount && i < DeviceData::MAX_DEVICES; ++i)
             {
                 const auto& [name, mac] = deviceData.devices[i];
                 char macStr[18];
@@ -186,15 +492,181 @@ namespace EspNow
                 obj["name"] = name.data();
                 obj["address"] = macStr;
             }
+
+            const auto subscribed = espNow["groups"].to<JsonArray>();
+            for (uint8_t group = 1; group <= GroupFrame::MAX_GROUP; ++group)
+                if (isSubscribed(group))
+                    subscribed.add(group);
+
+            const auto stats = getDeliveryStats();
+            const auto delivery = espNow["delivery"].to<JsonObject>();
+            delivery["received"] = stats.received;
+            delivery["duplicates"] = stats.duplicates;
+            delivery["retried"] = stats.retried;
+            delivery["legacy"] = stats.legacy;
+            delivery["invalid"] = stats.invalid;
+            delivery["acks"] = stats.acks;
+            delivery["ackFailures"] = stats.ackFailures;
+            delivery["queueDropped"] = stats.queueDropped;
+            delivery["queueHighWater"] = stats.queueHighWater;
+            delivery["group"] = stats.group;
+            delivery["maxApplyLagUs"] = stats.maxApplyLagUs;
+        }
+
+        [[nodiscard]] const char* getStateFields() const override
+        {
+            return "espNow";
+        }
+
+        [[nodiscard]] ChangeBus::Mask getStateTopics() const override
+        {
+            return ChangeBus::maskOf(ChangeBus::Topic::EspNowDevices);
         }
 
     private:
+        std::nullopt_t rejectFrame(const size_t len)
+        {
+            invalid.fetch_add(1, std::memory_order_relaxed);
+            ESP_LOGW(LOG_TAG, "Ignoring ESP-NOW frame of %u bytes", static_cast<unsigned>(len));
+            return std::nullopt;
+        }
+
+        /**
+         * Output task. Frames from remotes not allowed here or for groups not
+         * subscribed to are what broadcasts bring, so they go unlogged.
+         */
+        void receiveGroup(const uint8_t* mac, const uint8_t* data, const uint32_t receivedUs)
+        {
+            GroupFrame frame;
+            std::memcpy(&frame, data, sizeof(frame));
+            if (frame.header.version != FrameHeader::VERSION || frame.header.kind != FrameHeader::Kind::GroupCommand)
+            {
+                rejectFrame(sizeof(frame));
+                return;
+            }
+            const auto position = allowlist.find(mac);
+            if (!position || !isSubscribed(frame.group)) return;
+
+            group.fetch_add(1, std::memory_order_relaxed);
+            if (!acceptSequence(sequences[position.value()], mac, frame.header)) return;
+            scheduleMessage(frame.message, receivedUs + std::min(frame.applyInUs, GroupFrame::MAX_APPLY_IN_US));
+        }
+
+        /** Output task; keeps the schedule ordered by due time, applying the earliest early when it is full */
+        void scheduleMessage(const Message& message, const uint32_t dueUs)
+        {
+            if (scheduledCount == scheduled.size())
+            {
+                ESP_LOGW(LOG_TAG, "%u group commands waiting, applying one early",
+                         static_cast<unsigned>(SCHEDULE_SIZE));
+                applyScheduled(dueUs);
+            }
+            auto i = scheduledCount++;
+            for (; i > 0 && isBefore(dueUs, scheduled[i - 1].dueUs); --i)
+                scheduled[i] = scheduled[i - 1];
+            scheduled[i] = {message, dueUs};
+        }
+
+        /** Output task; applies the earliest scheduled command */
+        void applyScheduled(const uint32_t nowUs)
+        {
+            const auto entry = scheduled[0];
+            std::copy(scheduled.begin() + 1, scheduled.begin() + scheduledCount, scheduled.begin());
+            --scheduledCount;
+            if (const auto lag = static_cast<int32_t>(nowUs - entry.dueUs);
+                lag > 0 && static_cast<uint32_t>(lag) > maxApplyLagUs.load(std::memory_order_relaxed))
+                maxApplyLagUs.store(lag, std::memory_order_relaxed);
+            if (messageCallback)
+                messageCallback(entry.message);
+        }
+
+        static bool isBefore(const uint32_t time, const uint32_t other)
+        {
+            return static_cast<int32_t>(time - other) < 0;
+        }
+
+        /**
+         * Whether the sequence is newer than the last one applied for the
+         * remote. A new remote id means the remote restarted, and a slot
+         * found holding another address means the device list changed.
+         */
+        static bool acceptSequence(RemoteSequence& slot, const uint8_t* mac, const FrameHeader& header)
+        {
+            if (!std::equal(slot.address.begin(), slot.address.end(), mac))
+            {
+                std::copy_n(mac, slot.address.size(), slot.address.begin());
+                slot.used = false;
+            }
+            if (slot.used && slot.remoteId == header.remoteId &&
+                static_cast<int16_t>(header.sequence - slot.sequence) <= 0)
+                return false;
+            slot.used = true;
+            slot.remoteId = header.remoteId;
+            slot.sequence = header.sequence;
+            return true;
+        }
+
+        void acknowledge(const uint8_t* mac, FrameHeader header)
+        {
+            header.kind = FrameHeader::Kind::Ack;
+            const AckFrame ack{header};
+            if (addAckPeer(mac) && esp_now_send(mac, reinterpret_cast<const uint8_t*>(&ack), sizeof(ack)) == ESP_OK)
+            {
+                acks.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            ackFailures.fetch_add(1, std::memory_order_relaxed);
+            ESP_LOGW(LOG_TAG, "Failed to ack ESP-NOW command %u", header.sequence);
+        }
+
+        /**
+         * Makes the remote an ESP-NOW peer so it can be acked. ESP-NOW takes
+         * at most ESP_NOW_MAX_TOTAL_PEER_NUM peers, fewer than remotes may be
+         * allowed or pass through since boot, so the remote acked longest ago
+         * makes room.
+         */
+        bool addAckPeer(const uint8_t* mac)
+        {
+            std::array<uint8_t, Device::MAC_SIZE> address;
+            std::copy_n(mac, address.size(), address.begin());
+            const auto end = ackPeers.begin() + ackPeerCount;
+            if (const auto known = std::find(ackPeers.begin(), end, address); known != end)
+            {
+                std::rotate(known, known + 1, end);
+                return true;
+            }
+            if (ackPeerCount == ackPeers.size())
+                dropOldestAckPeer();
+            // Peers added by anyone else take room too
+            while (!addPeer(mac))
+            {
+                if (ackPeerCount == 0) return false;
+                dropOldestAckPeer();
+            }
+            ackPeers[ackPeerCount++] = address;
+            return true;
+        }
+
+        void dropOldestAckPeer()
+        {
+            esp_now_del_peer(ackPeers[0].data());
+            std::rotate(ackPeers.begin(), ackPeers.begin() + 1, ackPeers.begin() + ackPeerCount);
+            --ackPeerCount;
+        }
+
         static std::mutex& getMutex()
         {
             static std::mutex mutex;
             return mutex;
         }
 
+        /** Guarded by getMutex(), which keeps the allowlist to one writer */
+        void updateAllowlist()
+        {
+            allowlist.assign(deviceData.deviceCount,
+                             [this](const size_t i) { return deviceData.devices[i].address.data(); });
+        }
+
         void persistDevices() const
         {
             if (Preferences prefs; prefs.begin(PREFERENCES_NAME, false))
@@ -211,11 +683,40 @@ namespace EspNow
             }
         }
 
+        static void persistGroups(const uint32_t mask)
+        {
+            if (Preferences prefs; prefs.begin(PREFERENCES_NAME, false))
+            {
+                prefs.putUInt(PREFERENCES_GROUPS_KEY, mask);
+                prefs.end();
+                ESP_LOGI(LOG_TAG, "Groups saved to Preferences");
+            }
+            else
+            {
+                ESP_LOGE(LOG_TAG, "Failed to open Preferences for saving");
+            }
+        }
+
+        void restoreGroups()
+        {
+            if (Preferences prefs; prefs.begin(PREFERENCES_NAME, true))
+            {
+                groups.store(prefs.getUInt(PREFERENCES_GROUPS_KEY, 0), std::memory_order_relaxed);
+                prefs.end();
+            }
+            else
+            {
+                ESP_LOGE(LOG_TAG, "Failed to open Preferences for reading");
+            }
+        }
+
         void restoreDevices()
         {
             if (Preferences prefs; prefs.begin(PREFERENCES_NAME, true))
             {
-                deviceData.deviceCount = prefs.getUInt(PREFERENCES_COUNT_KEY, 0);
+                std::lock_guard lock(getMutex());
+                deviceData.deviceCount = std::min<uint32_t>(prefs.getUInt(PREFERENCES_COUNT_KEY, 0),
+                                                            DeviceData::MAX_DEVICES);
                 if (const auto dataSize = deviceData.deviceCount * sizeof(Device);
                     prefs.getBytesLength(PREFERENCES_DATA_KEY) == dataSize)
                 {
@@ -223,6 +724,11 @@ namespace EspNow
                     prefs.getBytes(PREFERENCES_DATA_KEY, deviceData.devices.data(), dataSize);
                     ESP_LOGI(LOG_TAG, "Devices restored from Preferences");
                 }
+                else
+                {
+                    deviceData.deviceCount = 0;
+                }
+                updateAllowlist();
                 prefs.end();
             }
             else
@@ -244,14 +750,41 @@ namespace EspNow
             void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override
             {
                 const auto value = pCharacteristic->getValue();
-                espNowHandler->setDevicesBuffer(value.data(), value.size());
+                espNowHandler->writeDevicesPage(value.data(), value.size());
             }
 
             void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override
             {
-                const auto value = espNowHandler->getDevicesBuffer();
+                const auto value = espNowHandler->readDevicesPage();
                 pCharacteristic->setValue(value.data(), value.size());
             }
         };
+
+        /** The subscribed groups as a little-endian 32-bit mask */
+        class EspNowGroupsCallback final : public NimBLECharacteristicCallbacks
+        {
+            ControllerHandler* espNowHandler;
+
+        public:
+            explicit EspNowGroupsCallback(ControllerHandler* espNowHandler)
+                : espNowHandler(espNowHandler)
+            {
+            }
+
+            void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override
+            {
+                const auto value = pCharacteristic->getValue();
+                if (value.size() != sizeof(uint32_t)) return;
+                uint32_t mask;
+                std::memcpy(&mask, value.data(), sizeof(mask));
+                espNowHandler->setGroups(mask);
+            }
+
+            void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override
+            {
+                const auto mask = espNowHandler->getGroups();
+                pCharacteristic->setValue(reinterpret_cast<const uint8_t*>(&mask), sizeof(mask));
+            }
+        };
     };
 }
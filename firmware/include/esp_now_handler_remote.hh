@@ -1,6 +1,9 @@
 #pragma once
 
 #include <array>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <mutex>
 #include <esp_now.h>
 #include <algorithm>
@@ -8,11 +11,36 @@
 #include <NimBLEServer.h>
 
 #include "ble_service.hh"
+#include "change_bus.hh"
 #include "esp_now_handler.hh"
+#include "event_loop.hh"
 #include "state_json_filler.hh"
 
 namespace EspNow
 {
+    /**
+     * Sends commands to the paired controller and makes sure each arrives
+     * once.
+     *
+     * Commands are numbered and queued, and only the oldest is in flight: it
+     * is sent again when the send callback reports it lost or no ack came
+     * within ACK_TIMEOUT_MS, and given up after MAX_ATTEMPTS. The controller
+     * acks repeats as well but applies each sequence number only once, so a
+     * lost ack never toggles twice. send() may be called from any task;
+     * onDataSent() and onDataReceived() run on the Wi-Fi task, and retries
+     * go out from handle().
+     *
+     * Knob detents are summed for STEP_WINDOW_MS and sent as one
+     * StepBrightness, and steps still waiting behind the command in flight
+     * take in later ones, so a fast spin costs a few frames instead of one
+     * per detent.
+     *
+     * With a group set, commands are broadcast to every controller of the
+     * group instead. A dozen acks would only collide, so each frame is sent
+     * GROUP_REPEATS times, GROUP_REPEAT_MS apart, and tells the controllers
+     * to apply it GROUP_APPLY_DELAY_US after its first transmission, which
+     * leaves room for the repeats to land.
+     */
     class RemoteHandler final : public BLE::Service, public StateJsonFiller
     {
         static constexpr auto LOG_TAG = "RemoteEspNowHandler";
@@ -21,19 +49,161 @@ namespace EspNow
 
         static constexpr auto PREFERENCES_NAME = "esp-now";
         static constexpr auto PREFERENCES_KEY = "controller";
+        static constexpr auto PREFERENCES_GROUP_KEY = "group";
+
+    public:
+        static constexpr uint8_t MAX_PENDING = 8;
+        static constexpr uint8_t MAX_ATTEMPTS = 5;
+        static constexpr unsigned long ACK_TIMEOUT_MS = 30;
+        static constexpr unsigned long STEP_WINDOW_MS = 40;
+        static constexpr uint8_t GROUP_REPEATS = 3;
+        static constexpr unsigned long GROUP_REPEAT_MS = 8;
+        static constexpr uint32_t GROUP_APPLY_DELAY_US = 30000;
+
+        struct DeliveryStats
+        {
+            uint32_t sent = 0;
+            uint32_t delivered = 0;
+            uint32_t retries = 0;
+            /** Gave up after MAX_ATTEMPTS */
+            uint32_t failed = 0;
+            /** Not queued because MAX_PENDING commands were waiting already */
+            uint32_t dropped = 0;
+            /** Knob detents, which share StepBrightness commands */
+            uint32_t steps = 0;
+            /** Group commands sent all GROUP_REPEATS times */
+            uint32_t broadcast = 0;
+            /** From the first transmission to the ack */
+            uint32_t lastLatencyUs = 0;
+            uint32_t maxLatencyUs = 0;
+        };
+
+    private:
+        struct Pending
+        {
+            CommandFrame frame;
+            uint32_t firstSentUs = 0;
+        };
 
         std::array<uint8_t, MAC_LENGTH> controllerAddress = {};
 
+        // All guarded by getMutex()
+        uint8_t group = 0;
+        uint32_t remoteId = 0;
+        uint16_t nextSequence = 0;
+        std::array<Pending, MAX_PENDING> pending = {};
+        uint8_t pendingHead = 0;
+        uint8_t pendingCount = 0;
+        bool inFlight = false;
+        bool sendFailed = false;
+        unsigned long lastSentMs = 0;
+        int16_t windowSteps = 0;
+        unsigned long windowStartMs = 0;
+        DeliveryStats stats;
+
     public:
-        void begin() const
+        /** Needs the radio up, which is what makes esp_random() truly random */
+        void begin()
         {
             restore();
+            std::lock_guard lock(getMutex());
+            remoteId = esp_random();
+        }
+
+        void send(const Message::Type type)
+        {
+            send(Message{type});
+        }
+
+        /**
+         * Queues a command and sends it right away unless an earlier one
+         * still waits for its ack. Detents summed so far go first, so the
+         * controller sees everything in the order it happened.
+         */
+        void send(const Message& message)
+        {
+            {
+                std::lock_guard lock(getMutex());
+                flushSteps();
+                queue(message);
+            }
+            transmit(false);
+        }
+
+        /** Adds knob detents, negative to dim; they go out once STEP_WINDOW_MS passed since the first */
+        void stepBrightness(const int8_t steps)
+        {
+            {
+                std::lock_guard lock(getMutex());
+                stats.steps += std::abs(steps);
+                const bool opensWindow = windowSteps == 0;
+                windowSteps += steps;
+                if (!opensWindow) return;
+                windowStartMs = millis();
+            }
+            EventLoop::wake();
+        }
+
+        void handle(const unsigned long now)
+        {
+            bool retry;
+            {
+                std::lock_guard lock(getMutex());
+                if (windowSteps != 0 && now - windowStartMs >= STEP_WINDOW_MS)
+                    flushSteps();
+                retry = inFlight && (sendFailed || now - lastSentMs >= retryAfterMs());
+                sendFailed = false;
+            }
+            transmit(retry);
+        }
+
+        void schedule(EventLoop::Deadline& next) const
+        {
+            std::lock_guard lock(getMutex());
+            if (windowSteps != 0)
+                next.at(windowStartMs + STEP_WINDOW_MS);
+            if (inFlight)
+                next.at(lastSentMs + retryAfterMs());
+            else if (pendingCount != 0)
+                next.in(0);
         }
 
-        void send(const Message::Type type) const
+        /** Send callback: a frame the radio could not deliver is retried without waiting for the timeout */
+        void onDataSent(const uint8_t*, const esp_now_send_status_t status)
         {
-            const Message message{type};
-            espNowSend(message);
+            if (status == ESP_NOW_SEND_SUCCESS) return;
+            {
+                std::lock_guard lock(getMutex());
+                if (!inFlight) return;
+                sendFailed = true;
+            }
+            EventLoop::wake();
+        }
+
+        /** Receive callback: an ack for the command in flight lets the next one go */
+        void onDataReceived(const uint8_t*, const uint8_t* data, const int len)
+        {
+            AckFrame ack;
+            if (len != sizeof(ack)) return;
+            std::memcpy(&ack, data, sizeof(ack));
+            if (ack.header.version != FrameHeader::VERSION || ack.header.kind != FrameHeader::Kind::Ack) return;
+            {
+                std::lock_guard lock(getMutex());
+                if (!inFlight || ack.header.remoteId != remoteId ||
+                    ack.header.sequence != pending[pendingHead].frame.header.sequence)
+                    return;
+                stats.lastLatencyUs = micros() - pending[pendingHead].firstSentUs;
+                stats.maxLatencyUs = std::max(stats.maxLatencyUs, stats.lastLatencyUs);
+                ++stats.delivered;
+                popPending();
+            }
+            EventLoop::wake();
+        }
+
+        [[nodiscard]] DeliveryStats getDeliveryStats() const
+        {
+            std::lock_guard lock(getMutex());
+            return stats;
         }
 
         [[nodiscard]] std::array<uint8_t, MAC_LENGTH> getControllerAddress() const
@@ -50,6 +220,26 @@ namespace EspNow
                 std::lock_guard lock(getMutex());
                 controllerAddress = address;
             }
+            ChangeBus::publish(ChangeBus::Topic::EspNowController);
+        }
+
+        /** 0 to send to the controller alone */
+        [[nodiscard]] uint8_t getGroup() const
+        {
+            std::lock_guard lock(getMutex());
+            return group;
+        }
+
+        void setGroup(const uint8_t value)
+        {
+            if (value > GroupFrame::MAX_GROUP) return;
+            {
+                std::lock_guard lock(getMutex());
+                if (group == value) return;
+                group = value;
+            }
+            persistGroup(value);
+            ChangeBus::publish(ChangeBus::Topic::EspNowController);
         }
 
         [[nodiscard]] bool hasControllerAddress() const
@@ -84,17 +274,32 @@ namespace EspNow
             }
         }
 
-        void restore() const
+        static void persistGroup(const uint8_t group)
+        {
+            if (Preferences prefs; prefs.begin(PREFERENCES_NAME, false))
+            {
+                prefs.putUChar(PREFERENCES_GROUP_KEY, group);
+                prefs.end();
+                ESP_LOGI(LOG_TAG, "Group saved to Preferences");
+            }
+            else
+            {
+                ESP_LOGE(LOG_TAG, "Failed to open Preferences for saving");
+            }
+        }
+
+        void restore()
         {
             if (Preferences prefs; prefs.begin(PREFERENCES_NAME, true))
             {
+                std::lock_guard lock(getMutex());
                 if (const auto dataSize = prefs.getBytesLength(PREFERENCES_KEY);
                     dataSize == MAC_LENGTH)
                 {
-                    std::lock_guard lock(getMutex());
-                    prefs.getBytes(PREFERENCES_KEY, const_cast<uint8_t*>(controllerAddress.data()), dataSize);
+                    prefs.getBytes(PREFERENCES_KEY, controllerAddress.data(), dataSize);
                     ESP_LOGI(LOG_TAG, "Devices restored from Preferences");
                 }
+                group = std::min<uint8_t>(prefs.getUChar(PREFERENCES_GROUP_KEY, 0), GroupFrame::MAX_GROUP);
                 prefs.end();
             }
             else
@@ -103,44 +308,141 @@ namespace EspNow
             }
         }
 
+        /** A peer that could not be added makes the send fail, which the retries already cover */
         static void espNowAddPeer(const std::array<uint8_t, MAC_LENGTH>& address)
         {
-            if (!esp_now_is_peer_exist(address.data()))
-            {
-                esp_now_peer_info_t peerInfo = {
-                    .peer_addr = {},
-                    .lmk = {},
-                    .channel = 0,
-                    .ifidx = WIFI_IF_STA,
-                    .encrypt = false,
-                    .priv = nullptr,
-                };
-                std::copy_n(address.begin(), address.size(), peerInfo.peer_addr);
-                if (esp_now_add_peer(&peerInfo) != ESP_OK)
+            addPeer(address.data());
+        }
+
+        /**
+         * Guarded by getMutex(). Steps join a StepBrightness that is queued
+         * but not sent yet, as long as the sum still fits.
+         */
+        void queue(const Message& message)
+        {
+            if (message.type == Message::Type::StepBrightness && pendingCount > (inFlight ? 1 : 0))
+            {
+                auto& tail = pending[(pendingHead + pendingCount - 1) % MAX_PENDING].frame.message;
+                if (const auto sum = tail.steps + message.steps;
+                    tail.type == Message::Type::StepBrightness &&
+                    sum >= std::numeric_limits<int8_t>::min() && sum <= std::numeric_limits<int8_t>::max())
+                {
+                    tail.steps = static_cast<int8_t>(sum);
+                    return;
+                }
+            }
+            if (pendingCount == MAX_PENDING)
+            {
+                ++stats.dropped;
+                ESP_LOGW(LOG_TAG, "%u commands waiting for the controller, dropping one", MAX_PENDING);
+                return;
+            }
+            auto& entry = pending[(pendingHead + pendingCount++) % MAX_PENDING];
+            entry.frame = {{FrameHeader::VERSION, FrameHeader::Kind::Command, remoteId, nextSequence++}, message};
+            ++stats.sent;
+        }
+
+        /** Guarded by getMutex(); queues the detents of the window, clamped to what one command holds */
+        void flushSteps()
+        {
+            if (windowSteps == 0) return;
+            queue(Message::stepBrightness(static_cast<int8_t>(std::clamp<int16_t>(
+                windowSteps, std::numeric_limits<int8_t>::min(), std::numeric_limits<int8_t>::max()))));
+            windowSteps = 0;
+        }
+
+        /** Guarded by getMutex(); a group command is repeated on time instead of waiting for an ack */
+        [[nodiscard]] unsigned long retryAfterMs() const
+        {
+            return group != 0 ? GROUP_REPEAT_MS : ACK_TIMEOUT_MS;
+        }
+
+        /** Guarded by getMutex() */
+        void popPending()
+        {
+            pendingHead = (pendingHead + 1) % MAX_PENDING;
+            --pendingCount;
+            inFlight = false;
+        }
+
+        /**
+         * Sends the oldest pending command unless it is in flight already.
+         * A retry sends it again, or gives it up after MAX_ATTEMPTS and moves
+         * on; a group command is done after GROUP_REPEATS. The radio is
+         * driven outside the lock, since the send callback takes it as well.
+         */
+        void transmit(const bool retry)
+        {
+            CommandFrame frame;
+            std::array<uint8_t, MAC_LENGTH> address;
+            uint8_t sendGroup;
+            uint32_t applyInUs = 0;
+            {
+                std::lock_guard lock(getMutex());
+                if (retry && inFlight && group != 0)
                 {
-                    esp_now_deinit();
-                    if (esp_now_init() == ESP_OK)
+                    if (auto& header = pending[pendingHead].frame.header; header.attempt + 1 < GROUP_REPEATS)
                     {
-                        ESP_LOGW(LOG_TAG, "ESP-NOW reinitialized defensively");
-                        esp_now_add_peer(&peerInfo);
+                        ++header.attempt;
+                        inFlight = false;
                     }
                     else
                     {
-                        ESP_LOGE(LOG_TAG, "Failed to recover ESP-NOW");
+                        ++stats.broadcast;
+                        popPending();
                     }
                 }
+                else if (retry && inFlight)
+                {
+                    if (auto& header = pending[pendingHead].frame.header; header.attempt + 1 < MAX_ATTEMPTS)
+                    {
+                        ++header.attempt;
+                        ++stats.retries;
+                        inFlight = false;
+                    }
+                    else
+                    {
+                        ++stats.failed;
+                        ESP_LOGW(LOG_TAG, "No ack for command %u after %u attempts, giving up",
+                                 header.sequence, MAX_ATTEMPTS);
+                        popPending();
+                    }
+                }
+                if (inFlight || pendingCount == 0) return;
+
+                auto& head = pending[pendingHead];
+                if (head.frame.header.attempt == 0)
+                    head.firstSentUs = micros();
+                inFlight = true;
+                lastSentMs = millis();
+                frame = head.frame;
+                sendGroup = group;
+                if (sendGroup != 0)
+                {
+                    const uint32_t elapsedUs = micros() - head.firstSentUs;
+                    applyInUs = elapsedUs < GROUP_APPLY_DELAY_US ? GROUP_APPLY_DELAY_US - elapsedUs : 0;
+                    address = BROADCAST_ADDRESS;
+                }
                 else
                 {
-                    ESP_LOGI(LOG_TAG, "Peer added successfully");
+                    address = controllerAddress;
                 }
             }
+            espNowAddPeer(address);
+            if (sendGroup == 0)
+            {
+                espNowSend(address, frame);
+                return;
+            }
+            auto header = frame.header;
+            header.kind = FrameHeader::Kind::GroupCommand;
+            espNowSend(address, GroupFrame{header, sendGroup, applyInUs, frame.message});
         }
 
-        void espNowSend(const Message& message) const
+        template <typename Frame>
+        static void espNowSend(const std::array<uint8_t, MAC_LENGTH>& address, const Frame& frame)
         {
-            std::lock_guard lock(getMutex());
-            espNowAddPeer(controllerAddress);
-            switch (esp_now_send(controllerAddress.data(), reinterpret_cast<const uint8_t*>(&message), sizeof(message)))
+            switch (esp_now_send(address.data(), reinterpret_cast<const uint8_t*>(&frame), sizeof(frame)))
             {
             case ESP_ERR_ESPNOW_NOT_INIT:
                 ESP_LOGE(LOG_TAG, "ESPNOW is not initialized");
@@ -162,7 +464,7 @@ namespace EspNow
                 ESP_LOGE(LOG_TAG, "Current WiFi interface doesn't match that of peer");
                 break;
             default:
-                ESP_LOGI(LOG_TAG, "Message sent successfully");
+                ESP_LOGD(LOG_TAG, "Command %u sent, attempt %u", frame.header.sequence, frame.header.attempt + 1);
                 break;
             }
         }
@@ -175,6 +477,29 @@ namespace EspNow
             snprintf(macString, sizeof(macString), "%02X:%02X:%02X:%02X:%02X:%02X",
                      address[0], address[1], address[2], address[3], address[4], address[5]);
             espNow["controllerAddress"] = macString;
+            espNow["group"] = getGroup();
+
+            const auto stats = getDeliveryStats();
+            const auto delivery = espNow["delivery"].to<JsonObject>();
+            delivery["sent"] = stats.sent;
+            delivery["delivered"] = stats.delivered;
+            delivery["retries"] = stats.retries;
+            delivery["failed"] = stats.failed;
+            delivery["dropped"] = stats.dropped;
+            delivery["steps"] = stats.steps;
+            delivery["broadcast"] = stats.broadcast;
+            delivery["lastLatencyUs"] = stats.lastLatencyUs;
+            delivery["maxLatencyUs"] = stats.maxLatencyUs;
+        }
+
+        [[nodiscard]] const char* getStateFields() const override
+        {
+            return "espNow";
+        }
+
+        [[nodiscard]] ChangeBus::Mask getStateTopics() const override
+        {
+            return ChangeBus::maskOf(ChangeBus::Topic::EspNowController);
         }
 
         void clearServiceAndCharacteristics() override
@@ -189,6 +514,10 @@ namespace EspNow
                 BLE::UUID::ESP_NOW_CONTROLLER_CHARACTERISTIC,
                 READ | WRITE
             )->setCallbacks(new EspNowControllerCallback(*this));
+            bleService->createCharacteristic(
+                BLE::UUID::ESP_NOW_GROUP_CHARACTERISTIC,
+                READ | WRITE
+            )->setCallbacks(new EspNowGroupCallback(*this));
             bleService->start();
         }
 
@@ -216,5 +545,30 @@ namespace EspNow
                 pCharacteristic->setValue(address.data(), address.size());
             }
         };
+
+        /** One byte, the group to broadcast to or 0 */
+        class EspNowGroupCallback final : public NimBLECharacteristicCallbacks
+        {
+            RemoteHandler& espNowHandler;
+
+        public:
+            explicit EspNowGroupCallback(RemoteHandler& espNowHandler)
+                : espNowHandler(espNowHandler)
+            {
+            }
+
+            void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override
+            {
+                const auto value = pCharacteristic->getValue();
+                if (value.size() != sizeof(uint8_t)) return;
+                espNowHandler.setGroup(value.data()[0]);
+            }
+
+            void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override
+            {
+                const uint8_t group = espNowHandler.getGroup();
+                pCharacteristic->setValue(&group, sizeof(group));
+            }
+        };
     };
 }
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <Arduino.h>
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+#include <freertos/FreeRTOS.h> // NOLINT
+#include <freertos/task.h>
+
+#if CONFIG_PM_ENABLE
+#include <esp_idf_version.h>
+#include <esp_pm.h>
+#endif
+
+#include "change_bus.hh"
+
+/**
+ * Lets loop() block until the earliest deadline any component has, instead
+ * of polling everything every millisecond.
+ *
+ * After handling, each component adds the time it next has work to a
+ * Deadline and the loop waits on a task notification until then. Change
+ * bus publishes notify the loop, so anything reported through the bus is
+ * handled right away; sources that bypass it (GPIO edges, realtime frames,
+ * BLE connections, async writes finishing) call wake() themselves.
+ *
+ * While the loop is blocked the idle task runs, which is what lets
+ * FreeRTOS tickless idle, frequency scaling and automatic light sleep kick
+ * in on builds with CONFIG_PM_ENABLE. Anything that must keep running,
+ * like a lit PWM output, holds a SleepLock.
+ *
+ * The controller runs two such loops, see Task; firmware with a single
+ * loop only uses Task::Service, and anything aimed at a task without a
+ * loop of its own goes to the service loop instead.
+ */
+namespace EventLoop
+{
+    static constexpr auto LOG_TAG = "EventLoop";
+
+    /** Longest wait, so a missed wake-up costs latency but never stalls a component */
+    static constexpr unsigned long MAX_WAIT_MS = 1000;
+    /** Lowest CPU clock for frequency scaling; 80 MHz keeps APB, and the LEDC PWM, at full speed */
+    static constexpr uint32_t MIN_CPU_FREQ_MHZ = 80;
+
+    enum class Task : uint8_t
+    {
+        /** Network, storage and everything reported through the change bus */
+        Service,
+        /** Inputs and PWM, kept clear of anything that may block */
+        Output,
+        COUNT
+    };
+
+    /** Collects the earliest time, relative to one loop pass, a component needs the loop again */
+    class Deadline
+    {
+        const unsigned long now;
+        unsigned long remaining = MAX_WAIT_MS;
+
+    public:
+        explicit Deadline(const unsigned long now) : now(now)
+        {
+        }
+
+        /** Work is due at the given millis(); times in the past mean right away */
+        void at(const unsigned long time)
+        {
+            const auto delta = static_cast<long>(time - now);
+            in(delta > 0 ? static_cast<unsigned long>(delta) : 0);
+        }
+
+        /** Work is due in the given number of milliseconds */
+        void in(const unsigned long ms)
+        {
+            remaining = std::min(remaining, ms);
+        }
+
+        /** Work is due when a window of `length` ms opened at `start` closes; nothing once it has */
+        void afterWindow(const unsigned long start, const unsigned long length)
+        {
+            if (const auto elapsed = now - start; elapsed < length)
+                in(length - elapsed);
+        }
+
+        [[nodiscard]] unsigned long getRemaining() const
+        {
+            return remaining;
+        }
+    };
+
+    /**
+     * Keeps automatic light sleep off while held. Every holder counts on
+     * its own, so each can hold and release independently.
+     */
+    class SleepLock
+    {
+        bool held = false;
+
+#if CONFIG_PM_ENABLE
+        static esp_pm_lock_handle_t getHandle()
+        {
+            static esp_pm_lock_handle_t handle = []
+            {
+                esp_pm_lock_handle_t lock = nullptr;
+                if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "loop", &lock) != ESP_OK)
+                    ESP_LOGE(LOG_TAG, "Failed to create sleep lock");
+                return lock;
+            }();
+            return handle;
+        }
+#endif
+
+    public:
+        SleepLock() = default;
+        SleepLock(const SleepLock&) = delete;
+        SleepLock& operator=(const SleepLock&) = delete;
+
+        ~SleepLock()
+        {
+            hold(false);
+        }
+
+        void hold(const bool hold)
+        {
+            if (hold == held) return;
+            held = hold;
+#if CONFIG_PM_ENABLE
+            if (const auto handle = getHandle())
+                hold ? esp_pm_lock_acquire(handle) : esp_pm_lock_release(handle);
+#endif
+        }
+    };
+
+    class Scheduler
+    {
+        std::atomic<TaskHandle_t> task = nullptr;
+#if CONFIG_PM_ENABLE
+        /** Held while the loop is busy, so frequency scaling only slows down the waits */
+        esp_pm_lock_handle_t busyLock = nullptr;
+#endif
+
+    public:
+        /** The scheduler of the given task, or the service one while that task has no loop */
+        static Scheduler& get(const Task task = Task::Service)
+        {
+            auto& scheduler = of(task);
+            return scheduler.task.load(std::memory_order_acquire) ? scheduler : of(Task::Service);
+        }
+
+        static Scheduler& of(const Task task)
+        {
+            static std::array<Scheduler, static_cast<size_t>(Task::COUNT)> schedulers;
+            return schedulers[static_cast<size_t>(task)];
+        }
+
+        /**
+         * Makes the calling task the one that waits. A task taking over a
+         * loop keeps the busy lock its predecessor held.
+         */
+        void attach()
+        {
+            task.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+#if CONFIG_PM_ENABLE
+            if (busyLock) return;
+            if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "loop-busy", &busyLock) == ESP_OK)
+                esp_pm_lock_acquire(busyLock);
+            else
+                busyLock = nullptr;
+#endif
+        }
+
+        /** Safe from any task; a wake-up before the next wait makes it return right away */
+        void wake()
+        {
+            if (const auto handle = task.load(std::memory_order_acquire))
+                xTaskNotifyGive(handle);
+        }
+
+        void wakeFromIsr()
+        {
+            if (const auto handle = task.load(std::memory_order_acquire))
+            {
+                BaseType_t woken = pdFALSE;
+                vTaskNotifyGiveFromISR(handle, &woken);
+                if (woken) portYIELD_FROM_ISR();
+            }
+        }
+
+        /** Always gives up at least one tick, so the loop never starves the idle task */
+        void wait(const Deadline& deadline)
+        {
+#if CONFIG_PM_ENABLE
+            if (busyLock) esp_pm_lock_release(busyLock);
+#endif
+            ulTaskNotifyTake(pdTRUE, std::max<TickType_t>(pdMS_TO_TICKS(deadline.getRemaining()), 1));
+#if CONFIG_PM_ENABLE
+            if (busyLock) esp_pm_lock_acquire(busyLock);
+#endif
+        }
+
+        /**
+         * Wakes the loop whenever the pin changes level, also out of light
+         * sleep. Light sleep can only wake on a level, so the interrupt is
+         * re-armed for the opposite level every time it fires, which turns
+         * it into an edge interrupt that also works while asleep.
+         */
+        static void wakeOnPin(const gpio_num_t pin, const Task target)
+        {
+            const auto status = gpio_install_isr_service(0);
+            if (status != ESP_OK && status != ESP_ERR_INVALID_STATE)
+            {
+                ESP_LOGE(LOG_TAG, "Failed to install GPIO ISR service: %d", status);
+                return;
+            }
+            const auto arg = static_cast<intptr_t>(pin) | static_cast<intptr_t>(target) << 8;
+            gpio_isr_handler_add(pin, onPinLevel, reinterpret_cast<void*>(arg));
+            armPin(pin);
+            gpio_intr_enable(pin);
+        }
+
+        /** Sets up frequency scaling and light sleep for every loop */
+        static void configure(const bool lightSleep)
+        {
+            configurePowerManagement(lightSleep);
+            esp_sleep_enable_gpio_wakeup();
+        }
+
+    private:
+        static void armPin(const gpio_num_t pin)
+        {
+            gpio_wakeup_enable(pin, gpio_get_level(pin) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+        }
+
+        static void onPinLevel(void* arg)
+        {
+            const auto value = reinterpret_cast<intptr_t>(arg);
+            armPin(static_cast<gpio_num_t>(value & 0xFF));
+            get(static_cast<Task>(value >> 8)).wakeFromIsr();
+        }
+
+        static void configurePowerManagement(const bool lightSleep)
+        {
+#if CONFIG_PM_ENABLE
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+            esp_pm_config_t config = {};
+#else
+            esp_pm_config_esp32_t config = {};
+#endif
+            config.max_freq_mhz = static_cast<int>(getCpuFrequencyMhz());
+            config.min_freq_mhz = static_cast<int>(std::min(MIN_CPU_FREQ_MHZ, getCpuFrequencyMhz()));
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+            config.light_sleep_enable = lightSleep;
+#else
+            if (lightSleep)
+                ESP_LOGW(LOG_TAG, "Light sleep needs CONFIG_FREERTOS_USE_TICKLESS_IDLE, only scaling frequency");
+#endif
+            if (const auto status = esp_pm_configure(&config); status != ESP_OK)
+                ESP_LOGE(LOG_TAG, "Failed to configure power management: %d", status);
+#else
+            (void)lightSleep;
+            ESP_LOGI(LOG_TAG, "Built without CONFIG_PM_ENABLE, the CPU stays at full clock while waiting");
+#endif
+        }
+    };
+
+    struct TaskConfig
+    {
+        const char* name;
+        uint32_t stackSize;
+        UBaseType_t priority;
+        BaseType_t core;
+    };
+
+    /** One pass over the components of a loop, returning when they next need it */
+    using Pass = Deadline (*)(unsigned long now);
+
+    /** Sets up power management and makes the calling task the service loop */
+    inline void begin(const bool lightSleep)
+    {
+        Scheduler::configure(lightSleep);
+        Scheduler::of(Task::Service).attach();
+        ChangeBus::Registry::get().setListener([] { Scheduler::get().wake(); });
+    }
+
+    /**
+     * Runs `pass` forever on a new task pinned to `config.core`, waiting
+     * for the deadline it returns in between. The new task takes over the
+     * loop for `task`, so wake-ups aimed at it reach the new task from then on.
+     */
+    inline bool run(const Task task, const TaskConfig& config, const Pass pass)
+    {
+        static std::array<Pass, static_cast<size_t>(Task::COUNT)> passes = {};
+        passes[static_cast<size_t>(task)] = pass;
+        const auto body = [](void* arg)
+        {
+            const auto task = static_cast<Task>(reinterpret_cast<intptr_t>(arg));
+            auto& scheduler = Scheduler::of(task);
+            scheduler.attach();
+            for (;;)
+                scheduler.wait(passes[static_cast<size_t>(task)](millis()));
+        };
+        if (xTaskCreatePinnedToCore(body, config.name, config.stackSize,
+                                    reinterpret_cast<void*>(static_cast<intptr_t>(task)),
+                                    config.priority, nullptr, config.core) == pdPASS)
+            return true;
+        ESP_LOGE(LOG_TAG, "Failed to create %s task", config.name);
+        return false;
+    }
+
+    inline void wake(const Task task = Task::Service)
+    {
+        Scheduler::get(task).wake();
+    }
+
+    /** Waits on the service loop, for firmware that runs it in loop() */
+    inline void wait(const Deadline& deadline)
+    {
+        Scheduler::get().wait(deadline);
+    }
+
+    inline void wakeOnPin(const gpio_num_t pin, const Task task = Task::Service)
+    {
+        Scheduler::wakeOnPin(pin, task);
+    }
+}
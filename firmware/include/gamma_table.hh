@@ -0,0 +1,170 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Compile-time gamma lookup tables, so perceptual brightness conversions
+ * cost a single flash read instead of two pow() calls.
+ *
+ * Gamma and step size are template parameters in hundredths and thousandths
+ * (e.g. Table<220> is gamma 2.2, BrightnessSteps<220, 50> moves 5% per step).
+ */
+namespace Gamma
+{
+    namespace Math
+    {
+        static constexpr double LN2 = 0.69314718055994530942;
+
+        constexpr double log(double x)
+        {
+            int exponent = 0;
+            while (x > 2.0)
+            {
+                x /= 2.0;
+                ++exponent;
+            }
+            while (x < 1.0)
+            {
+                x *= 2.0;
+                --exponent;
+            }
+            // ln(x) = 2 * atanh((x - 1) / (x + 1)), converging fast for x in [1, 2]
+            const double y = (x - 1.0) / (x + 1.0);
+            const double y2 = y * y;
+            double term = y;
+            double sum = 0.0;
+            for (int n = 1; n < 40; n += 2)
+            {
+                sum += term / n;
+                term *= y2;
+            }
+            return 2.0 * sum + exponent * LN2;
+        }
+
+        constexpr double exp(const double x)
+        {
+            int k = static_cast<int>(x / LN2);
+            if (x < 0.0) --k;
+            const double r = x - k * LN2;
+            double term = 1.0;
+            double sum = 1.0;
+            for (int n = 1; n < 24; ++n)
+            {
+                term *= r / n;
+                sum += term;
+            }
+            for (; k > 0; --k) sum *= 2.0;
+            for (; k < 0; ++k) sum /= 2.0;
+            return sum;
+        }
+
+        constexpr double pow(const double base, const double exponent)
+        {
+            return base <= 0.0 ? 0.0 : exp(exponent * log(base));
+        }
+
+        constexpr long round(const double x)
+        {
+            return static_cast<long>(x < 0.0 ? x - 0.5 : x + 0.5);
+        }
+
+        constexpr uint8_t toByte(const double normalized)
+        {
+            const auto value = round(normalized * 255.0);
+            return static_cast<uint8_t>(value < 0 ? 0 : value > 255 ? 255 : value);
+        }
+
+        constexpr uint16_t toWord(const double normalized, const double scale = 65535.0)
+        {
+            const auto value = round(normalized * scale);
+            return static_cast<uint16_t>(value < 0 ? 0 : value > 65535 ? 65535 : value);
+        }
+    }
+
+    template <unsigned GammaHundredths>
+    class Table
+    {
+        static constexpr std::array<uint8_t, 256> build(const double exponent)
+        {
+            std::array<uint8_t, 256> table = {};
+            for (size_t i = 0; i < table.size(); ++i)
+                table[i] = Math::toByte(Math::pow(static_cast<double>(i) / 255.0, exponent));
+            return table;
+        }
+
+        static constexpr std::array<uint16_t, 256> buildWide(const double exponent, const double scale)
+        {
+            std::array<uint16_t, 256> table = {};
+            for (size_t i = 0; i < table.size(); ++i)
+                table[i] = Math::toWord(Math::pow(static_cast<double>(i) / 255.0, exponent), scale);
+            return table;
+        }
+
+    public:
+        static constexpr double GAMMA = GammaHundredths / 100.0;
+
+        /** 8.8 fixed-point perceptual level, so fades can move in sub-level steps */
+        using Level = uint16_t;
+        static constexpr Level MAX_LEVEL = 255 << 8;
+
+        /** Perceptual level (0-255) to PWM duty (0-255) */
+        static constexpr std::array<uint8_t, 256> TO_DUTY = build(GAMMA);
+
+        /** PWM duty (0-255) to perceptual level (0-255) */
+        static constexpr std::array<uint8_t, 256> TO_PERCEPTUAL = build(1.0 / GAMMA);
+
+        /** Perceptual level (0-255) to 16-bit PWM duty */
+        static constexpr std::array<uint16_t, 256> TO_DUTY_16 = buildWide(GAMMA, 65535.0);
+
+        /** PWM duty (0-255) to 8.8 fixed-point perceptual level */
+        static constexpr std::array<Level, 256> TO_LEVEL = buildWide(1.0 / GAMMA, MAX_LEVEL);
+
+        static constexpr uint8_t toDuty(const uint8_t perceptual) { return TO_DUTY[perceptual]; }
+        static constexpr uint8_t toPerceptual(const uint8_t duty) { return TO_PERCEPTUAL[duty]; }
+        static constexpr Level toLevel(const uint8_t duty) { return TO_LEVEL[duty]; }
+
+        /**
+         * 16-bit duty for a fixed-point level, interpolating linearly between
+         * neighbouring table entries.
+         */
+        static constexpr uint16_t toDuty16(const Level level)
+        {
+            const auto index = level >> 8;
+            if (index >= 255) return TO_DUTY_16[255];
+            const uint32_t low = TO_DUTY_16[index];
+            const uint32_t high = TO_DUTY_16[index + 1];
+            return static_cast<uint16_t>(low + (((high - low) * (level & 0xFF)) >> 8));
+        }
+    };
+
+    /**
+     * Next duty after moving one step up or down in perceptual space,
+     * indexed by the current duty.
+     */
+    template <unsigned GammaHundredths, unsigned StepThousandths>
+    class BrightnessSteps
+    {
+        static constexpr std::array<uint8_t, 256> build(const bool increase)
+        {
+            constexpr double gamma = GammaHundredths / 100.0;
+            constexpr double step = StepThousandths / 1000.0;
+            std::array<uint8_t, 256> table = {};
+            for (size_t i = 0; i < table.size(); ++i)
+            {
+                double perceptual = Math::pow(static_cast<double>(i) / 255.0, 1.0 / gamma);
+                perceptual += increase ? step : -step;
+                perceptual = perceptual < 0.0 ? 0.0 : perceptual > 1.0 ? 1.0 : perceptual;
+                table[i] = Math::toByte(Math::pow(perceptual, gamma));
+            }
+            return table;
+        }
+
+    public:
+        static constexpr std::array<uint8_t, 256> UP = build(true);
+        static constexpr std::array<uint8_t, 256> DOWN = build(false);
+    };
+
+    using Perceptual = Table<220>;
+}
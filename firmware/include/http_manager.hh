@@ -9,12 +9,14 @@ namespace HTTP
     namespace Endpoints
     {
         static constexpr auto STATE = "/state";
+        static constexpr auto EVENTS = "/events";
         static constexpr auto UPDATE = "/update";
         static constexpr auto BLUETOOTH = "/bluetooth";
         static constexpr auto SYSTEM_RESTART = "/system/restart";
         static constexpr auto SYSTEM_RESET = "/system/reset";
         static constexpr auto OUTPUT_COLOR = "/output/color";
         static constexpr auto OUTPUT_BRIGHTNESS = "/output/brightness";
+        static constexpr auto DEBUG_LOOP = "/debug/loop";
     }
 
     class AsyncWebHandlerCreator
@@ -38,6 +40,13 @@ namespace HTTP
             const auto value = std::clamp(req->getParam(key)->value().toInt(), 0l, 255l);
             return static_cast<uint8_t>(value);
         }
+
+        static std::optional<uint16_t> extractUint16Param(const AsyncWebServerRequest* req, const char* key)
+        {
+            if (!req->hasParam(key)) return std::nullopt;
+            const auto value = std::clamp(req->getParam(key)->value().toInt(), 0l, 65535l);
+            return static_cast<uint16_t>(value);
+        }
     };
 
 
@@ -178,8 +187,8 @@ namespace HTTP
                 Credentials credentials;
                 if (pCharacteristic->getValue().size() != sizeof(Credentials))
                 {
-                    ESP_LOGE(LOG_TAG, "Received invalid OTA credentials length: %d",
-                             pCharacteristic->getValue().size());
+                    ESP_LOGE(LOG_TAG, "Received invalid OTA credentials length: %u",
+                             static_cast<unsigned>(pCharacteristic->getValue().size()));
                     return;
                 }
                 memcpy(&credentials, pCharacteristic->getValue().data(), sizeof(Credentials));
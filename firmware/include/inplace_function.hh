@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Drop-in for std::function that keeps the callable inside the object.
+ *
+ * Anything capturing more than Capacity bytes is rejected at compile time
+ * instead of silently going to the heap, and a call is a single indirect
+ * jump with no small-object or null checks of its own.
+ */
+template <typename Signature, size_t Capacity = 16>
+class InplaceFunction;
+
+template <typename Result, typename... Args, size_t Capacity>
+class InplaceFunction<Result(Args...), Capacity>
+{
+    enum class Operation { Copy, Move, Destroy };
+
+    using Invoker = Result (*)(void*, Args&&...);
+    using Manager = void (*)(Operation, void*, void*);
+
+    alignas(std::max_align_t) mutable std::byte storage[Capacity] = {};
+    Invoker invoker = nullptr;
+    Manager manager = nullptr;
+
+    template <typename Functor>
+    static Result invoke(void* functor, Args&&... args)
+    {
+        return (*static_cast<Functor*>(functor))(std::forward<Args>(args)...);
+    }
+
+    template <typename Functor>
+    static void manage(const Operation operation, void* destination, void* source)
+    {
+        switch (operation)
+        {
+        case Operation::Copy:
+            new(destination) Functor(*static_cast<const Functor*>(source));
+            break;
+        case Operation::Move:
+            new(destination) Functor(std::move(*static_cast<Functor*>(source)));
+            break;
+        case Operation::Destroy:
+            static_cast<Functor*>(destination)->~Functor();
+            break;
+        }
+    }
+
+public:
+    InplaceFunction() = default;
+
+    InplaceFunction(std::nullptr_t) // NOLINT
+    {
+    }
+
+    template <typename Callable,
+              typename Functor = std::decay_t<Callable>,
+              typename = std::enable_if_t<!std::is_same_v<Functor, InplaceFunction> &&
+                  std::is_invocable_r_v<Result, Functor&, Args...>>>
+    InplaceFunction(Callable&& callable) // NOLINT
+    {
+        static_assert(sizeof(Functor) <= Capacity, "Callable captures too much for this InplaceFunction");
+        static_assert(alignof(Functor) <= alignof(std::max_align_t), "Callable is over-aligned");
+        static_assert(std::is_copy_constructible_v<Functor>, "Callable must be copyable");
+        new(storage) Functor(std::forward<Callable>(callable));
+        invoker = &invoke<Functor>;
+        manager = &manage<Functor>;
+    }
+
+    InplaceFunction(const InplaceFunction& other)
+        : invoker(other.invoker), manager(other.manager)
+    {
+        if (manager) manager(Operation::Copy, storage, other.storage);
+    }
+
+    InplaceFunction(InplaceFunction&& other) noexcept
+        : invoker(other.invoker), manager(other.manager)
+    {
+        if (manager) manager(Operation::Move, storage, other.storage);
+    }
+
+    ~InplaceFunction()
+    {
+        reset();
+    }
+
+    InplaceFunction& operator=(const InplaceFunction& other)
+    {
+        if (this == &other) return *this;
+        reset();
+        if (other.manager) other.manager(Operation::Copy, storage, other.storage);
+        invoker = other.invoker;
+        manager = other.manager;
+        return *this;
+    }
+
+    InplaceFunction& operator=(InplaceFunction&& other) noexcept
+    {
+        if (this == &other) return *this;
+        reset();
+        if (other.manager) other.manager(Operation::Move, storage, other.storage);
+        invoker = other.invoker;
+        manager = other.manager;
+        return *this;
+    }
+
+    InplaceFunction& operator=(std::nullptr_t)
+    {
+        reset();
+        return *this;
+    }
+
+    explicit operator bool() const
+    {
+        return invoker != nullptr;
+    }
+
+    Result operator()(Args... args) const
+    {
+        return invoker(storage, std::forward<Args>(args)...);
+    }
+
+private:
+    void reset()
+    {
+        if (manager) manager(Operation::Destroy, storage, nullptr);
+        invoker = nullptr;
+        manager = nullptr;
+    }
+};
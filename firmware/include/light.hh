@@ -1,10 +1,10 @@
 #pragma once
 
 #include <Arduino.h>
-#include <Preferences.h>
-#include <cmath>
 
 #include "controller_hardware.hh"
+#include "event_loop.hh"
+#include "gamma_table.hh"
 
 class Light
 {
@@ -33,7 +33,6 @@ public:
     };
 #pragma pack(pop)
 
-    static constexpr auto PREFERENCES_NAME = "light";
     static constexpr auto LOG_TAG = "Light";
 
     static constexpr uint8_t ON_VALUE = 255;
@@ -42,15 +41,50 @@ public:
     static constexpr uint8_t MIN_BRIGHTNESS = OFF_VALUE + 1;
     static constexpr uint8_t MAX_BRIGHTNESS = ON_VALUE;
 
+    using Steps = Gamma::BrightnessSteps<220, 50>;
+
+    /** Output duty at 16-bit precision, reduced to the PWM resolution on write */
+    using Duty = uint16_t;
+    static constexpr Duty MAX_DUTY = UINT16_MAX;
+
+    /**
+     * LEDC timer setup. Frequency times 2^resolutionBits must stay within the
+     * 80 MHz APB clock, so higher resolutions need lower frequencies.
+     * Dithering alternates between neighbouring PWM levels on every write to
+     * render the precision the hardware lacks during fades; it only kicks in
+     * at the dim end of the range, where a single level is a visible step.
+     */
+    struct PwmConfig
+    {
+        uint32_t frequency;
+        uint8_t resolutionBits;
+        bool dithering;
+    };
+
+    static constexpr PwmConfig PWM_8_BIT = {25000, 8, false};
+    static constexpr PwmConfig PWM_12_BIT = {19500, 12, true};
+    static constexpr PwmConfig PWM_14_BIT = {4850, 14, true};
+    static constexpr PwmConfig PWM_16_BIT = {1220, 16, false};
+
+    /**
+     * 16-bit duty for an 8-bit one, going through the gamma tables so a
+     * static value lands exactly where a fade to it ends.
+     */
+    static constexpr Duty toDuty16(const uint8_t value)
+    {
+        return Gamma::Perceptual::toDuty16(Gamma::Perceptual::toLevel(value));
+    }
+
     void setup()
     {
-        prefs.begin(PREFERENCES_NAME, false);
         if (const auto& channel = ControllerHardware::getPwmChannel(pin))
         {
             pinMode(pin, OUTPUT);
-            ledcSetup(channel.value(), PWM_FREQUENCY, PWM_RESOLUTION);
+            if (ledcSetup(channel.value(), pwm.frequency, pwm.resolutionBits) == 0)
+                ESP_LOGE(LOG_TAG, "Unsupported PWM setup %u Hz / %u bits",
+                         static_cast<unsigned>(pwm.frequency), pwm.resolutionBits);
             ledcAttachPin(pin, channel.value());
-            restore();
+            update();
         }
         else
         {
@@ -58,80 +92,36 @@ public:
         }
     }
 
-    void handle(const unsigned long now)
-    {
-        if (state != lastPersistedState && now - lastPersistTime >= PERSIST_DEBOUNCE_MS)
-        {
-            prefs.putBool(onKey, state.on);
-            prefs.putUChar(valueKey, state.value);
-            lastPersistedState = state;
-            lastPersistTime = now;
-        }
-    }
-
 private:
-    static constexpr uint32_t PWM_FREQUENCY = 25000;
-    static constexpr uint8_t PWM_RESOLUTION = 8;
-    static constexpr unsigned long PERSIST_DEBOUNCE_MS = 500;
+    static constexpr uint8_t DITHER_RANGE_BITS = 4;
 
     bool invert;
     gpio_num_t pin;
+    PwmConfig pwm;
     State state;
 
-    char onKey[5] = "";
-    char valueKey[5] = "";
-
-    std::optional<uint8_t> lastWrittenValue = std::nullopt;
-
-    Preferences prefs;
-    State lastPersistedState;
-    unsigned long lastPersistTime = 0;
+    std::optional<uint32_t> lastWrittenLevel = std::nullopt;
+    uint32_t ditherError = 0;
+    bool externalOutput = false;
+    /** LEDC runs off the APB clock, so a lit output must not light sleep */
+    EventLoop::SleepLock sleepLock;
 
     void update()
     {
-        const auto& channel = ControllerHardware::getPwmChannel(pin);
-        const auto duty = state.on ? state.value : OFF_VALUE;
-
-        if (uint8_t outputValue = invert ? MAX_BRIGHTNESS - duty : duty;
-            lastWrittenValue != outputValue)
-        {
-            ledcWrite(channel.value(), outputValue);
-            lastWrittenValue = outputValue;
-        }
-    }
-
-    void restore()
-    {
-        state.on = prefs.getBool(onKey, false);
-        state.value = prefs.getUChar(valueKey, OFF_VALUE);
-        update();
+        if (!externalOutput)
+            writeDuty(toDuty16(getDuty()));
     }
 
     static uint8_t perceptualBrightnessStep(const uint8_t currentValue, const bool increase)
     {
-        constexpr float gamma = 2.2f;
-        float linear = pow(
-            static_cast<float>(currentValue) / static_cast<float>(MAX_BRIGHTNESS),
-            1.0f / gamma);
-        linear += increase ? 0.05f : -0.05f;
-        linear = std::clamp(linear, 0.0f, 1.0f);
-        const auto value = lround(
-            pow(linear, gamma) * static_cast<float>(MAX_BRIGHTNESS)
-        );
-        return std::clamp(static_cast<uint8_t>(value), MIN_BRIGHTNESS, MAX_BRIGHTNESS);
+        const auto value = increase ? Steps::UP[currentValue] : Steps::DOWN[currentValue];
+        return std::clamp(value, MIN_BRIGHTNESS, MAX_BRIGHTNESS);
     }
 
 public:
-    explicit Light(const gpio_num_t pin, const bool invert = false) :
-        invert(invert), pin(pin)
+    explicit Light(const gpio_num_t pin, const bool invert = false, const PwmConfig& pwm = PWM_8_BIT) :
+        invert(invert), pin(pin), pwm(pwm)
     {
-        snprintf(onKey, sizeof(onKey), "%02uo", static_cast<unsigned>(pin));
-        snprintf(valueKey, sizeof(valueKey), "%02uv", static_cast<unsigned>(pin));
-    }
-
-    ~Light()
-    {
-        prefs.end();
     }
 
     void toggle()
@@ -156,23 +146,28 @@ public:
 
     void increaseBrightness()
     {
-        if (state.value == MAX_BRIGHTNESS) return;
-
-        const auto step = perceptualBrightnessStep(state.value, true);
-
-        ESP_LOGI(LOG_TAG, "Increasing brightness to %u", step);
-        state.value = step;
-        update();
+        stepBrightness(1);
     }
 
     void decreaseBrightness()
     {
-        if (isOff() || state.value == MIN_BRIGHTNESS) return;
+        stepBrightness(-1);
+    }
+
+    /** Moves that many perceptual steps up, or down when negative, stopping at either end */
+    void stepBrightness(const int8_t steps)
+    {
+        const bool increase = steps > 0;
+        if (steps == 0 || (!increase && isOff())) return;
 
-        const auto step = perceptualBrightnessStep(state.value, false);
+        auto value = state.value;
+        const auto end = increase ? MAX_BRIGHTNESS : MIN_BRIGHTNESS;
+        for (int8_t i = 0; i != steps && value != end; i += increase ? 1 : -1)
+            value = perceptualBrightnessStep(value, increase);
+        if (value == state.value) return;
 
-        ESP_LOGI(LOG_TAG, "Decreasing brightness to %u", step);
-        state.value = step;
+        ESP_LOGI(LOG_TAG, "%s brightness to %u", increase ? "Increasing" : "Decreasing", value);
+        state.value = value;
         update();
     }
 
@@ -187,6 +182,46 @@ public:
         state.on = true;
         if (state.value == OFF_VALUE)
             state.value = MAX_BRIGHTNESS;
+        update();
+    }
+
+    /**
+     * Stops state changes from being written to the PWM channel, leaving
+     * the owner responsible for driving it through writeDuty().
+     */
+    void setExternalOutput(const bool external)
+    {
+        externalOutput = external;
+    }
+
+    /**
+     * Writes a 16-bit duty at the configured PWM resolution. When `dither` is
+     * set and the PWM config allows it, the truncated bits are accumulated so
+     * calling this on every loop averages out to the exact duty.
+     */
+    void writeDuty(const Duty duty, const bool dither = false)
+    {
+        const uint8_t shift = 16 - pwm.resolutionBits;
+        const uint32_t maxLevel = (1u << pwm.resolutionBits) - 1;
+        uint32_t level = duty >> shift;
+
+        if (dither && pwm.dithering && shift > 0 && level < maxLevel >> DITHER_RANGE_BITS)
+        {
+            ditherError += duty & ((1u << shift) - 1);
+            if (ditherError >= 1u << shift)
+            {
+                ditherError -= 1u << shift;
+                ++level;
+            }
+        }
+
+        sleepLock.hold(level != 0);
+        if (lastWrittenLevel == level) return;
+        if (const auto& channel = ControllerHardware::getPwmChannel(pin))
+        {
+            ledcWrite(channel.value(), invert ? maxLevel - level : level);
+            lastWrittenLevel = level;
+        }
     }
 
     void toJson(const JsonObject& to) const
@@ -199,4 +234,7 @@ public:
     [[nodiscard]] bool isVisible() const { return state.on && state.value > 0; }
     [[nodiscard]] uint8_t getValue() const { return state.value; }
     [[nodiscard]] State getState() const { return state; }
+    [[nodiscard]] uint8_t getDuty() const { return state.on ? state.value : OFF_VALUE; }
+    [[nodiscard]] const PwmConfig& getPwmConfig() const { return pwm; }
+    [[nodiscard]] gpio_num_t getPin() const { return pin; }
 };
@@ -0,0 +1,245 @@
+#pragma once
+
+/**
+ * Build with `-D LOOP_PROFILER=0` to compile the profiler out entirely: the
+ * LOOP_PROFILE macros then expand to the bare statements and neither the
+ * `/debug/loop` endpoint nor the ON_LOOP_PROFILE message exist.
+ */
+#ifndef LOOP_PROFILER
+#define LOOP_PROFILER 1
+#endif
+
+#if LOOP_PROFILER
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <Arduino.h>
+
+/**
+ * Times sections of loop() with the CPU cycle counter and keeps a fixed
+ * log-scale histogram per section, so the occasional slow pass can be
+ * traced back to the component that caused it.
+ *
+ * Buckets are exact below 4 µs and then split every power of two into
+ * four, which bounds the error of a reported percentile to 25 %. Times
+ * of MAX_TRACKED_US or more all land in one overflow bucket, but min, max
+ * and average stay exact.
+ */
+namespace LoopProfiler
+{
+    static constexpr uint8_t MAX_SECTIONS = 16;
+    static constexpr uint8_t NAME_LENGTH = 15;
+    static constexpr uint8_t NONE = 0xFF;
+
+    static constexpr uint8_t SUB_BUCKETS = 4;
+    static constexpr uint8_t OCTAVES = 18;
+    static constexpr uint32_t MAX_TRACKED_US = 1UL << OCTAVES;
+    static constexpr uint8_t BUCKET_COUNT = SUB_BUCKETS * (OCTAVES - 1) + 1;
+
+#pragma pack(push, 1)
+    /** Summary of one section; also the wire format of the ON_LOOP_PROFILE entries */
+    struct SectionStats
+    {
+        std::array<char, NAME_LENGTH + 1> name = {};
+        uint32_t count = 0;
+        uint32_t minUs = 0;
+        uint32_t avgUs = 0;
+        uint32_t p99Us = 0;
+        uint32_t maxUs = 0;
+    };
+#pragma pack(pop)
+
+    class Histogram
+    {
+        std::array<uint32_t, BUCKET_COUNT> buckets = {};
+        uint32_t count = 0;
+        uint32_t minUs = UINT32_MAX;
+        uint32_t maxUs = 0;
+        uint64_t sumUs = 0;
+
+    public:
+        void record(const uint32_t us)
+        {
+            ++buckets[bucketOf(us)];
+            ++count;
+            minUs = std::min(minUs, us);
+            maxUs = std::max(maxUs, us);
+            sumUs += us;
+        }
+
+        [[nodiscard]] uint32_t getCount() const
+        {
+            return count;
+        }
+
+        /** Upper bound of the bucket holding the given percentile, never above the max seen */
+        [[nodiscard]] uint32_t percentile(const uint8_t percent) const
+        {
+            if (count == 0) return 0;
+            const uint64_t rank = (static_cast<uint64_t>(count) * percent + 99) / 100;
+            uint64_t seen = 0;
+            for (uint8_t i = 0; i < BUCKET_COUNT; ++i)
+                if ((seen += buckets[i]) >= rank)
+                    return std::min(upperBoundOf(i), maxUs);
+            return maxUs;
+        }
+
+        void fillStats(SectionStats& stats) const
+        {
+            stats.count = count;
+            stats.minUs = count ? minUs : 0;
+            stats.avgUs = count ? static_cast<uint32_t>(sumUs / count) : 0;
+            stats.p99Us = percentile(99);
+            stats.maxUs = maxUs;
+        }
+
+        static uint8_t bucketOf(const uint32_t us)
+        {
+            if (us < SUB_BUCKETS) return us;
+            if (us >= MAX_TRACKED_US) return BUCKET_COUNT - 1;
+            const uint8_t octave = 31 - __builtin_clz(us);
+            const uint8_t sub = us >> (octave - 2) & (SUB_BUCKETS - 1);
+            return SUB_BUCKETS * (octave - 1) + sub;
+        }
+
+        static uint32_t upperBoundOf(const uint8_t bucket)
+        {
+            if (bucket >= BUCKET_COUNT - 1) return UINT32_MAX;
+            if (bucket < SUB_BUCKETS) return bucket;
+            return lowerBoundOf(bucket + 1) - 1;
+        }
+
+    private:
+        static uint32_t lowerBoundOf(const uint8_t bucket)
+        {
+            if (bucket < SUB_BUCKETS) return bucket;
+            const uint8_t octave = bucket / SUB_BUCKETS + 1;
+            return (SUB_BUCKETS + bucket % SUB_BUCKETS) << (octave - 2);
+        }
+    };
+
+    /**
+     * Sections are registered once by name and then recorded by index.
+     * Recording happens on the loop tasks while the endpoint and the
+     * WebSocket read from theirs, so both go through the mutex; the lock is
+     * uncontended but for the odd snapshot.
+     */
+    class Registry
+    {
+        std::mutex mutex;
+        std::array<std::array<char, NAME_LENGTH + 1>, MAX_SECTIONS> names = {};
+        std::array<Histogram, MAX_SECTIONS> histograms = {};
+        uint8_t sectionCount = 0;
+        uint32_t cyclesPerUs = ::getCpuFrequencyMhz();
+
+    public:
+        static Registry& get()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        /** Returns the index of the named section, adding it if needed; NONE once all are taken */
+        uint8_t section(const char* name)
+        {
+            std::lock_guard lock(mutex);
+            for (uint8_t i = 0; i < sectionCount; ++i)
+                if (std::strncmp(names[i].data(), name, NAME_LENGTH) == 0) return i;
+            if (sectionCount == MAX_SECTIONS) return NONE;
+            std::strncpy(names[sectionCount].data(), name, NAME_LENGTH);
+            return sectionCount++;
+        }
+
+        /**
+         * The loop holds the CPU at its top clock while busy, see
+         * EventLoop::Scheduler, so one conversion factor fits every pass.
+         */
+        void record(const uint8_t index, const uint32_t cycles)
+        {
+            if (index >= MAX_SECTIONS) return;
+            std::lock_guard lock(mutex);
+            histograms[index].record(cycles / cyclesPerUs);
+        }
+
+        /** Fills up to MAX_SECTIONS entries and returns how many there are */
+        uint8_t snapshot(std::array<SectionStats, MAX_SECTIONS>& stats)
+        {
+            std::lock_guard lock(mutex);
+            for (uint8_t i = 0; i < sectionCount; ++i)
+            {
+                stats[i].name = names[i];
+                histograms[i].fillStats(stats[i]);
+            }
+            return sectionCount;
+        }
+
+        /** Clears the recorded times but keeps the sections */
+        void reset()
+        {
+            std::lock_guard lock(mutex);
+            histograms.fill({});
+            cyclesPerUs = ::getCpuFrequencyMhz();
+        }
+
+        [[nodiscard]] uint32_t getCpuFrequencyMhz() const
+        {
+            return cyclesPerUs;
+        }
+    };
+
+    /** Records the cycles from construction to destruction into a section */
+    class Scope
+    {
+        const uint8_t index;
+        const uint32_t start;
+
+    public:
+        explicit Scope(const uint8_t index) : index(index), start(ESP.getCycleCount())
+        {
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope()
+        {
+            Registry::get().record(index, ESP.getCycleCount() - start);
+        }
+    };
+
+    inline uint8_t section(const char* name)
+    {
+        return Registry::get().section(name);
+    }
+}
+
+#define LOOP_PROFILE_CONCAT_(a, b) a##b
+#define LOOP_PROFILE_CONCAT(a, b) LOOP_PROFILE_CONCAT_(a, b)
+
+/** Times the rest of the enclosing block as the named section */
+#define LOOP_PROFILE_SCOPE(name)                                                                    \
+    static const uint8_t LOOP_PROFILE_CONCAT(loopProfileSection, __LINE__) = LoopProfiler::section(name); \
+    const LoopProfiler::Scope LOOP_PROFILE_CONCAT(loopProfileScope, __LINE__)(                      \
+        LOOP_PROFILE_CONCAT(loopProfileSection, __LINE__))
+
+/** Times a single statement as the named section */
+#define LOOP_PROFILE(name, ...)                                                                     \
+    do                                                                                              \
+    {                                                                                               \
+        LOOP_PROFILE_SCOPE(name);                                                                   \
+        __VA_ARGS__;                                                                                \
+    } while (0)
+
+#else
+
+#define LOOP_PROFILE_SCOPE(name) static_cast<void>(0)
+#define LOOP_PROFILE(name, ...)                                                                     \
+    do                                                                                              \
+    {                                                                                               \
+        __VA_ARGS__;                                                                                \
+    } while (0)
+
+#endif
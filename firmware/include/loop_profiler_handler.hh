@@ -0,0 +1,64 @@
+#pragma once
+
+#include "loop_profiler.hh"
+
+#if LOOP_PROFILER
+
+#include <AsyncJson.h>
+
+#include "http_manager.hh"
+
+namespace LoopProfiler
+{
+    /**
+     * Serves `/debug/loop`: the CPU clock the times were converted with and
+     * count, min, avg, p99 and max in µs for every section. `?reset` clears
+     * the histograms after the response was built, so a fixture can be
+     * measured one run at a time.
+     */
+    class RestHandler final : public HTTP::AsyncWebHandlerCreator
+    {
+    public:
+        AsyncWebHandler* createAsyncWebHandler() override
+        {
+            return new AsyncRestWebHandler();
+        }
+
+    private:
+        class AsyncRestWebHandler final : public AsyncWebHandler
+        {
+            bool canHandle(AsyncWebServerRequest* request) const override
+            {
+                return request->method() == HTTP_GET && request->url() == HTTP::Endpoints::DEBUG_LOOP;
+            }
+
+            void handleRequest(AsyncWebServerRequest* request) override
+            {
+                auto& registry = Registry::get();
+                std::array<SectionStats, MAX_SECTIONS> stats;
+                const auto count = registry.snapshot(stats);
+                if (request->hasParam("reset"))
+                    registry.reset();
+
+                auto* response = new AsyncJsonResponse();
+                const auto root = response->getRoot().to<JsonObject>();
+                root["cpuMhz"] = registry.getCpuFrequencyMhz();
+                const auto sections = root["sections"].to<JsonObject>();
+                for (uint8_t i = 0; i < count; ++i)
+                {
+                    const auto section = sections[stats[i].name.data()].to<JsonObject>();
+                    section["count"] = stats[i].count;
+                    section["minUs"] = stats[i].minUs;
+                    section["avgUs"] = stats[i].avgUs;
+                    section["p99Us"] = stats[i].p99Us;
+                    section["maxUs"] = stats[i].maxUs;
+                }
+                response->addHeader("Cache-Control", "no-store");
+                response->setLength();
+                request->send(response);
+            }
+        };
+    };
+}
+
+#endif
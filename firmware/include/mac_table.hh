@@ -0,0 +1,145 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+/**
+ * Open-addressed hash table from 48-bit MAC addresses to the position they
+ * were listed at, looked up in constant time without a lock.
+ *
+ * There are at least twice as many slots as entries, so linear probing
+ * stays short. A slot is two 32-bit atomic words: the first four address
+ * bytes, and the last two with the position plus one, zero marking the
+ * slot empty. assign() rebuilds the whole table under a sequence counter
+ * like SeqLock's and find() probes again when it raced a rebuild, which
+ * only happens when the list itself changes.
+ *
+ * Only for a single writer.
+ */
+template <size_t MaxEntries>
+class MacTable
+{
+    static_assert(MaxEntries != 0 && MaxEntries < 0xFFFF, "Positions are kept in 16 bits");
+
+    static constexpr size_t slotCountFor(const size_t entries)
+    {
+        size_t count = 1;
+        while (count < entries * 2)
+            count <<= 1;
+        return count;
+    }
+
+public:
+    static constexpr size_t SLOT_COUNT = slotCountFor(MaxEntries);
+
+private:
+    static constexpr size_t MASK = SLOT_COUNT - 1;
+
+    struct Slot
+    {
+        std::atomic<uint32_t> low = 0;
+        /** Address bytes 4 and 5, and the position plus one in the upper half */
+        std::atomic<uint32_t> high = 0;
+    };
+
+    std::atomic<uint32_t> sequence = 0;
+    std::array<Slot, SLOT_COUNT> slots = {};
+
+public:
+    /**
+     * Writer side only. Replaces the table with count addresses, each
+     * mapped to its position, addressOf(position) returning the six bytes.
+     * Only the first of repeated addresses is kept, as is anything beyond
+     * MaxEntries.
+     */
+    template <typename AddressOf>
+    void assign(size_t count, AddressOf&& addressOf)
+    {
+        std::array<std::array<uint32_t, 2>, SLOT_COUNT> fresh = {};
+        count = count < MaxEntries ? count : MaxEntries;
+        for (size_t position = 0; position < count; ++position)
+        {
+            const uint8_t* mac = addressOf(position);
+            const auto low = lowWord(mac);
+            const auto key = highKey(mac);
+            for (size_t i = hash(low, key) & MASK;; i = (i + 1) & MASK)
+            {
+                auto& [slotLow, slotHigh] = fresh[i];
+                if (slotHigh == 0)
+                {
+                    slotLow = low;
+                    slotHigh = key | static_cast<uint32_t>(position + 1) << 16;
+                    break;
+                }
+                if (slotLow == low && (slotHigh & 0xFFFF) == key) break;
+            }
+        }
+
+        const auto position = sequence.load(std::memory_order_relaxed);
+        sequence.store(position + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < SLOT_COUNT; ++i)
+        {
+            slots[i].low.store(fresh[i][0], std::memory_order_relaxed);
+            slots[i].high.store(fresh[i][1], std::memory_order_relaxed);
+        }
+        sequence.store(position + 2, std::memory_order_release);
+    }
+
+    /** Any task; the position the address was listed at */
+    [[nodiscard]] std::optional<uint16_t> find(const uint8_t* mac) const
+    {
+        const auto low = lowWord(mac);
+        const auto key = highKey(mac);
+        std::optional<uint16_t> found;
+        uint32_t before;
+        uint32_t after;
+        do
+        {
+            before = sequence.load(std::memory_order_acquire);
+            found = probe(low, key);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        }
+        while (before != after || before & 1);
+        return found;
+    }
+
+private:
+    [[nodiscard]] std::optional<uint16_t> probe(const uint32_t low, const uint32_t key) const
+    {
+        for (size_t i = hash(low, key) & MASK, probed = 0; probed < SLOT_COUNT; i = (i + 1) & MASK, ++probed)
+        {
+            const auto high = slots[i].high.load(std::memory_order_relaxed);
+            if (high == 0) return std::nullopt;
+            if ((high & 0xFFFF) == key && slots[i].low.load(std::memory_order_relaxed) == low)
+                return static_cast<uint16_t>((high >> 16) - 1);
+        }
+        return std::nullopt;
+    }
+
+    static uint32_t lowWord(const uint8_t* mac)
+    {
+        return mac[0] | mac[1] << 8 | mac[2] << 16 | static_cast<uint32_t>(mac[3]) << 24;
+    }
+
+    static uint32_t highKey(const uint8_t* mac)
+    {
+        return mac[4] | mac[5] << 8;
+    }
+
+    /** Murmur3 finalizer; remotes from one vendor share the first three bytes, so all six are mixed */
+    static uint32_t hash(const uint32_t low, const uint32_t key)
+    {
+        uint32_t h = low ^ key * 0x9E3779B1u;
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35u;
+        h ^= h >> 16;
+        return h;
+    }
+};
@@ -5,6 +5,8 @@
 #include <array>
 #include <atomic>
 
+#include "change_bus.hh"
+
 namespace OTA
 {
     enum class Status : uint8_t
@@ -65,9 +67,9 @@ namespace OTA
 
         // `status` is atomic because we can have concurrent http requests
         std::atomic<Status> status = Status::Idle;
-        // `totalBytesExpected/Received` are volatile for visibility during upload monitoring only.
-        volatile uint32_t totalBytesExpected = 0;
-        volatile uint32_t totalBytesReceived = 0;
+        // `totalBytesExpected/Received` are written by the upload and read by status monitoring
+        std::atomic<uint32_t> totalBytesExpected = 0;
+        std::atomic<uint32_t> totalBytesReceived = 0;
 
     public:
         explicit Handler(const AsyncAuthenticationMiddleware& asyncAuthenticationMiddleware)
@@ -79,8 +81,8 @@ namespace OTA
         {
             return {
                 status.load(std::memory_order_relaxed),
-                totalBytesExpected,
-                totalBytesReceived
+                totalBytesExpected.load(std::memory_order_relaxed),
+                totalBytesReceived.load(std::memory_order_relaxed)
             };
         }
 
@@ -94,12 +96,34 @@ namespace OTA
             getState().toJson(root["ota"].to<JsonObject>());
         }
 
+        [[nodiscard]] const char* getStateFields() const override
+        {
+            return "ota";
+        }
+
+        [[nodiscard]] ChangeBus::Mask getStateTopics() const override
+        {
+            return ChangeBus::maskOf(ChangeBus::Topic::OtaState);
+        }
+
         AsyncWebHandler* createAsyncWebHandler() override
         {
             return new AsyncOtaWebHandler(*this);
         }
 
     private:
+        void setStatus(const Status newStatus)
+        {
+            status = newStatus;
+            ChangeBus::publish(ChangeBus::Topic::OtaState);
+        }
+
+        void addReceivedBytes(const size_t len)
+        {
+            totalBytesReceived.fetch_add(len, std::memory_order_relaxed);
+            ChangeBus::publish(ChangeBus::Topic::OtaState);
+        }
+
         class AsyncOtaWebHandler final : public AsyncWebHandler
         {
             static constexpr auto REALM = "rgbw-ctrl";
@@ -146,7 +170,7 @@ namespace OTA
                 }
 
                 resetUpdateState();
-                handler.status = Status::Started;
+                handler.setStatus(Status::Started);
 
                 if (request->hasHeader(CONTENT_LENGTH_HEADER))
                     handler.totalBytesExpected = request->header(CONTENT_LENGTH_HEADER).toInt();
@@ -157,7 +181,7 @@ namespace OTA
                     if (!Update.setMD5(md5Param.c_str()))
                     {
                         setUpdateError("Invalid MD5 format");
-                        handler.status = Status::Failed;
+                        handler.setStatus(Status::Failed);
                         return true;
                     }
                 }
@@ -185,7 +209,7 @@ namespace OTA
                 }
                 else
                 {
-                    handler.status = Status::Failed;
+                    handler.setStatus(Status::Failed);
                     checkUpdateError();
                     ESP_LOGE(LOG_TAG, "Update.begin failed");
                 }
@@ -218,8 +242,9 @@ namespace OTA
                 if (!uploadCompleted)
                 {
                     ESP_LOGW(LOG_TAG, "OTA upload incomplete: received %lu of %lu bytes",
-                             handler.totalBytesReceived, handler.totalBytesExpected);
-                    handler.status = Status::Idle;
+                             static_cast<unsigned long>(handler.totalBytesReceived.load(std::memory_order_relaxed)),
+                             static_cast<unsigned long>(handler.totalBytesExpected.load(std::memory_order_relaxed)));
+                    handler.setStatus(Status::Idle);
                     request->send(500, "text/plain", MSG_UPLOAD_INCOMPLETE);
                     return;
                 }
@@ -228,13 +253,13 @@ namespace OTA
 
                 if (Update.end(true))
                 {
-                    handler.status = Status::Completed;
+                    handler.setStatus(Status::Completed);
                     ESP_LOGI(LOG_TAG, "Update successfully completed");
                     request->send(200, "text/plain", MSG_SUCCESS);
                 }
                 else
                 {
-                    handler.status = Status::Failed;
+                    handler.setStatus(Status::Failed);
                     checkUpdateError();
                     sendErrorResponse(request);
                 }
@@ -254,12 +279,12 @@ namespace OTA
 
                 if (Update.write(data, len) != len)
                 {
-                    handler.status = Status::Failed;
+                    handler.setStatus(Status::Failed);
                     checkUpdateError();
                     return;
                 }
 
-                handler.totalBytesReceived += len;
+                handler.addReceivedBytes(len);
 
                 if (final) uploadCompleted = true;
             }
@@ -277,12 +302,12 @@ namespace OTA
 
                 if (Update.write(data, len) != len)
                 {
-                    handler.status = Status::Failed;
+                    handler.setStatus(Status::Failed);
                     checkUpdateError();
                     return;
                 }
 
-                handler.totalBytesReceived += len;
+                handler.addReceivedBytes(len);
 
                 if (index + len >= total)
                     uploadCompleted = true;
@@ -310,9 +335,9 @@ namespace OTA
 
             void resetUpdateState() const
             {
-                handler.status = Status::Idle;
                 handler.totalBytesExpected = 0;
                 handler.totalBytesReceived = 0;
+                handler.setStatus(Status::Idle);
                 uploadCompleted = false;
                 updateError.reset();
             }
@@ -323,7 +348,7 @@ namespace OTA
                 async_call([]
                 {
                     esp_restart();
-                }, 2048, 100);
+                }, 100);
             }
 
             static bool isRequestValidForUpload(const AsyncWebServerRequest* request)
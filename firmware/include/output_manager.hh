@@ -4,69 +4,168 @@
 #include "light.hh"
 
 #include <array>
+#include <atomic>
+#include <optional>
 #include <Arduino.h>
 #include <algorithm>
+#include <freertos/FreeRTOS.h> // NOLINT
+#include <freertos/task.h>
 
 #include "ble_service.hh"
+#include "change_bus.hh"
+#include "event_loop.hh"
 #include "http_manager.hh"
+#include "output_persistence.hh"
+#include "output_state.hh"
+#include "seqlock.hh"
+#include "spsc_ring.hh"
 #include "state_json_filler.hh"
 #include "throttled_value.hh"
 
 namespace Output
 {
-#pragma pack(push, 1)
-    struct State
+    /**
+     * Owns the four lights and renders their state to PWM.
+     *
+     * Everything that touches the lights runs on the output task: handle()
+     * and schedule(), and the realtime calls. Mutators may be called from
+     * any task, but not from an ISR; they only queue a Command, which the
+     * next handle() applies and renders right away. handleBle() and
+     * scheduleBle() belong to the service loop. Getters read a snapshot of
+     * the state that the output task publishes once per applied batch, so
+     * every task sees all four channels from the same change.
+     *
+     * Every task that posts gets a ring of its own on first use, so posting
+     * never takes a lock: the AsyncTCP, NimBLE host, knob timer and loop
+     * tasks each fill one, and the output task drains them oldest first.
+     * Rings are never handed back, which suits the long-lived tasks of the
+     * firmware.
+     */
+    class Manager final : public BLE::Service, public StateJsonFiller, public HTTP::AsyncWebHandlerCreator
     {
-        std::array<Light::State, 4> values = {};
+        static constexpr auto LOG_TAG = "Output";
+
+    public:
+        static constexpr unsigned long DEFAULT_TRANSITION_MS = 250;
+        static constexpr unsigned long MAX_TRANSITION_MS = 60000;
+        static constexpr unsigned long FRAME_INTERVAL_MS = 10;
+        static constexpr unsigned long REALTIME_TIMEOUT_MS = 2500;
+        /** Dithering averages over consecutive writes, so fades keep the loop at this pace */
+        static constexpr unsigned long DITHER_INTERVAL_MS = 1;
+        static constexpr uint8_t MAX_PRODUCERS = 8;
+        static constexpr size_t PRODUCER_RING_SIZE = 16;
+        static constexpr uint8_t ALL_CHANNELS = 0x0F;
 
-        bool operator==(const State& other) const
+        static constexpr uint8_t channelOf(const Color color)
         {
-            return values == other.values;
+            return 1 << static_cast<uint8_t>(color);
         }
 
-        bool operator!=(const State& other) const
+        struct CommandStats
         {
-            return values != other.values;
-        }
+            uint32_t applied = 0;
+            /** Rings that were full, and posts from tasks beyond MAX_PRODUCERS */
+            uint32_t dropped = 0;
+            /** From queuing a command to the PWM write of the frame it first shows in */
+            uint32_t lastLatencyUs = 0;
+            uint32_t maxLatencyUs = 0;
+        };
 
-        [[nodiscard]] bool isOn(Color color) const
+        struct ProducerStats
         {
-            return values.at(static_cast<size_t>(color)).on;
-        }
+            const char* task = nullptr;
+            uint32_t dropped = 0;
+            /** Most commands the ring held at once */
+            uint32_t highWater = 0;
+        };
+
+    private:
+        using Levels = std::array<Gamma::Perceptual::Level, 4>;
 
-        [[nodiscard]] uint8_t getValue(Color color) const
+        /** A mutation queued for the output task */
+        struct Command
         {
-            return values.at(static_cast<size_t>(color)).value;
-        }
+            enum class Type : uint8_t
+            {
+                SetValues,
+                SetOn,
+                SetState,
+                Toggle,
+                ToggleAll,
+                TurnOffAll,
+                TurnOnAll,
+                StepBrightness,
+                ShowChannels
+            };
+
+            Type type;
+            /** Bit per Color the command applies to, see channelOf() */
+            uint8_t channels = 0;
+            State state = {};
+            uint32_t queuedUs = 0;
+            /** StepBrightness only; negative dims */
+            int8_t steps = 0;
+            /** How long the change this command makes fades in */
+            uint16_t transitionMs = DEFAULT_TRANSITION_MS;
+        };
 
-        [[nodiscard]] bool anyOn() const
+        struct Producer
         {
-            return std::any_of(values.begin(), values.end(),
-                               [](const Light::State& s) { return s.on; });
-        }
-    };
-#pragma pack(pop)
+            std::atomic<TaskHandle_t> task = nullptr;
+            SpscRing<Command, PRODUCER_RING_SIZE> ring;
+            std::atomic<uint32_t> dropped = 0;
+            std::atomic<uint32_t> highWater = 0;
+        };
 
-    class Manager final : public BLE::Service, public StateJsonFiller, public HTTP::AsyncWebHandlerCreator
-    {
-        static constexpr auto LOG_TAG = "Output";
+        struct Transition
+        {
+            Levels from = {};
+            Levels to = {};
+            std::array<uint8_t, 4> target = {};
+            unsigned long startTime = 0;
+            unsigned long duration = 0;
+        };
 
         std::array<Light, 4> lights;
         static_assert(static_cast<size_t>(Color::White) < 4, "Color enum out of bounds");
+        SeqLock<State> snapshot;
+
+        Persistence persistence;
+        Transition transition;
+        Levels levels = {};
+        std::array<Light::Duty, 4> frameDuties = {};
+        /** Transition of the last command applied since the previous render; output task only */
+        unsigned long batchTransitionMs = DEFAULT_TRANSITION_MS;
+        unsigned long lastFrameTime = 0;
+
+        /** Streamed duties shown instead of the lights' state, never persisted */
+        std::array<uint8_t, 4> realtimeDuties = {};
+        unsigned long realtimeTime = 0;
+        std::atomic<bool> realtime = false;
+
+        std::array<Producer, MAX_PRODUCERS> producers;
+        std::optional<uint32_t> oldestUnrenderedUs;
+        std::atomic<uint32_t> appliedCommands = 0;
+        /** Posts from tasks that found every ring taken */
+        std::atomic<uint32_t> unassignedDrops = 0;
+        std::atomic<uint32_t> lastLatencyUs = 0;
+        std::atomic<uint32_t> maxLatencyUs = 0;
 
         NimBLECharacteristic* bleOutputColorCharacteristic = nullptr;
         ThrottledValue<State> colorNotificationThrottle{500};
+        ChangeBus::Subscription bleChanges{ChangeBus::maskOf(ChangeBus::Topic::Output)};
 
     public:
         explicit Manager(const gpio_num_t red,
                          const gpio_num_t green,
                          const gpio_num_t blue,
-                         const gpio_num_t white)
+                         const gpio_num_t white,
+                         const Light::PwmConfig& pwm = Light::PWM_8_BIT)
             : lights{
-                Light(red, false),
-                Light(green, false),
-                Light(blue, false),
-                Light(white, false)
+                Light(red, false, pwm),
+                Light(green, false, pwm),
+                Light(blue, false, pwm),
+                Light(white, false, pwm)
             }
         {
         }
@@ -74,167 +173,306 @@ namespace Output
         void begin()
         {
             for (auto& light : lights)
+            {
+                light.setExternalOutput(true);
                 light.setup();
+            }
+            std::array<gpio_num_t, 4> pins = {};
+            std::transform(lights.begin(), lights.end(), pins.begin(),
+                           [](const Light& light) { return light.getPin(); });
+            // Nothing else runs yet, so the restored state is applied in place
+            if (const auto state = persistence.restore(pins))
+                apply({Command::Type::SetState, ALL_CHANNELS, state.value()});
+            publish();
         }
 
         void handle(const unsigned long now)
         {
-            for (auto& light : lights)
-                light.handle(now);
+            applyCommands();
+            persistence.handle(now, getState());
+            renderFrame(now);
+            batchTransitionMs = DEFAULT_TRANSITION_MS;
+            const bool dither = isTransitioning();
+            for (size_t i = 0; i < lights.size(); ++i)
+                lights[i].writeDuty(frameDuties[i], dither);
+            if (oldestUnrenderedUs)
+            {
+                const uint32_t latency = micros() - oldestUnrenderedUs.value();
+                lastLatencyUs.store(latency, std::memory_order_relaxed);
+                if (latency > maxLatencyUs.load(std::memory_order_relaxed))
+                    maxLatencyUs.store(latency, std::memory_order_relaxed);
+                oldestUnrenderedUs.reset();
+            }
+        }
+
+        /** Queued commands wake the output task themselves */
+        void schedule(EventLoop::Deadline& next)
+        {
+            persistence.schedule(next);
+            if (realtime)
+                next.at(realtimeTime + REALTIME_TIMEOUT_MS);
+            if (isTransitioning() || getTarget() != transition.target)
+                next.at(lastFrameTime + FRAME_INTERVAL_MS);
+            if (isTransitioning() && lights.front().getPwmConfig().dithering)
+                next.in(DITHER_INTERVAL_MS);
+        }
+
+        /** Sends the BLE color notification; runs on the service loop */
+        void handleBle(const unsigned long now)
+        {
             sendColorNotification(now);
         }
 
-        void setValue(const uint8_t value, Color color)
+        void scheduleBle(EventLoop::Deadline& next)
         {
-            return lights.at(static_cast<size_t>(color)).setValue(value);
+            if (bleChanges.pending())
+                next.afterWindow(colorNotificationThrottle.getLastSendTime(),
+                                 colorNotificationThrottle.getInterval());
         }
 
-        void setOn(const bool on, Color color)
+        [[nodiscard]] bool isTransitioning() const
         {
-            return lights.at(static_cast<size_t>(color)).setOn(on);
+            return transition.duration != 0 && lastFrameTime - transition.startTime < transition.duration;
         }
 
-        void toggle(Color color)
+        /**
+         * Shows a streamed frame on the next render, without a transition.
+         * The stored state is left alone, so nothing is persisted or
+         * published, and it fades back in once no frame arrived for
+         * REALTIME_TIMEOUT_MS or endRealtime() is called.
+         */
+        void setRealtimeDuties(const std::array<uint8_t, 4>& duties, const unsigned long now)
         {
-            auto& light = lights.at(static_cast<size_t>(color));
-            const bool on = !light.isVisible();
-            light.setOn(on);
-            if (on)
-                light.makeVisible();
+            realtimeDuties = duties;
+            realtimeTime = now;
+            realtime = true;
         }
 
-        void toggleAll()
+        void endRealtime()
         {
-            const bool on = anyVisible();
-            for (auto& light : lights)
-            {
-                if (on)
-                {
-                    light.setOn(false);
-                }
-                else
-                {
-                    light.setOn(true);
-                    light.setValue(Light::ON_VALUE);
-                }
-            }
+            realtime = false;
         }
 
-        void turnOffAll()
+        [[nodiscard]] bool isRealtime() const
         {
-            for (auto& light : lights)
-                light.setOn(false);
+            return realtime;
+        }
+
+        void setValue(const uint8_t value, const Color color)
+        {
+            Command command{Command::Type::SetValues, channelOf(color)};
+            command.state.values[static_cast<size_t>(color)].value = value;
+            post(command);
+        }
+
+        void setOn(const bool on, const Color color)
+        {
+            Command command{Command::Type::SetOn, channelOf(color)};
+            command.state.values[static_cast<size_t>(color)].on = on;
+            post(command);
+        }
+
+        void toggle(const Color color)
+        {
+            post({Command::Type::Toggle, channelOf(color)});
+        }
+
+        void toggleAll(const unsigned long transitionMs = DEFAULT_TRANSITION_MS)
+        {
+            post({Command::Type::ToggleAll}, transitionMs);
+        }
+
+        void turnOffAll(const unsigned long transitionMs = DEFAULT_TRANSITION_MS)
+        {
+            post({Command::Type::TurnOffAll}, transitionMs);
         }
 
         void turnOnAll()
         {
-            for (auto& light : lights)
-                light.makeVisible();
+            post({Command::Type::TurnOnAll});
         }
 
         void increaseBrightness()
         {
-            if (!anyOn())
-            {
-                for (auto& light : lights)
-                {
-                    light.setState({true, Light::OFF_VALUE});
-                }
-            }
-            for (auto& light : lights)
-                light.increaseBrightness();
+            stepBrightness(1);
         }
 
         void decreaseBrightness()
         {
-            if (anyOn())
-                for (auto& light : lights)
-                    light.decreaseBrightness();
+            stepBrightness(-1);
+        }
+
+        /** Several perceptual steps as one change, as a fast knob spin sends them */
+        void stepBrightness(const int8_t steps)
+        {
+            Command command{Command::Type::StepBrightness};
+            command.steps = steps;
+            post(command);
+        }
+
+        /** Sets the value of the selected channels and leaves them on or off */
+        void setValues(const std::array<uint8_t, 4>& values, const uint8_t channels)
+        {
+            Command command{Command::Type::SetValues, channels};
+            for (size_t i = 0; i < values.size(); ++i)
+                command.state.values[i].value = values[i];
+            post(command);
         }
 
         void setColor(const uint8_t r, const uint8_t g, const uint8_t b)
         {
-            lights.at(static_cast<size_t>(Color::Red)).setValue(r);
-            lights.at(static_cast<size_t>(Color::Green)).setValue(g);
-            lights.at(static_cast<size_t>(Color::Blue)).setValue(b);
+            post({Command::Type::SetValues, ALL_CHANNELS & ~channelOf(Color::White),
+                  {{{{false, r}, {false, g}, {false, b}, {}}}}});
         }
 
         void setColor(const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t w)
         {
-            lights.at(static_cast<size_t>(Color::Red)).setValue(r);
-            lights.at(static_cast<size_t>(Color::Green)).setValue(g);
-            lights.at(static_cast<size_t>(Color::Blue)).setValue(b);
-            lights.at(static_cast<size_t>(Color::White)).setValue(w);
+            post({Command::Type::SetValues, ALL_CHANNELS, {{{{false, r}, {false, g}, {false, b}, {false, w}}}}});
         }
 
         void setOn(const bool r, const bool g, const bool b, const bool w)
         {
-            lights.at(static_cast<size_t>(Color::Red)).setOn(r);
-            lights.at(static_cast<size_t>(Color::Green)).setOn(g);
-            lights.at(static_cast<size_t>(Color::Blue)).setOn(b);
-            lights.at(static_cast<size_t>(Color::White)).setOn(w);
+            post({Command::Type::SetOn, ALL_CHANNELS, {{{{r, 0}, {g, 0}, {b, 0}, {w, 0}}}}});
         }
 
-        void setAll(const uint8_t value, const bool on)
+        void setAll(const uint8_t value, const bool on, const unsigned long transitionMs = DEFAULT_TRANSITION_MS)
         {
-            for (auto& light : lights)
-            {
-                light.setValue(value);
-                light.setOn(on);
-            }
+            post({Command::Type::SetState, ALL_CHANNELS, {{{{on, value}, {on, value}, {on, value}, {on, value}}}}},
+                 transitionMs);
+        }
+
+        /** Loads a complete state, fading to it over transitionMs */
+        void setState(const State& state, const unsigned long transitionMs = DEFAULT_TRANSITION_MS)
+        {
+            setChannels(state, ALL_CHANNELS, transitionMs);
+        }
+
+        /**
+         * Sets value and on of the selected channels as one change, so
+         * they never show up half applied. The other channels are left as
+         * they are.
+         */
+        void setChannels(const State& state, const uint8_t channels,
+                         const unsigned long transitionMs = DEFAULT_TRANSITION_MS)
+        {
+            post({Command::Type::SetState, channels, state}, transitionMs);
+        }
+
+        /**
+         * Turns the selected channels on at the given values and the others
+         * off, keeping their values, as one change.
+         */
+        void showChannels(const std::array<uint8_t, 4>& values, const uint8_t channels,
+                          const unsigned long transitionMs = DEFAULT_TRANSITION_MS)
+        {
+            Command command{Command::Type::ShowChannels, channels};
+            for (size_t i = 0; i < values.size(); ++i)
+                command.state.values[i] = {true, values[i]};
+            post(command, transitionMs);
         }
 
-        void setState(const State& state)
+        [[nodiscard]] CommandStats getCommandStats() const
         {
-            for (size_t i = 0; i < std::min(lights.size(), state.values.size()); ++i)
-                lights.at(i).setState(state.values[i]);
+            auto dropped = unassignedDrops.load(std::memory_order_relaxed);
+            for (const auto& producer : producers)
+                dropped += producer.dropped.load(std::memory_order_relaxed);
+            return {
+                appliedCommands.load(std::memory_order_relaxed),
+                dropped,
+                lastLatencyUs.load(std::memory_order_relaxed),
+                maxLatencyUs.load(std::memory_order_relaxed)
+            };
+        }
+
+        /** Fills one entry per task that posted so far and returns how many there are */
+        uint8_t getProducerStats(std::array<ProducerStats, MAX_PRODUCERS>& stats) const
+        {
+            uint8_t count = 0;
+            for (const auto& producer : producers)
+            {
+                const auto task = producer.task.load(std::memory_order_acquire);
+                if (task == nullptr) break;
+                stats[count++] = {
+                    pcTaskGetName(task),
+                    producer.dropped.load(std::memory_order_relaxed),
+                    producer.highWater.load(std::memory_order_relaxed)
+                };
+            }
+            return count;
         }
 
         [[nodiscard]] bool anyOn() const
         {
-            return std::any_of(lights.begin(), lights.end(),
-                               [](const Light& light) { return light.isOn(); });
+            return getState().anyOn();
         }
 
         [[nodiscard]] bool anyVisible() const
         {
-            return std::any_of(lights.begin(), lights.end(),
-                               [](const Light& light) { return light.isVisible(); });
+            return getState().anyVisible();
         }
 
-        [[nodiscard]] uint8_t getValue(Color color) const
+        [[nodiscard]] uint8_t getValue(const Color color) const
         {
-            return lights.at(static_cast<size_t>(color)).getValue();
+            return getState().getValue(color);
         }
 
-        [[nodiscard]] bool isOn(Color color) const
+        [[nodiscard]] bool isOn(const Color color) const
         {
-            return lights.at(static_cast<size_t>(color)).isOn();
+            return getState().isOn(color);
         }
 
         [[nodiscard]] std::array<uint8_t, 4> getValues() const
         {
+            const auto state = getState();
             std::array<uint8_t, 4> output = {};
-            std::transform(lights.begin(), lights.end(), output.begin(), [](const auto& light)
-            {
-                return light.getValue();
-            });
+            std::transform(state.values.begin(), state.values.end(), output.begin(),
+                           [](const Light::State& light) { return light.value; });
             return output;
         }
 
+        /** The state as of the last applied batch of commands; safe from any task */
         [[nodiscard]] State getState() const
         {
-            std::array<Light::State, 4> state;
-            std::transform(lights.begin(), lights.end(), state.begin(),
-                           [](const Light& light) { return light.getState(); });
-            return {state};
+            return snapshot.load();
         }
 
         void fillState(const JsonObject& root) const override
         {
             const auto arr = root["output"].to<JsonArray>();
-            for (const auto& light : lights)
+            for (const auto& light : getState().values)
                 light.toJson(arr.add<JsonObject>());
+            persistence.toJson(root["outputPersistence"].to<JsonObject>());
+            const auto stats = getCommandStats();
+            const auto commandsJson = root["outputCommands"].to<JsonObject>();
+            commandsJson["applied"] = stats.applied;
+            commandsJson["dropped"] = stats.dropped;
+            commandsJson["lastLatencyUs"] = stats.lastLatencyUs;
+            commandsJson["maxLatencyUs"] = stats.maxLatencyUs;
+            std::array<ProducerStats, MAX_PRODUCERS> producerStats;
+            const auto count = getProducerStats(producerStats);
+            const auto producersJson = commandsJson["producers"].to<JsonArray>();
+            for (uint8_t i = 0; i < count; ++i)
+            {
+                const auto producerJson = producersJson.add<JsonObject>();
+                producerJson["task"] = producerStats[i].task;
+                producerJson["dropped"] = producerStats[i].dropped;
+                producerJson["highWater"] = producerStats[i].highWater;
+            }
+        }
+
+        [[nodiscard]] const char* getStateFields() const override
+        {
+            return "output,outputPersistence,outputCommands";
+        }
+
+        [[nodiscard]] ChangeBus::Mask getStateTopics() const override
+        {
+            return ChangeBus::maskOf(ChangeBus::Topic::Output);
+        }
+
+        [[nodiscard]] Persistence::Stats getPersistenceStats() const
+        {
+            return persistence.getStats();
         }
 
         AsyncWebHandler* createAsyncWebHandler() override
@@ -271,20 +509,274 @@ namespace Output
         }
 
     private:
+        void changed()
+        {
+            ChangeBus::publish(ChangeBus::Topic::Output);
+        }
+
+        /**
+         * Queues the command for the output task. The transition travels
+         * with it, so a burst of commands between two frames fades in over
+         * the transition of the last one.
+         */
+        void post(Command command, const unsigned long transitionMs = DEFAULT_TRANSITION_MS)
+        {
+            command.transitionMs = static_cast<uint16_t>(std::min(transitionMs, MAX_TRANSITION_MS));
+            auto* producer = producerOf(xTaskGetCurrentTaskHandle());
+            if (producer == nullptr)
+            {
+                unassignedDrops.fetch_add(1, std::memory_order_relaxed);
+                ESP_LOGW(LOG_TAG, "More than %u tasks post output commands, dropping one", MAX_PRODUCERS);
+                return;
+            }
+            command.queuedUs = micros();
+            if (!producer->ring.push(command))
+            {
+                producer->dropped.fetch_add(1, std::memory_order_relaxed);
+                ESP_LOGW(LOG_TAG, "Output command ring of %s full, dropping a command",
+                         pcTaskGetName(producer->task.load(std::memory_order_relaxed)));
+            }
+            else if (const uint32_t size = producer->ring.size();
+                size > producer->highWater.load(std::memory_order_relaxed))
+            {
+                producer->highWater.store(size, std::memory_order_relaxed);
+            }
+            EventLoop::wake(EventLoop::Task::Output);
+        }
+
+        /**
+         * Slots are claimed in order and never released, so a task that
+         * reaches a free slot has none yet and takes it.
+         */
+        Producer* producerOf(const TaskHandle_t task)
+        {
+            for (auto& producer : producers)
+            {
+                auto owner = producer.task.load(std::memory_order_acquire);
+                if (owner == nullptr &&
+                    producer.task.compare_exchange_strong(owner, task, std::memory_order_acq_rel))
+                    return &producer;
+                if (owner == task)
+                    return &producer;
+            }
+            return nullptr;
+        }
+
+        /**
+         * Applies what the rings hold, oldest first across them. At most a
+         * full set of rings per pass, so busy producers cannot hold off the
+         * render.
+         */
+        void applyCommands()
+        {
+            bool applied = false;
+            for (size_t budget = MAX_PRODUCERS * PRODUCER_RING_SIZE; budget != 0; --budget)
+            {
+                Producer* oldest = nullptr;
+                for (auto& producer : producers)
+                {
+                    if (producer.task.load(std::memory_order_acquire) == nullptr) break;
+                    const auto* command = producer.ring.front();
+                    if (command != nullptr &&
+                        (oldest == nullptr ||
+                            static_cast<int32_t>(command->queuedUs - oldest->ring.front()->queuedUs) < 0))
+                        oldest = &producer;
+                }
+                if (oldest == nullptr) break;
+
+                const auto& command = *oldest->ring.front();
+                if (!oldestUnrenderedUs)
+                    oldestUnrenderedUs = command.queuedUs;
+                apply(command);
+                oldest->ring.pop();
+                appliedCommands.fetch_add(1, std::memory_order_relaxed);
+                applied = true;
+            }
+            if (applied)
+            {
+                publish();
+                changed();
+            }
+        }
+
+        /** Output task only; readers see the new state before the change is announced */
+        void publish()
+        {
+            std::array<Light::State, 4> state;
+            std::transform(lights.begin(), lights.end(), state.begin(),
+                           [](const Light& light) { return light.getState(); });
+            snapshot.store({state});
+        }
+
+        void apply(const Command& command)
+        {
+            batchTransitionMs = command.transitionMs;
+            switch (command.type)
+            {
+            case Command::Type::SetValues:
+                forEachChannel(command, [](Light& light, const Light::State& state) { light.setValue(state.value); });
+                break;
+            case Command::Type::SetOn:
+                forEachChannel(command, [](Light& light, const Light::State& state) { light.setOn(state.on); });
+                break;
+            case Command::Type::SetState:
+                forEachChannel(command, [](Light& light, const Light::State& state) { light.setState(state); });
+                break;
+            case Command::Type::Toggle:
+                forEachChannel(command, [](Light& light, const Light::State&)
+                {
+                    const bool on = !light.isVisible();
+                    light.setOn(on);
+                    if (on)
+                        light.makeVisible();
+                });
+                break;
+            case Command::Type::ToggleAll:
+                {
+                    const bool on = anyLightVisible();
+                    for (auto& light : lights)
+                    {
+                        if (on)
+                        {
+                            light.setOn(false);
+                        }
+                        else
+                        {
+                            light.setOn(true);
+                            light.setValue(Light::ON_VALUE);
+                        }
+                    }
+                }
+                break;
+            case Command::Type::TurnOffAll:
+                for (auto& light : lights)
+                    light.setOn(false);
+                break;
+            case Command::Type::TurnOnAll:
+                for (auto& light : lights)
+                    light.makeVisible();
+                break;
+            case Command::Type::StepBrightness:
+                if (command.steps > 0 && !anyLightOn())
+                {
+                    for (auto& light : lights)
+                    {
+                        light.setState({true, Light::OFF_VALUE});
+                    }
+                }
+                if (command.steps > 0 || anyLightOn())
+                    for (auto& light : lights)
+                        light.stepBrightness(command.steps);
+                break;
+            case Command::Type::ShowChannels:
+                for (size_t i = 0; i < lights.size(); ++i)
+                {
+                    if (command.channels & 1 << i)
+                        lights[i].setState(command.state.values[i]);
+                    else
+                        lights[i].setOn(false);
+                }
+                break;
+            }
+        }
+
+        /** The lights as left by the commands applied so far, which the snapshot may not show yet */
+        [[nodiscard]] bool anyLightOn() const
+        {
+            return std::any_of(lights.begin(), lights.end(), [](const Light& light) { return light.isOn(); });
+        }
+
+        [[nodiscard]] bool anyLightVisible() const
+        {
+            return std::any_of(lights.begin(), lights.end(), [](const Light& light) { return light.isVisible(); });
+        }
+
+        template <typename Apply>
+        void forEachChannel(const Command& command, Apply&& apply)
+        {
+            for (size_t i = 0; i < lights.size(); ++i)
+                if (command.channels & 1 << i) apply(lights[i], command.state.values[i]);
+        }
+
+        [[nodiscard]] std::array<uint8_t, 4> getTarget() const
+        {
+            std::array<uint8_t, 4> target = realtimeDuties;
+            if (!realtime)
+                std::transform(lights.begin(), lights.end(), target.begin(),
+                               [](const Light& light) { return light.getDuty(); });
+            return target;
+        }
+
+        /** A new target is rendered right away; only transition frames wait for FRAME_INTERVAL_MS */
+        void renderFrame(const unsigned long now)
+        {
+            if (realtime && now - realtimeTime >= REALTIME_TIMEOUT_MS)
+            {
+                ESP_LOGI(LOG_TAG, "Realtime stream timed out, restoring state");
+                realtime = false;
+            }
+
+            const auto target = getTarget();
+            if (now - lastFrameTime < FRAME_INTERVAL_MS && target == transition.target) return;
+            lastFrameTime = now;
+
+            if (target != transition.target)
+            {
+                transition.from = levels;
+                std::transform(target.begin(), target.end(), transition.to.begin(), Gamma::Perceptual::toLevel);
+                transition.target = target;
+                transition.startTime = now;
+                transition.duration = realtime ? 0 : batchTransitionMs;
+            }
+
+            const auto elapsed = now - transition.startTime;
+            if (elapsed >= transition.duration)
+            {
+                levels = transition.to;
+                std::transform(levels.begin(), levels.end(), frameDuties.begin(), Gamma::Perceptual::toDuty16);
+                return;
+            }
+
+            const float progress = static_cast<float>(elapsed) / static_cast<float>(transition.duration);
+            for (size_t i = 0; i < lights.size(); ++i)
+            {
+                levels[i] = interpolate(transition.from[i], transition.to[i], progress);
+                frameDuties[i] = Gamma::Perceptual::toDuty16(levels[i]);
+            }
+        }
+
+        /**
+         * Blends two levels in perceptual (gamma) space so fades look linear to the eye.
+         */
+        static Gamma::Perceptual::Level interpolate(const Gamma::Perceptual::Level from,
+                                                    const Gamma::Perceptual::Level to,
+                                                    const float progress)
+        {
+            const auto delta = static_cast<float>(static_cast<int32_t>(to) - static_cast<int32_t>(from));
+            return static_cast<Gamma::Perceptual::Level>(from + lroundf(delta * progress));
+        }
+
         void sendColorNotification(const unsigned long now)
         {
+            if (!bleChanges.pending()) return;
+
             std::lock_guard bleLock(getBleMutex());
+            (void)bleChanges.take();
             if (bleOutputColorCharacteristic == nullptr) return;
 
             State state = getState();
             if (!colorNotificationThrottle.shouldSend(now, state))
+            {
+                if (colorNotificationThrottle.hasChanged(state))
+                    bleChanges.mark(ChangeBus::Topic::Output);
                 return;
+            }
 
             bleOutputColorCharacteristic->setValue(reinterpret_cast<uint8_t*>(&state), sizeof(state));
             if (bleOutputColorCharacteristic->notify())
-            {
                 colorNotificationThrottle.setLastSent(now, state);
-            }
+            else
+                bleChanges.mark(ChangeBus::Topic::Output);
         }
 
         class AsyncRestWebHandler final : public AsyncWebHandler
@@ -317,30 +809,37 @@ namespace Output
             {
                 if (!request->hasParam("value"))
                     return sendMessageJsonResponse(request, "Missing 'value' parameter");
+                const auto transitionMs = extractUint16Param(request, "transition").value_or(DEFAULT_TRANSITION_MS);
                 if (const auto value = extractUint8Param(request, "value"))
                 {
-                    output->setState({true, value.value()});
+                    output->setState({true, value.value()}, transitionMs);
                     sendMessageJsonResponse(request, "Brightness set");
                 }
                 else
                 {
-                    output->turnOffAll();
+                    output->turnOffAll(transitionMs);
                     sendMessageJsonResponse(request, "Light turned off");
                 }
             }
 
             void handleColorRequest(AsyncWebServerRequest* request) const
             {
-                const auto oldR = output->getValue(Color::Red);
-                const auto oldG = output->getValue(Color::Green);
-                const auto oldB = output->getValue(Color::Blue);
-                const auto oldW = output->getValue(Color::White);
                 const auto r = extractUint8Param(request, "r");
                 const auto g = extractUint8Param(request, "g");
                 const auto b = extractUint8Param(request, "b");
                 const auto w = extractUint8Param(request, "w");
-                output->setColor(r.value_or(oldR), g.value_or(oldG), b.value_or(oldB), w.value_or(oldW));
-                output->setOn(r.has_value(), g.has_value(), b.has_value(), w.has_value());
+                const auto transitionMs = extractUint16Param(request, "transition").value_or(DEFAULT_TRANSITION_MS);
+                // Channels left out are switched off but keep their value
+                const std::array<std::optional<uint8_t>, 4> params = {r, g, b, w};
+                std::array<uint8_t, 4> values = {};
+                uint8_t channels = 0;
+                for (size_t i = 0; i < params.size(); ++i)
+                {
+                    if (!params[i]) continue;
+                    values[i] = params[i].value();
+                    channels |= 1 << i;
+                }
+                output->showChannels(values, channels, transitionMs);
                 sendMessageJsonResponse(request, "Color updated");
             }
         };
@@ -360,8 +859,8 @@ namespace Output
                 constexpr uint8_t size = sizeof(State);
                 if (pCharacteristic->getValue().size() != size)
                 {
-                    ESP_LOGE(LOG_TAG, "Received invalid Alexa color values length: %d",
-                             pCharacteristic->getValue().size());
+                    ESP_LOGE(LOG_TAG, "Received invalid Alexa color values length: %u",
+                             static_cast<unsigned>(pCharacteristic->getValue().size()));
                     return;
                 }
                 memcpy(&state, pCharacteristic->getValue().data(), size);
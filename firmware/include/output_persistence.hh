@@ -0,0 +1,233 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <optional>
+#include <Arduino.h>
+#include <Preferences.h>
+
+#include "async_call.hh"
+#include "event_loop.hh"
+#include "output_state.hh"
+
+namespace Output
+{
+    /**
+     * Saves the whole output state as a single NVS blob.
+     *
+     * Changes are coalesced: a write happens once the state has been stable
+     * for the current debounce window, or at the latest MAX_DIRTY_MS after the
+     * first unsaved change. The window doubles while writes keep following
+     * each other closely and resets once things calm down. Writes run on an
+     * async_call worker so NVS never stalls the output task; a write that
+     * fails or finds no worker is tried again a debounce window later.
+     */
+    class Persistence
+    {
+        static constexpr auto LOG_TAG = "OutputPersistence";
+
+        static constexpr auto PREFERENCES_NAME = "output";
+        static constexpr auto PREFERENCES_STATE_KEY = "state";
+        static constexpr auto LEGACY_PREFERENCES_NAME = "light";
+
+    public:
+        static constexpr unsigned long MIN_DEBOUNCE_MS = 500;
+        static constexpr unsigned long MAX_DEBOUNCE_MS = 8000;
+        static constexpr unsigned long MAX_DIRTY_MS = 15000;
+
+        struct Stats
+        {
+            uint32_t changes = 0;
+            uint32_t writes = 0;
+            uint32_t lastWriteDurationUs = 0;
+            unsigned long debounceMs = MIN_DEBOUNCE_MS;
+        };
+
+    private:
+        State lastSeenState;
+        /** Empty when what NVS holds is unknown, after a failed write */
+        std::optional<State> persistedState;
+        bool dirty = false;
+        unsigned long firstDirtyTime = 0;
+        unsigned long lastChangeTime = 0;
+        unsigned long lastWriteTime = 0;
+        unsigned long debounceMs = MIN_DEBOUNCE_MS;
+
+        std::atomic<bool> writing = false;
+        /** Set by a write job whose putBytes failed, before it clears writing */
+        std::atomic<bool> writeFailed = false;
+        std::atomic<uint32_t> changes = 0;
+        std::atomic<uint32_t> writes = 0;
+        std::atomic<uint32_t> lastWriteDurationUs = 0;
+
+    public:
+        /**
+         * Loads the saved state, migrating the per-light keys used by older
+         * firmware when no blob exists yet. The migration writes the blob
+         * right away and removes the old keys only once it is stored.
+         */
+        std::optional<State> restore(const std::array<gpio_num_t, 4>& pins)
+        {
+            std::optional<State> restored = std::nullopt;
+            {
+                Preferences prefs;
+                prefs.begin(PREFERENCES_NAME, true);
+                if (State state; prefs.getBytes(PREFERENCES_STATE_KEY, &state, sizeof(state)) == sizeof(state))
+                    restored = state;
+                prefs.end();
+            }
+            if (restored)
+            {
+                lastSeenState = restored.value();
+                persistedState = restored;
+            }
+            else if ((restored = restoreLegacy(pins)))
+            {
+                lastSeenState = restored.value();
+                if (store(restored.value()))
+                {
+                    persistedState = restored.value();
+                    removeLegacy(pins);
+                    ESP_LOGI(LOG_TAG, "Migrated output state from per-light preferences");
+                }
+            }
+            return restored;
+        }
+
+        void handle(const unsigned long now, const State& state)
+        {
+            if (state != lastSeenState)
+            {
+                lastSeenState = state;
+                lastChangeTime = now;
+                ++changes;
+                if (!dirty)
+                {
+                    dirty = true;
+                    firstDirtyTime = now;
+                }
+            }
+
+            if (writing) return;
+            if (writeFailed.exchange(false))
+            {
+                persistedState.reset();
+                retryLater(now);
+            }
+            if (!dirty) return;
+            if (now - lastChangeTime < debounceMs && now - firstDirtyTime < MAX_DIRTY_MS) return;
+
+            dirty = false;
+            if (state == persistedState) return;
+
+            debounceMs = now - lastWriteTime < debounceMs * 4
+                             ? std::min(debounceMs * 2, MAX_DEBOUNCE_MS)
+                             : MIN_DEBOUNCE_MS;
+            lastWriteTime = now;
+            if (write(state))
+                persistedState = state;
+            else
+                retryLater(now);
+        }
+
+        /** A running write wakes the loop once it is done */
+        void schedule(EventLoop::Deadline& next) const
+        {
+            if (!dirty || writing) return;
+            next.at(lastChangeTime + debounceMs);
+            next.at(firstDirtyTime + MAX_DIRTY_MS);
+        }
+
+        [[nodiscard]] Stats getStats() const
+        {
+            return {changes, writes, lastWriteDurationUs, debounceMs};
+        }
+
+        void toJson(const JsonObject& to) const
+        {
+            const auto stats = getStats();
+            to["changes"] = stats.changes;
+            to["writes"] = stats.writes;
+            to["lastWriteDurationUs"] = stats.lastWriteDurationUs;
+            to["debounceMs"] = stats.debounceMs;
+        }
+
+    private:
+        /** Marks the state unsaved again, a debounce window from now so a failing write never spins */
+        void retryLater(const unsigned long now)
+        {
+            dirty = true;
+            firstDirtyTime = lastChangeTime = now;
+        }
+
+        /** Returns false when no worker could take the write */
+        bool write(const State& state)
+        {
+            writing = true;
+            const bool scheduled = async_call([this, state]
+            {
+                const auto start = micros();
+                if (store(state))
+                    ++writes;
+                else
+                    writeFailed = true;
+                lastWriteDurationUs = micros() - start;
+                writing = false;
+                EventLoop::wake(EventLoop::Task::Output);
+            });
+            if (!scheduled)
+                writing = false;
+            return scheduled;
+        }
+
+        static bool store(const State& state)
+        {
+            Preferences prefs;
+            prefs.begin(PREFERENCES_NAME, false);
+            const bool stored = prefs.putBytes(PREFERENCES_STATE_KEY, &state, sizeof(state)) == sizeof(state);
+            prefs.end();
+            if (!stored)
+                ESP_LOGE(LOG_TAG, "Failed to persist output state");
+            return stored;
+        }
+
+        static void legacyKeys(const gpio_num_t pin, char (&onKey)[5], char (&valueKey)[5])
+        {
+            snprintf(onKey, sizeof(onKey), "%02uo", static_cast<unsigned>(pin));
+            snprintf(valueKey, sizeof(valueKey), "%02uv", static_cast<unsigned>(pin));
+        }
+
+        static std::optional<State> restoreLegacy(const std::array<gpio_num_t, 4>& pins)
+        {
+            Preferences prefs;
+            prefs.begin(LEGACY_PREFERENCES_NAME, true);
+            std::optional<State> restored = std::nullopt;
+            for (size_t i = 0; i < pins.size(); ++i)
+            {
+                char onKey[5];
+                char valueKey[5];
+                legacyKeys(pins[i], onKey, valueKey);
+                if (!prefs.isKey(onKey) && !prefs.isKey(valueKey)) continue;
+                if (!restored) restored = State();
+                restored->values[i] = {prefs.getBool(onKey, false), prefs.getUChar(valueKey, Light::OFF_VALUE)};
+            }
+            prefs.end();
+            return restored;
+        }
+
+        static void removeLegacy(const std::array<gpio_num_t, 4>& pins)
+        {
+            Preferences prefs;
+            prefs.begin(LEGACY_PREFERENCES_NAME, false);
+            for (const auto pin : pins)
+            {
+                char onKey[5];
+                char valueKey[5];
+                legacyKeys(pin, onKey, valueKey);
+                prefs.remove(onKey);
+                prefs.remove(valueKey);
+            }
+            prefs.end();
+        }
+    };
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+
+#include "color.hh"
+#include "light.hh"
+
+namespace Output
+{
+#pragma pack(push, 1)
+    struct State
+    {
+        std::array<Light::State, 4> values = {};
+
+        bool operator==(const State& other) const
+        {
+            return values == other.values;
+        }
+
+        bool operator!=(const State& other) const
+        {
+            return values != other.values;
+        }
+
+        [[nodiscard]] bool isOn(Color color) const
+        {
+            return values.at(static_cast<size_t>(color)).on;
+        }
+
+        [[nodiscard]] uint8_t getValue(Color color) const
+        {
+            return values.at(static_cast<size_t>(color)).value;
+        }
+
+        [[nodiscard]] bool anyOn() const
+        {
+            return std::any_of(values.begin(), values.end(),
+                               [](const Light::State& s) { return s.on; });
+        }
+
+        [[nodiscard]] bool anyVisible() const
+        {
+            return std::any_of(values.begin(), values.end(),
+                               [](const Light::State& s) { return s.on && s.value > 0; });
+        }
+    };
+#pragma pack(pop)
+}
@@ -1,7 +1,8 @@
 #pragma once
 
 #include <Arduino.h>
-#include <functional>
+#include "event_loop.hh"
+#include "inplace_function.hh"
 
 class PushButton
 {
@@ -15,10 +16,14 @@ class PushButton
     unsigned long longPressThresholdMs = 2500;
     unsigned long debounceDelayMs = 50;
 
-    std::function<void()> longPressCallback;
-    std::function<void()> shortPressCallback;
+public:
+    using Callback = InplaceFunction<void()>;
+
+private:
+    Callback longPressCallback;
+    Callback shortPressCallback;
 
-    static void maybeInvoke(const std::function<void()>& cb)
+    static void maybeInvoke(const Callback& cb)
     {
         if (cb) cb();
     }
@@ -29,17 +34,19 @@ public:
     {
     }
 
+    /** Buttons are handled on the output task, where there is one */
     void begin() const
     {
         pinMode(this->pin, INPUT_PULLUP);
+        EventLoop::wakeOnPin(this->pin, EventLoop::Task::Output);
     }
 
-    void setLongPressCallback(const std::function<void()>& callback)
+    void setLongPressCallback(const Callback& callback)
     {
         longPressCallback = callback;
     }
 
-    void setShortPressCallback(const std::function<void()>& callback)
+    void setShortPressCallback(const Callback& callback)
     {
         shortPressCallback = callback;
     }
@@ -83,4 +90,12 @@ public:
 
         lastState = currentState;
     }
+
+    /** Edges wake the loop by themselves; only a settling bounce or a held button need a deadline */
+    void schedule(EventLoop::Deadline& next) const
+    {
+        next.afterWindow(lastChange, debounceDelayMs);
+        if (lastState == LOW && !longPressHandled)
+            next.at(lastDown + longPressThresholdMs);
+    }
 };
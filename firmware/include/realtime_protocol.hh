@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+namespace Realtime
+{
+    /** The four output duties carried by one realtime packet */
+    struct Frame
+    {
+        std::array<uint8_t, 4> duties = {};
+        /** Channels present in the packet; the others keep their last value */
+        uint8_t channels = 0;
+        /** Set when the sender sequences its packets; 0 means unsequenced */
+        uint8_t sequence = 0;
+        /** Frame is complete and should be shown now */
+        bool push = false;
+        /** The sender ended the stream */
+        bool terminated = false;
+    };
+
+    /**
+     * Distributed Display Protocol (http://www.3waylabs.com/ddp/).
+     * Byte offset 0..3 of the default output maps to red, green, blue and
+     * white; an RGB data type only feeds the first three.
+     */
+    namespace DDP
+    {
+        static constexpr uint16_t PORT = 4048;
+        static constexpr size_t HEADER_SIZE = 10;
+        static constexpr size_t TIMECODE_SIZE = 4;
+
+        static constexpr uint8_t VERSION_MASK = 0xC0;
+        static constexpr uint8_t VERSION_1 = 0x40;
+        static constexpr uint8_t FLAG_TIMECODE = 0x10;
+        static constexpr uint8_t FLAG_REPLY = 0x04;
+        static constexpr uint8_t FLAG_QUERY = 0x02;
+        static constexpr uint8_t FLAG_PUSH = 0x01;
+        static constexpr uint8_t SEQUENCE_MASK = 0x0F;
+        static constexpr uint8_t TYPE_MASK = 0x38;
+        static constexpr uint8_t TYPE_RGB = 0x08;
+        static constexpr uint8_t DEFAULT_OUTPUT = 1;
+
+        inline std::optional<Frame> parse(const uint8_t* data, const size_t len)
+        {
+            if (len < HEADER_SIZE) return std::nullopt;
+            const uint8_t flags = data[0];
+            if ((flags & VERSION_MASK) != VERSION_1 || flags & (FLAG_REPLY | FLAG_QUERY)) return std::nullopt;
+            if (data[3] != DEFAULT_OUTPUT) return std::nullopt;
+
+            const size_t header = HEADER_SIZE + (flags & FLAG_TIMECODE ? TIMECODE_SIZE : 0);
+            const uint32_t offset = static_cast<uint32_t>(data[4]) << 24 | static_cast<uint32_t>(data[5]) << 16 |
+                static_cast<uint32_t>(data[6]) << 8 | data[7];
+            const size_t length = static_cast<size_t>(data[8]) << 8 | data[9];
+            if (len < header + length) return std::nullopt;
+
+            Frame frame;
+            frame.sequence = data[1] & SEQUENCE_MASK;
+            frame.push = flags & FLAG_PUSH;
+            const uint8_t channelCount = (data[2] & TYPE_MASK) == TYPE_RGB ? 3 : 4;
+            for (size_t i = offset; i < channelCount && i - offset < length; ++i)
+            {
+                frame.duties[i] = data[header + i - offset];
+                frame.channels |= 1 << i;
+            }
+            return frame;
+        }
+    }
+
+    /**
+     * Streaming ACN (ANSI E1.31) DMX data packets. Four consecutive slots,
+     * starting at a 1-based DMX address of one universe, map to red, green,
+     * blue and white.
+     */
+    namespace E131
+    {
+        static constexpr uint16_t PORT = 5568;
+        static constexpr size_t HEADER_SIZE = 126;
+        static constexpr uint16_t MAX_UNIVERSE = 63999;
+        static constexpr uint16_t MAX_ADDRESS = 512 - 3;
+
+        static constexpr size_t PACKET_IDENTIFIER_OFFSET = 4;
+        static constexpr std::array<uint8_t, 12> PACKET_IDENTIFIER = {
+            'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0
+        };
+        static constexpr size_t ROOT_VECTOR_OFFSET = 18;
+        static constexpr uint32_t VECTOR_ROOT_E131_DATA = 0x00000004;
+        static constexpr size_t FRAMING_VECTOR_OFFSET = 40;
+        static constexpr uint32_t VECTOR_E131_DATA_PACKET = 0x00000002;
+        static constexpr size_t SEQUENCE_OFFSET = 111;
+        static constexpr size_t OPTIONS_OFFSET = 112;
+        static constexpr uint8_t OPTION_PREVIEW = 0x80;
+        static constexpr uint8_t OPTION_TERMINATED = 0x40;
+        static constexpr size_t UNIVERSE_OFFSET = 113;
+        static constexpr size_t DMP_VECTOR_OFFSET = 117;
+        static constexpr uint8_t VECTOR_DMP_SET_PROPERTY = 0x02;
+        static constexpr size_t PROPERTY_COUNT_OFFSET = 123;
+        static constexpr size_t START_CODE_OFFSET = 125;
+        static constexpr uint8_t DMX_START_CODE = 0x00;
+
+        inline uint16_t readUint16(const uint8_t* data)
+        {
+            return static_cast<uint16_t>(data[0] << 8 | data[1]);
+        }
+
+        inline uint32_t readUint32(const uint8_t* data)
+        {
+            return static_cast<uint32_t>(readUint16(data)) << 16 | readUint16(data + 2);
+        }
+
+        /** IPv4 multicast group a universe is sent to: 239.255.<hi>.<lo> */
+        inline std::array<uint8_t, 4> multicastGroup(const uint16_t universe)
+        {
+            return {239, 255, static_cast<uint8_t>(universe >> 8), static_cast<uint8_t>(universe)};
+        }
+
+        inline std::optional<Frame> parse(const uint8_t* data, const size_t len, const uint16_t universe,
+                                          const uint16_t address)
+        {
+            if (len < HEADER_SIZE) return std::nullopt;
+            if (std::memcmp(data + PACKET_IDENTIFIER_OFFSET, PACKET_IDENTIFIER.data(), PACKET_IDENTIFIER.size()))
+                return std::nullopt;
+            if (readUint32(data + ROOT_VECTOR_OFFSET) != VECTOR_ROOT_E131_DATA ||
+                readUint32(data + FRAMING_VECTOR_OFFSET) != VECTOR_E131_DATA_PACKET ||
+                data[DMP_VECTOR_OFFSET] != VECTOR_DMP_SET_PROPERTY)
+                return std::nullopt;
+            if (readUint16(data + UNIVERSE_OFFSET) != universe || data[START_CODE_OFFSET] != DMX_START_CODE)
+                return std::nullopt;
+            if (data[OPTIONS_OFFSET] & OPTION_PREVIEW)
+                return std::nullopt;
+
+            Frame frame;
+            frame.sequence = data[SEQUENCE_OFFSET];
+            frame.terminated = data[OPTIONS_OFFSET] & OPTION_TERMINATED;
+            frame.push = true;
+            // The count includes the start code
+            const size_t slots = std::min<size_t>(readUint16(data + PROPERTY_COUNT_OFFSET), len - START_CODE_OFFSET);
+            for (uint8_t i = 0; i < frame.duties.size() && address + i < slots; ++i)
+            {
+                frame.duties[i] = data[START_CODE_OFFSET + address + i];
+                frame.channels |= 1 << i;
+            }
+            return frame;
+        }
+    }
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <AsyncUDP.h>
+
+#include "event_loop.hh"
+#include "output_manager.hh"
+#include "realtime_protocol.hh"
+#include "state_json_filler.hh"
+
+namespace Realtime
+{
+    /**
+     * Shows frames streamed over DDP or E1.31 on the outputs.
+     *
+     * Packets are parsed on the network task and only the newest complete
+     * frame is kept for the output task, so a frame replaced before it was
+     * shown is counted as dropped instead of queuing up. Streamed frames
+     * bypass the stored state entirely; see Output::Manager::setRealtimeDuties.
+     * handle() and schedule() belong to the output task.
+     */
+    class Receiver final : public StateJsonFiller
+    {
+        static constexpr auto LOG_TAG = "RealtimeReceiver";
+        static constexpr unsigned long RATE_INTERVAL_MS = 1000;
+        /** DDP sequence numbers run 1..15, 0 meaning unused */
+        static constexpr uint8_t DDP_SEQUENCE_COUNT = 15;
+        /** E1.31 discards packets up to this many sequence steps behind */
+        static constexpr int8_t E131_REORDER_WINDOW = -20;
+
+    public:
+        static constexpr uint16_t DEFAULT_UNIVERSE = 1;
+        static constexpr uint16_t DEFAULT_ADDRESS = 1;
+
+        struct Stats
+        {
+            uint32_t packets = 0;
+            uint32_t frames = 0;
+            uint32_t late = 0;
+            uint32_t dropped = 0;
+            uint32_t invalid = 0;
+            uint32_t frameRate = 0;
+        };
+
+    private:
+        Output::Manager& outputManager;
+        const uint16_t universe;
+        const uint16_t address;
+
+        AsyncUDP ddpUdp;
+        AsyncUDP e131Udp;
+
+        // Network task only
+        Frame current;
+        uint8_t lastDdpSequence = 0;
+        uint8_t lastE131Sequence = 0;
+        bool hasE131Sequence = false;
+
+        std::mutex pendingMutex;
+        Frame pending;
+        std::atomic<bool> hasPending = false;
+
+        std::atomic<uint32_t> packets = 0;
+        std::atomic<uint32_t> received = 0;
+        std::atomic<uint32_t> frames = 0;
+        std::atomic<uint32_t> late = 0;
+        std::atomic<uint32_t> dropped = 0;
+        std::atomic<uint32_t> invalid = 0;
+        std::atomic<uint32_t> frameRate = 0;
+        uint32_t rateWindowReceived = 0;
+        unsigned long rateWindowStart = 0;
+
+    public:
+        explicit Receiver(Output::Manager& outputManager,
+                          const uint16_t universe = DEFAULT_UNIVERSE,
+                          const uint16_t address = DEFAULT_ADDRESS)
+            : outputManager(outputManager),
+              universe(std::clamp<uint16_t>(universe, 1, E131::MAX_UNIVERSE)),
+              address(std::clamp<uint16_t>(address, 1, E131::MAX_ADDRESS))
+        {
+        }
+
+        /** Needs the network up; calling it again rebinds both sockets */
+        void begin()
+        {
+            ddpUdp.onPacket([this](AsyncUDPPacket& packet) { receiveDdp(packet.data(), packet.length()); });
+            e131Udp.onPacket([this](AsyncUDPPacket& packet) { receiveE131(packet.data(), packet.length()); });
+
+            if (!ddpUdp.listen(DDP::PORT))
+                ESP_LOGE(LOG_TAG, "Failed to listen for DDP on port %u", DDP::PORT);
+            const auto group = E131::multicastGroup(universe);
+            if (!e131Udp.listenMulticast(IPAddress(group[0], group[1], group[2], group[3]), E131::PORT))
+                ESP_LOGE(LOG_TAG, "Failed to join E1.31 universe %u", universe);
+            ESP_LOGI(LOG_TAG, "Listening for DDP and E1.31 universe %u, address %u", universe, address);
+        }
+
+        void handle(const unsigned long now)
+        {
+            updateFrameRate(now);
+            if (!hasPending.load(std::memory_order_acquire)) return;
+
+            Frame frame;
+            {
+                std::lock_guard lock(pendingMutex);
+                frame = pending;
+                hasPending.store(false, std::memory_order_relaxed);
+            }
+            if (frame.terminated)
+            {
+                ESP_LOGI(LOG_TAG, "Realtime stream terminated by sender");
+                outputManager.endRealtime();
+                return;
+            }
+            outputManager.setRealtimeDuties(frame.duties, now);
+            frames.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void receiveDdp(const uint8_t* data, const size_t len)
+        {
+            packets.fetch_add(1, std::memory_order_relaxed);
+            const auto frame = DDP::parse(data, len);
+            if (!frame)
+                invalid.fetch_add(1, std::memory_order_relaxed);
+            else if (acceptDdpSequence(frame->sequence))
+                receive(frame.value());
+        }
+
+        void receiveE131(const uint8_t* data, const size_t len)
+        {
+            packets.fetch_add(1, std::memory_order_relaxed);
+            const auto frame = E131::parse(data, len, universe, address);
+            if (!frame)
+                invalid.fetch_add(1, std::memory_order_relaxed);
+            else if (acceptE131Sequence(frame->sequence))
+                receive(frame.value());
+        }
+
+        /** New frames wake the loop; only the frame rate needs updating on time */
+        void schedule(EventLoop::Deadline& next) const
+        {
+            if (received.load(std::memory_order_relaxed) != rateWindowReceived ||
+                frameRate.load(std::memory_order_relaxed) != 0)
+                next.at(rateWindowStart + RATE_INTERVAL_MS);
+        }
+
+        [[nodiscard]] Stats getStats() const
+        {
+            return {
+                packets.load(std::memory_order_relaxed),
+                frames.load(std::memory_order_relaxed),
+                late.load(std::memory_order_relaxed),
+                dropped.load(std::memory_order_relaxed),
+                invalid.load(std::memory_order_relaxed),
+                frameRate.load(std::memory_order_relaxed)
+            };
+        }
+
+        void fillState(const JsonObject& root) const override
+        {
+            const auto stats = getStats();
+            const auto realtime = root["realtime"].to<JsonObject>();
+            realtime["active"] = outputManager.isRealtime();
+            realtime["universe"] = universe;
+            realtime["address"] = address;
+            realtime["packets"] = stats.packets;
+            realtime["frames"] = stats.frames;
+            realtime["late"] = stats.late;
+            realtime["dropped"] = stats.dropped;
+            realtime["invalid"] = stats.invalid;
+            realtime["frameRate"] = stats.frameRate;
+        }
+
+        [[nodiscard]] const char* getStateFields() const override
+        {
+            return "realtime";
+        }
+
+        [[nodiscard]] ChangeBus::Mask getStateTopics() const override
+        {
+            return 0;
+        }
+
+    private:
+        /** Merges the channels of a packet and hands the frame over once pushed */
+        void receive(const Frame& frame)
+        {
+            for (uint8_t i = 0; i < current.duties.size(); ++i)
+                if (frame.channels & 1 << i) current.duties[i] = frame.duties[i];
+            if (!frame.push && !frame.terminated) return;
+
+            received.fetch_add(1, std::memory_order_relaxed);
+            std::lock_guard lock(pendingMutex);
+            if (hasPending.load(std::memory_order_relaxed))
+                dropped.fetch_add(1, std::memory_order_relaxed);
+            pending = current;
+            pending.terminated = frame.terminated;
+            hasPending.store(true, std::memory_order_release);
+            EventLoop::wake(EventLoop::Task::Output);
+        }
+
+        /** Steps of more than half the sequence space backwards are late */
+        bool acceptDdpSequence(const uint8_t sequence)
+        {
+            if (sequence == 0 || lastDdpSequence == 0)
+            {
+                lastDdpSequence = sequence;
+                return true;
+            }
+            const uint8_t step = (sequence - lastDdpSequence + DDP_SEQUENCE_COUNT) % DDP_SEQUENCE_COUNT;
+            if (step == 0 || step > DDP_SEQUENCE_COUNT / 2)
+            {
+                late.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            dropped.fetch_add(step - 1, std::memory_order_relaxed);
+            lastDdpSequence = sequence;
+            return true;
+        }
+
+        /** As in E1.31 6.7.2; a larger step back means the sender restarted */
+        bool acceptE131Sequence(const uint8_t sequence)
+        {
+            const auto step = static_cast<int8_t>(sequence - lastE131Sequence);
+            if (hasE131Sequence && step <= 0 && step > E131_REORDER_WINDOW)
+            {
+                late.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (hasE131Sequence && step > 1)
+                dropped.fetch_add(step - 1, std::memory_order_relaxed);
+            hasE131Sequence = true;
+            lastE131Sequence = sequence;
+            return true;
+        }
+
+        void updateFrameRate(const unsigned long now)
+        {
+            if (now - rateWindowStart < RATE_INTERVAL_MS) return;
+            const auto count = received.load(std::memory_order_relaxed);
+            frameRate.store((count - rateWindowReceived) * 1000 / (now - rateWindowStart), std::memory_order_relaxed);
+            rateWindowReceived = count;
+            rateWindowStart = now;
+        }
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "base/iot_knob.h"
+#include "inplace_function.hh"
 
 class RotaryEncoderManager
 {
@@ -11,9 +12,13 @@ class RotaryEncoderManager
     const gpio_num_t groundPin;
     const gpio_num_t vccPin;
 
+public:
+    using Callback = InplaceFunction<void()>;
+
+private:
     knob_handle_t knob;
-    std::function<void()> turnLeftCallback;
-    std::function<void()> turnRightCallback;
+    Callback turnLeftCallback;
+    Callback turnRightCallback;
 
     static void _knob_left_cb(void*, void* data)
     {
@@ -69,12 +74,12 @@ public:
         }
     }
 
-    void onTurnLeft(const std::function<void()>& callback)
+    void onTurnLeft(const Callback& callback)
     {
         this->turnLeftCallback = callback;
     }
 
-    void onTurnRight(const std::function<void()>& callback)
+    void onTurnRight(const Callback& callback)
     {
         this->turnRightCallback = callback;
     }
@@ -2,10 +2,12 @@
 
 #include <Arduino.h>
 #include <Preferences.h>
+#include "event_loop.hh"
 #include "moving_average.hh"
 
 class Sensor
 {
+    static constexpr unsigned long READ_INTERVAL_MS = 50;
     static constexpr auto PREFERENCES_NAME = "sensor";
     static constexpr auto PREFERENCES_KEY = "f";
     static constexpr auto LOG_TAG = "Sensor";
@@ -46,18 +48,24 @@ public:
 
         std::lock_guard lock(getSensorMutex());
         values = analogReadMilliVolts(pin);
-        ESP_LOGI(LOG_TAG, "Initialized on pin %d with initial value: %lu mV", pin, static_cast<uint32_t>(values));
+        ESP_LOGI(LOG_TAG, "Initialized on pin %d with initial value: %lu mV", pin,
+                 static_cast<unsigned long>(static_cast<uint32_t>(values)));
     }
 
     void handle(const unsigned long now)
     {
-        if (now - lastReadTime < 50) return; // no more than 20 readings per second
+        if (now - lastReadTime < READ_INTERVAL_MS) return; // no more than 20 readings per second
         lastReadTime = now;
 
         std::lock_guard lock(getSensorMutex());
         values += analogReadMilliVolts(pin);
     }
 
+    void schedule(EventLoop::Deadline& next) const
+    {
+        next.at(lastReadTime + READ_INTERVAL_MS);
+    }
+
     [[nodiscard]] uint32_t getRawMillivolts() const
     {
         std::lock_guard lock(getSensorMutex());
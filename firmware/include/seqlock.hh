@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <freertos/FreeRTOS.h> // NOLINT
+
+/**
+ * Publishes a small value from one writer task to any number of readers
+ * without a lock on either side.
+ *
+ * The writer bumps the sequence to odd, stores the value and bumps it back
+ * to even; a reader copies the value and retries while the sequence was odd
+ * or changed under it. The value is kept in 32-bit atomic words, which the
+ * ESP32 loads and stores natively, so a read that raced a write is thrown
+ * away instead of being a data race.
+ *
+ * Only for a single writer. Readers never block the writer. The writer
+ * bumps the sequence and stores the words inside a critical section, so
+ * no task can preempt it halfway: a higher priority reader on the same
+ * core would otherwise spin on the odd sequence forever, with the writer
+ * never getting the core back. A reader on the other core waits for a
+ * handful of word stores at most.
+ */
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock values are copied byte for byte");
+
+    static constexpr size_t WORD_COUNT = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> sequence = 0;
+    std::array<std::atomic<uint32_t>, WORD_COUNT> words = {};
+    portMUX_TYPE writeMux = portMUX_INITIALIZER_UNLOCKED;
+
+public:
+    SeqLock() = default;
+
+    explicit SeqLock(const T& value)
+    {
+        store(value);
+    }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    /** Writer side only */
+    void store(const T& value)
+    {
+        std::array<uint32_t, WORD_COUNT> buffer = {};
+        std::memcpy(buffer.data(), &value, sizeof(T));
+
+        portENTER_CRITICAL(&writeMux);
+        const auto position = sequence.load(std::memory_order_relaxed);
+        sequence.store(position + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORD_COUNT; ++i)
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        sequence.store(position + 2, std::memory_order_release);
+        portEXIT_CRITICAL(&writeMux);
+    }
+
+    [[nodiscard]] T load() const
+    {
+        std::array<uint32_t, WORD_COUNT> buffer;
+        uint32_t before;
+        uint32_t after;
+        do
+        {
+            before = sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORD_COUNT; ++i)
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        }
+        while (before != after || before & 1);
+
+        T value;
+        std::memcpy(static_cast<void*>(&value), buffer.data(), sizeof(T));
+        return value;
+    }
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Fixed-capacity ring for exactly one producer task and one consumer task.
+ *
+ * Each side only writes its own index, and the release store of that index
+ * publishes the slot it moved past, so neither side ever takes a lock or
+ * waits for the other. Indices run freely and wrap through the modulo;
+ * Capacity must be a power of two for that to stay continuous.
+ *
+ * Not for use from an ISR holding the same ring as a task.
+ */
+template <typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    std::array<T, Capacity> items = {};
+    /** Next slot to read; written by the consumer only */
+    std::atomic<uint32_t> head = 0;
+    /** Next slot to write; written by the producer only */
+    std::atomic<uint32_t> tail = 0;
+
+public:
+    /** Producer side; false when the ring is full */
+    bool push(const T& item)
+    {
+        const auto position = tail.load(std::memory_order_relaxed);
+        if (position - head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        items[position % Capacity] = item;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Consumer side; the oldest item, valid until pop(), or nullptr when empty */
+    [[nodiscard]] const T* front() const
+    {
+        const auto position = head.load(std::memory_order_relaxed);
+        if (position == tail.load(std::memory_order_acquire))
+            return nullptr;
+        return &items[position % Capacity];
+    }
+
+    /** Consumer side; only after front() returned an item */
+    void pop()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /** Exact on either side, a snapshot anywhere else; head goes first so it never passes tail */
+    [[nodiscard]] size_t size() const
+    {
+        const auto position = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - position;
+    }
+
+    [[nodiscard]] static constexpr size_t capacity()
+    {
+        return Capacity;
+    }
+};
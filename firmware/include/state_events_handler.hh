@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+
+#include "event_loop.hh"
+#include "state_rest_handler.hh"
+
+/**
+ * Server-Sent Events at /events for integrations that can't speak the
+ * binary WebSocket protocol.
+ *
+ * Each `state` event carries one StateJsonFiller section as a JSON object,
+ * with the change bus version as its id. A new client first gets every
+ * section, or only those changed since its Last-Event-ID when it resumes.
+ * After that, only sections whose topics were published go out, at most
+ * once per EVENT_INTERVAL_MS, so a burst of changes costs one event per
+ * section.
+ */
+class StateEventsHandler final : public HTTP::AsyncWebHandlerCreator
+{
+    static constexpr auto LOG_TAG = "StateEventsHandler";
+    static constexpr auto EVENT_INTERVAL_MS = 50;
+    /** Changes wait while clients have more events than this still queued */
+    static constexpr size_t MAX_PACKETS_WAITING = 4;
+    static constexpr size_t EVENT_CAPACITY = StateJsonStream::SECTION_CAPACITY + 3;
+
+    const StateRestHandler& stateRestHandler;
+    AsyncEventSource events = AsyncEventSource(HTTP::Endpoints::EVENTS);
+    uint32_t sentVersion = 0;
+    unsigned long lastSent = 0;
+
+    /** Shared by the loop and the connect callback on the network task */
+    std::array<char, EVENT_CAPACITY> event = {};
+    std::mutex eventMutex;
+
+public:
+    explicit StateEventsHandler(const StateRestHandler& stateRestHandler)
+        : stateRestHandler(stateRestHandler)
+    {
+        events.onConnect([this](AsyncEventSourceClient* client)
+        {
+            const auto version = ChangeBus::versionOf(ChangeBus::ALL_TOPICS);
+            // An id from before a reboot may be ahead of us
+            const auto since = client->lastId() <= version ? client->lastId() : 0;
+            ESP_LOGD(LOG_TAG, "Event client connected, resuming from %lu", static_cast<unsigned long>(since));
+            sendSections(client, since, version);
+        });
+    }
+
+    /**
+     * Backed-up clients are not sent anything; the changes stay behind the
+     * version gap and go out as current sections once they catch up.
+     */
+    void handle(const unsigned long now)
+    {
+        const auto version = ChangeBus::versionOf(ChangeBus::ALL_TOPICS);
+        if (version == sentVersion) return;
+        if (!events.count())
+        {
+            sentVersion = version;
+            return;
+        }
+        if (now - lastSent < EVENT_INTERVAL_MS || events.avgPacketsWaiting() > MAX_PACKETS_WAITING)
+            return;
+        sendSections(nullptr, sentVersion, version);
+        sentVersion = version;
+        lastSent = now;
+    }
+
+    void schedule(EventLoop::Deadline& next)
+    {
+        if (!events.count() || ChangeBus::versionOf(ChangeBus::ALL_TOPICS) == sentVersion) return;
+        if (events.avgPacketsWaiting() > MAX_PACKETS_WAITING)
+            next.in(EVENT_INTERVAL_MS);
+        else
+            next.at(lastSent + EVENT_INTERVAL_MS);
+    }
+
+    AsyncWebHandler* createAsyncWebHandler() override
+    {
+        return &events;
+    }
+
+private:
+    /** Sends every section changed after `since` to one client, or to all of them */
+    void sendSections(AsyncEventSourceClient* client, const uint32_t since, const uint32_t version)
+    {
+        std::lock_guard lock(eventMutex);
+        for (auto* const& filler : stateRestHandler.getFillers())
+        {
+            StateJsonStream stream(&filler, 1, {}, since);
+            const auto length = stream.read(reinterpret_cast<uint8_t*>(event.data()), event.size() - 1);
+            if (length <= 2) continue; // "{}": unchanged or skipped
+            event[length] = '\0';
+            if (client != nullptr)
+                client->send(event.data(), "state", version);
+            else
+                events.send(event.data(), "state", version);
+        }
+    }
+};
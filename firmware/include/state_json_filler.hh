@@ -2,10 +2,20 @@
 
 #include <ArduinoJson.h>
 
+#include "change_bus.hh"
 
 class StateJsonFiller
 {
 public:
     virtual ~StateJsonFiller() = default;
     virtual void fillState(const JsonObject& root) const =0;
+
+    /** Comma-separated top-level keys written by fillState, matched against ?fields= */
+    [[nodiscard]] virtual const char* getStateFields() const =0;
+
+    /**
+     * Change bus topics behind the fields. Counters that move on their own
+     * (free heap, statistics) are left out, so they do not bump the version.
+     */
+    [[nodiscard]] virtual ChangeBus::Mask getStateTopics() const =0;
 };
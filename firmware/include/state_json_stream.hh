@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include <ArduinoJson.h>
+#include <esp32-hal.h>
+
+#include "state_json_filler.hh"
+
+/**
+ * Fixed-size bump allocator for the ArduinoJson document of one section.
+ * Nothing is freed individually; reset() drops everything at once.
+ */
+class JsonScratchArena final : public ArduinoJson::Allocator
+{
+public:
+    static constexpr size_t CAPACITY = 4096;
+
+private:
+    alignas(8) std::array<uint8_t, CAPACITY> buffer = {};
+    size_t used = 0;
+
+    struct Header
+    {
+        size_t size;
+    };
+
+public:
+    void* allocate(const size_t size) override
+    {
+        const auto total = sizeof(Header) + ((size + 7) & ~size_t{7});
+        if (used + total > CAPACITY) return nullptr;
+        auto* header = reinterpret_cast<Header*>(buffer.data() + used);
+        header->size = size;
+        used += total;
+        return header + 1;
+    }
+
+    void deallocate(void*) override
+    {
+    }
+
+    void* reallocate(void* ptr, const size_t newSize) override
+    {
+        if (ptr == nullptr) return allocate(newSize);
+        const auto* header = static_cast<Header*>(ptr) - 1;
+        if (newSize <= header->size) return ptr;
+        void* copy = allocate(newSize);
+        if (copy != nullptr) std::memcpy(copy, ptr, header->size);
+        return copy;
+    }
+
+    void reset()
+    {
+        used = 0;
+    }
+};
+
+/**
+ * Top-level keys selected with `?fields=a,b`; an empty selection keeps all.
+ */
+class StateFields
+{
+public:
+    static constexpr size_t CAPACITY = 128;
+
+private:
+    std::array<char, CAPACITY> list = {};
+    size_t length = 0;
+
+public:
+    StateFields() = default;
+
+    explicit StateFields(const char* fields)
+    {
+        length = std::min(std::strlen(fields), CAPACITY);
+        std::memcpy(list.data(), fields, length);
+    }
+
+    [[nodiscard]] bool all() const
+    {
+        return length == 0;
+    }
+
+    [[nodiscard]] bool selects(const std::string_view key) const
+    {
+        return all() || contains({list.data(), length}, key);
+    }
+
+    /** Whether any key of a comma-separated list is selected */
+    [[nodiscard]] bool selectsAny(const std::string_view keys) const
+    {
+        if (all()) return true;
+        bool found = false;
+        forEach(keys, [&](const std::string_view key) { found |= selects(key); });
+        return found;
+    }
+
+private:
+    static bool contains(const std::string_view keys, const std::string_view key)
+    {
+        bool found = false;
+        forEach(keys, [&](const std::string_view item) { found |= item == key; });
+        return found;
+    }
+
+    template <typename Callback>
+    static void forEach(std::string_view keys, Callback&& callback)
+    {
+        while (!keys.empty())
+        {
+            const auto end = std::min(keys.find(','), keys.size());
+            callback(keys.substr(0, end));
+            keys.remove_prefix(std::min(end + 1, keys.size()));
+        }
+    }
+};
+
+/**
+ * Serializes the state of all fillers as one JSON object, a section at a
+ * time, straight into the buffers handed out by a chunked response. With a
+ * non-zero `since` only fillers whose topics changed after that change bus
+ * version are included.
+ *
+ * Each filler is rendered into a document backed by a shared static arena
+ * and copied into a fixed per-response text buffer, so a request costs one
+ * fixed-size allocation no matter how large the state grows.
+ */
+class StateJsonStream
+{
+    static constexpr auto LOG_TAG = "StateJsonStream";
+
+public:
+    static constexpr size_t SECTION_CAPACITY = 1024;
+
+private:
+    StateJsonFiller* const* fillers;
+    const size_t fillerCount;
+    const StateFields fields;
+    const uint32_t since;
+    size_t nextFiller = 0;
+    std::array<char, SECTION_CAPACITY> section = {};
+    size_t sectionLength = 0;
+    size_t sectionOffset = 0;
+    bool empty = true;
+    bool closed = false;
+
+public:
+    explicit StateJsonStream(const std::vector<StateJsonFiller*>& fillers, const StateFields& fields = {},
+                             const uint32_t since = 0)
+        : StateJsonStream(fillers.data(), fillers.size(), fields, since)
+    {
+    }
+
+    StateJsonStream(StateJsonFiller* const* fillers, const size_t fillerCount, const StateFields& fields = {},
+                    const uint32_t since = 0)
+        : fillers(fillers), fillerCount(fillerCount), fields(fields), since(since)
+    {
+        section[0] = '{';
+        sectionLength = 1;
+    }
+
+    /**
+     * Fills up to maxLen bytes and returns how many were written; 0 once the
+     * closing brace has been sent.
+     */
+    size_t read(uint8_t* buffer, const size_t maxLen)
+    {
+        size_t written = 0;
+        while (written < maxLen)
+        {
+            if (sectionOffset == sectionLength && !nextSection())
+                break;
+            const auto len = std::min(sectionLength - sectionOffset, maxLen - written);
+            std::memcpy(buffer + written, section.data() + sectionOffset, len);
+            sectionOffset += len;
+            written += len;
+        }
+        return written;
+    }
+
+private:
+    bool nextSection()
+    {
+        sectionOffset = 0;
+        sectionLength = 0;
+        while (nextFiller < fillerCount && sectionLength == 0)
+            if (const auto* filler = fillers[nextFiller++]; selects(*filler))
+                serializeFiller(*filler);
+        if (sectionLength != 0)
+            return true;
+        if (closed)
+            return false;
+        closed = true;
+        section[0] = '}';
+        sectionLength = 1;
+        return true;
+    }
+
+    [[nodiscard]] bool selects(const StateJsonFiller& filler) const
+    {
+        if (since != 0 && ChangeBus::versionOf(filler.getStateTopics()) <= since)
+            return false;
+        return fields.selectsAny(filler.getStateFields());
+    }
+
+    /**
+     * Stores the selected members written by the filler, each preceded by a
+     * comma when needed. Sections that overflow are skipped so the response
+     * stays valid JSON.
+     */
+    void serializeFiller(const StateJsonFiller& filler)
+    {
+        std::lock_guard lock(getArenaMutex());
+        auto& arena = getArena();
+        arena.reset();
+        JsonDocument doc(&arena);
+        filler.fillState(doc.to<JsonObject>());
+        if (doc.overflowed())
+            return skipSection();
+
+        size_t length = 0;
+        bool first = empty;
+        for (const auto member : doc.as<JsonObject>())
+        {
+            const std::string_view key = member.key().c_str();
+            if (!fields.selects(key)) continue;
+            if (length + (first ? 0 : 1) + key.size() + 3 >= section.size())
+                return skipSection();
+            if (!first) section[length++] = ',';
+            section[length++] = '"';
+            std::memcpy(section.data() + length, key.data(), key.size());
+            length += key.size();
+            section[length++] = '"';
+            section[length++] = ':';
+            const auto valueLength = serializeJson(member.value(), section.data() + length, section.size() - length);
+            if (length + valueLength + 1 >= section.size())
+                return skipSection();
+            length += valueLength;
+            first = false;
+        }
+        sectionLength = length;
+        empty = first;
+    }
+
+    static void skipSection()
+    {
+        ESP_LOGE(LOG_TAG, "State section too large, skipped");
+    }
+
+    static JsonScratchArena& getArena()
+    {
+        static JsonScratchArena arena;
+        return arena;
+    }
+
+    static std::mutex& getArenaMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+};
@@ -1,13 +1,41 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <ArduinoJson.h>
-#include <AsyncJson.h>
+#include <esp_system.h>
 
+#include "event_loop.hh"
+#include "state_json_stream.hh"
 #include "wifi_manager.hh"
 
 class StateRestHandler final : public HTTP::AsyncWebHandlerCreator
 {
+    static constexpr auto LOG_TAG = "StateRestHandler";
+    static constexpr uint8_t MAX_WAITING_REQUESTS = 4;
+    static constexpr unsigned long WAIT_TIMEOUT_MS = 25000;
+
+    /** A `/state?wait=` long-poll parked until its sections change */
+    struct WaitingRequest
+    {
+        AsyncWebServerRequestPtr request;
+        StateFields fields;
+        uint32_t since = 0;
+        unsigned long startedAt = 0;
+    };
+
     std::vector<StateJsonFiller*> jsonStateFillers;
+    const uint32_t bootId = esp_random();
+
+    std::array<std::optional<WaitingRequest>, MAX_WAITING_REQUESTS> waiting;
+    std::atomic<uint8_t> waitingCount = 0;
+    std::mutex waitingMutex;
 
 public:
     explicit StateRestHandler(const std::vector<StateJsonFiller*>&& jsonStateFillers)
@@ -20,7 +48,117 @@ public:
         return new AsyncRestWebHandler(this);
     }
 
+    /**
+     * Answers the long-polls whose sections changed or that timed out.
+     * Requests the client gave up on in the meantime just free their slot.
+     */
+    void handle(const unsigned long now)
+    {
+        if (waitingCount.load(std::memory_order_relaxed) == 0) return;
+        std::lock_guard lock(waitingMutex);
+        for (auto& slot : waiting)
+        {
+            if (!slot) continue;
+            const auto request = slot->request.lock();
+            if (request && getVersion(slot->fields) <= slot->since && now - slot->startedAt < WAIT_TIMEOUT_MS)
+                continue;
+            if (request)
+                sendState(request.get(), slot->fields, slot->since);
+            slot.reset();
+            waitingCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    /** Changes wake the loop through the change bus; only timeouts need a deadline */
+    void schedule(EventLoop::Deadline& next)
+    {
+        if (waitingCount.load(std::memory_order_relaxed) == 0) return;
+        std::lock_guard lock(waitingMutex);
+        for (const auto& slot : waiting)
+            if (slot) next.at(slot->startedAt + WAIT_TIMEOUT_MS);
+    }
+
+    [[nodiscard]] const std::vector<StateJsonFiller*>& getFillers() const
+    {
+        return jsonStateFillers;
+    }
+
+    [[nodiscard]] ChangeBus::Mask getTopics(const StateFields& fields) const
+    {
+        ChangeBus::Mask topics = 0;
+        for (const auto* filler : jsonStateFillers)
+            if (fields.selectsAny(filler->getStateFields()))
+                topics |= filler->getStateTopics();
+        return topics;
+    }
+
+    [[nodiscard]] uint32_t getVersion(const StateFields& fields) const
+    {
+        return ChangeBus::versionOf(getTopics(fields));
+    }
+
 private:
+    /**
+     * Weak validator for the selected sections: changes on reboot and
+     * whenever one of their topics is published. Values that drift without
+     * a publish, like the free heap or the WebSocket counters, do not
+     * invalidate it. Returns false when the selection has no topics at all,
+     * as nothing could ever invalidate it.
+     */
+    bool formatETag(const StateFields& fields, char* etag, const size_t size) const
+    {
+        if (getTopics(fields) == 0)
+            return false;
+        snprintf(etag, size, "W/\"%08lx-%lu\"", static_cast<unsigned long>(bootId),
+                 static_cast<unsigned long>(getVersion(fields)));
+        return true;
+    }
+
+    /**
+     * Streams the selected sections changed after `since`, or an empty 304
+     * when none did. Every response carries the version to wait on next.
+     */
+    void sendState(AsyncWebServerRequest* request, const StateFields& fields, const uint32_t since) const
+    {
+        char etag[24];
+        const bool hasETag = formatETag(fields, etag, sizeof(etag));
+        char version[11];
+        snprintf(version, sizeof(version), "%lu", static_cast<unsigned long>(getVersion(fields)));
+
+        AsyncWebServerResponse* response;
+        if (hasETag && since != 0 && getVersion(fields) <= since)
+        {
+            response = request->beginResponse(304);
+        }
+        else
+        {
+            const auto stream = std::make_shared<StateJsonStream>(jsonStateFillers, fields, since);
+            response = request->beginChunkedResponse(
+                "application/json",
+                [stream](uint8_t* buffer, const size_t maxLen, size_t)
+                {
+                    return stream->read(buffer, maxLen);
+                });
+        }
+        if (hasETag)
+            response->addHeader("ETag", etag);
+        response->addHeader("X-State-Version", version);
+        response->addHeader("Cache-Control", "no-cache");
+        request->send(response);
+    }
+
+    bool park(AsyncWebServerRequest* request, const StateFields& fields, const uint32_t since)
+    {
+        std::lock_guard lock(waitingMutex);
+        const auto slot = std::find_if(waiting.begin(), waiting.end(),
+                                       [](const auto& s) { return !s.has_value(); });
+        if (slot == waiting.end())
+            return false;
+        slot->emplace(WaitingRequest{request->pause(), fields, since, millis()});
+        waitingCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
     class AsyncRestWebHandler final : public AsyncWebHandler
     {
         StateRestHandler* restHandler;
@@ -36,17 +174,47 @@ private:
             return request->method() == HTTP_GET && request->url() == HTTP::Endpoints::STATE;
         }
 
+        /**
+         * The state is streamed filler by filler as the TCP stack asks for
+         * more data, instead of building the whole document up front.
+         * `?fields=a,b` keeps only those top-level keys, and a matching
+         * If-None-Match is answered with an empty 304. `?wait=<version>`
+         * holds the request until a selected section changes past that
+         * version and then returns only the changed sections.
+         */
         void handleRequest(AsyncWebServerRequest* request) override
         {
-            const auto response = new AsyncJsonResponse();
-            const auto doc = response->getRoot().to<JsonObject>();
-            for (const auto& filler : restHandler->jsonStateFillers)
+            const auto fields = request->hasParam("fields")
+                                    ? StateFields(request->getParam("fields")->value().c_str())
+                                    : StateFields();
+
+            if (request->hasParam("wait"))
             {
-                filler->fillState(doc);
+                const auto since = static_cast<uint32_t>(
+                    std::strtoul(request->getParam("wait")->value().c_str(), nullptr, 10));
+                if (restHandler->getTopics(fields) == 0 || restHandler->getVersion(fields) > since)
+                    restHandler->sendState(request, fields, since);
+                else if (!restHandler->park(request, fields, since))
+                {
+                    ESP_LOGW(LOG_TAG, "Too many waiting requests");
+                    request->send(503, "text/plain", "Too many waiting requests");
+                }
+                return;
             }
-            response->addHeader("Cache-Control", "no-store");
-            response->setLength();
-            request->send(response);
+
+            char etag[24];
+            if (restHandler->formatETag(fields, etag, sizeof(etag))
+                && request->hasHeader("If-None-Match")
+                && std::strstr(request->header("If-None-Match").c_str(), etag) != nullptr)
+            {
+                const auto response = request->beginResponse(304);
+                response->addHeader("ETag", etag);
+                response->addHeader("Cache-Control", "no-cache");
+                request->send(response);
+                return;
+            }
+
+            restHandler->sendState(request, fields, 0);
         }
     };
 };
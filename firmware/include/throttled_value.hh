@@ -31,6 +31,28 @@ public:
         return true;
     }
 
+    /**
+     * Whether the value differs from the last one sent, i.e. a skipped send
+     * still has to be retried later.
+     */
+    bool hasChanged(const T& newValue)
+    {
+        std::lock_guard lock(mutex);
+        return newValue != lastValue;
+    }
+
+    /** Start of the interval shouldSend() currently holds changes back for */
+    unsigned long getLastSendTime()
+    {
+        std::lock_guard lock(mutex);
+        return lastSendTime;
+    }
+
+    [[nodiscard]] unsigned long getInterval() const
+    {
+        return throttleInterval;
+    }
+
     void setLastSent(const unsigned long time, const T& value)
     {
         std::lock_guard lock(mutex);
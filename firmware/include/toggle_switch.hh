@@ -1,11 +1,15 @@
 #pragma once
 
 #include <Arduino.h>
-#include <functional>
 #include "hardware.hh"
+#include "inplace_function.hh"
 
 class ToggleSwitch
 {
+public:
+    using Callback = InplaceFunction<void(bool)>;
+
+private:
     static constexpr uint16_t DEBOUNCE = 50;
     static constexpr uint16_t TASK_DELAY_MS = 10;
 
@@ -15,7 +19,7 @@ class ToggleSwitch
     unsigned long lastChangeTime = 0;
 
     TaskHandle_t taskHandle = nullptr;
-    std::function<void(bool)> callback;
+    Callback callback;
 
     [[noreturn]] static void taskLoop(void* arg)
     {
@@ -64,7 +68,7 @@ public:
         }
     }
 
-    void onChanged(const std::function<void(bool)>& cb)
+    void onChanged(const Callback& cb)
     {
         this->callback = cb;
     }
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+
+#include "change_bus.hh"
+
+namespace WebSocket
+{
+    /**
+     * Outbound bookkeeping for one connected client.
+     *
+     * A client only gets a new frame while fewer than MAX_QUEUED_FRAMES of
+     * ours are still waiting in its queue. Otherwise the topics it missed
+     * pile up in a pending mask and are rebuilt from the current state once
+     * it drains, so a newer value always replaces an unsent older one and a
+     * slow client never holds more than a couple of frames in heap.
+     */
+    class ClientSlot
+    {
+    public:
+        static constexpr uint8_t MAX_QUEUED_FRAMES = 2;
+
+        struct Stats
+        {
+            uint32_t id = 0;
+            uint32_t queuedFrames = 0;
+            uint32_t queuedBytes = 0;
+            uint32_t sentFrames = 0;
+            uint32_t sentBytes = 0;
+            uint32_t dropped = 0;
+        };
+
+    private:
+        AsyncWebSocketClient* client = nullptr;
+        ChangeBus::Mask pending = 0;
+        std::array<uint16_t, MAX_QUEUED_FRAMES> frameSizes = {};
+        uint8_t nextFrame = 0;
+        uint32_t sentFrames = 0;
+        uint32_t sentBytes = 0;
+        uint32_t dropped = 0;
+        uint16_t lastColorSequence = 0;
+        bool hasColorSequence = false;
+
+    public:
+        void assign(AsyncWebSocketClient* newClient)
+        {
+            *this = ClientSlot();
+            client = newClient;
+        }
+
+        void release()
+        {
+            client = nullptr;
+        }
+
+        [[nodiscard]] bool isFree() const { return client == nullptr; }
+        [[nodiscard]] bool holds(const AsyncWebSocketClient* other) const { return client == other; }
+        [[nodiscard]] bool hasPending() const { return pending != 0; }
+
+        [[nodiscard]] bool isReady() const
+        {
+            return client->canSend() && client->queueLen() < MAX_QUEUED_FRAMES;
+        }
+
+        /** Topics that were broadcast while this client was backed up */
+        void defer(const ChangeBus::Mask topics)
+        {
+            dropped += __builtin_popcount(pending & topics);
+            pending |= topics;
+        }
+
+        ChangeBus::Mask takePending()
+        {
+            return std::exchange(pending, 0);
+        }
+
+        bool send(const uint8_t* data, const size_t len)
+        {
+            if (!client->binary(data, len))
+                return false;
+            frameSizes[nextFrame] = static_cast<uint16_t>(len);
+            nextFrame = (nextFrame + 1) % MAX_QUEUED_FRAMES;
+            ++sentFrames;
+            sentBytes += len;
+            return true;
+        }
+
+        /**
+         * Color deltas are streamed without acknowledgement, so a frame older
+         * than the last one applied is stale. Sequence numbers wrap around.
+         */
+        bool acceptColorSequence(const uint16_t sequence)
+        {
+            if (hasColorSequence && static_cast<int16_t>(sequence - lastColorSequence) <= 0)
+                return false;
+            hasColorSequence = true;
+            lastColorSequence = sequence;
+            return true;
+        }
+
+        /** Queued bytes are estimated from the sizes of the last frames we sent */
+        [[nodiscard]] Stats getStats() const
+        {
+            Stats stats{client->id(), static_cast<uint32_t>(client->queueLen()), 0, sentFrames, sentBytes, dropped};
+            for (uint8_t i = 1; i <= std::min<uint32_t>(stats.queuedFrames, MAX_QUEUED_FRAMES); ++i)
+                stats.queuedBytes += frameSizes[(nextFrame + MAX_QUEUED_FRAMES - i) % MAX_QUEUED_FRAMES];
+            return stats;
+        }
+
+        void toJson(const JsonObject& to) const
+        {
+            const auto stats = getStats();
+            to["id"] = stats.id;
+            to["queuedFrames"] = stats.queuedFrames;
+            to["queuedBytes"] = stats.queuedBytes;
+            to["sentFrames"] = stats.sentFrames;
+            to["sentBytes"] = stats.sentBytes;
+            to["dropped"] = stats.dropped;
+        }
+    };
+}
@@ -1,17 +1,27 @@
 #pragma once
 
 #include <array>
+#include <mutex>
+#include "websocket_client.hh"
 #include "websocket_message.hh"
 #include "esp_now_handler_remote.hh"
 #include "ble_manager.hh"
+#include "change_bus.hh"
+#include "event_loop.hh"
 #include "throttled_value.hh"
 
 namespace WebSocket
 {
-    class Handler final : public HTTP::AsyncWebHandlerCreator
+    class Handler final : public HTTP::AsyncWebHandlerCreator, public StateJsonFiller
     {
         static constexpr auto LOG_TAG = "WebSocketHandler";
         static constexpr auto HEAP_MESSAGE_INTERVAL_MS = 750;
+        static constexpr unsigned long LOOP_PROFILE_INTERVAL_MS = 1000;
+        /** Pace of retries for throttled topics and clients whose queue is backed up */
+        static constexpr unsigned long RETRY_INTERVAL_MS = 25;
+        static constexpr uint8_t MAX_CLIENTS = 8;
+        /** Extra pending bit next to the change bus topics for the free-heap message */
+        static constexpr ChangeBus::Mask HEAP_INFO = ChangeBus::maskOf(ChangeBus::Topic::COUNT);
 
         Output::Manager* outputManager;
         OTA::Handler* otaHandler;
@@ -31,12 +41,34 @@ namespace WebSocket
         ThrottledValue<OTA::State> otaStateThrottle{200};
         ThrottledValue<EspNow::DeviceData> espNowDevicesThrottle{200};
         ThrottledValue<std::array<uint8_t, 6>> espNowControllerThrottle{200};
-        ThrottledValue<std::array<char, 10>> firmwareVersionThrottle{200};
         ThrottledValue<WiFiDetails> wifiDetailsThrottle{200};
         ThrottledValue<WiFiStatus> wifiStatusThrottle{200};
         ThrottledValue<AlexaIntegration::Settings> alexaSettingsThrottle{200};
 
+        ChangeBus::Subscription changes;
+
+        static_assert(Batch::sizeFor<HeapMessage, FirmwareVersionMessage, ColorMessage, BleStatusMessage,
+                                     DeviceNameMessage, OtaProgressMessage, EspNowDevicesMessage,
+                                     EspNowControllerMessage, WiFiDetailsMessage, WiFiStatusMessage,
+                                     AlexaIntegrationSettingsMessage>() +
+                      (EspNow::DevicePage::MAX_PAGES - 1) * (sizeof(Batch::Length) + sizeof(EspNowDevicesMessage))
+                      <= Batch::CAPACITY,
+                      "Batch too small for a full state snapshot");
+
+        /** Frame built by handle() for every client that is keeping up */
+        Batch batch;
+        ChangeBus::Mask batchTopics = 0;
+        /** Rebuilt per client from the current state; guarded by clientsMutex */
+        Batch snapshot;
+        bool bypassThrottle = false;
+
+        std::array<ClientSlot, MAX_CLIENTS> clients;
+        bool clientsBehind = false;
+        /** Recursive because a failing send may close the client and fire the disconnect event inline */
+        mutable std::recursive_mutex clientsMutex;
+
         unsigned long lastSentHeapInfo = 0;
+        unsigned long lastSentLoopProfile = 0;
 
     public:
         Handler(
@@ -69,13 +101,33 @@ namespace WebSocket
             });
         }
 
+        /**
+         * Only topics published on the change bus since the last call are
+         * looked at; with nothing dirty this costs a couple of atomic loads.
+         * Changes stay pending while no client is connected, so the first
+         * broadcast after a connect also brings the throttles up to date.
+         * Everything that changed during a tick goes out as a single frame.
+         */
         void handle(const unsigned long now)
         {
-            ws.cleanupClients();
-            if (ws.count())
-            {
-                sendAllMessages(now);
-            }
+            ws.cleanupClients(MAX_CLIENTS);
+            if (!ws.count()) return;
+            sendHeapInfoMessage(now);
+            sendLoopProfileMessage(now);
+            if (changes.pending())
+                sendChangedMessages(now, changes.take());
+            flushClients(now);
+        }
+
+        void schedule(EventLoop::Deadline& next) const
+        {
+            if (!ws.count()) return;
+            next.at(lastSentHeapInfo + HEAP_MESSAGE_INTERVAL_MS);
+#if LOOP_PROFILER
+            next.at(lastSentLoopProfile + LOOP_PROFILE_INTERVAL_MS);
+#endif
+            if (changes.pending() || clientsBehind)
+                next.in(RETRY_INTERVAL_MS);
         }
 
         AsyncWebHandler* createAsyncWebHandler() override
@@ -83,72 +135,205 @@ namespace WebSocket
             return &ws;
         }
 
+        void fillState(const JsonObject& root) const override
+        {
+            const auto webSocket = root["webSocket"].to<JsonObject>();
+            const auto arr = webSocket["clients"].to<JsonArray>();
+            std::lock_guard lock(clientsMutex);
+            for (const auto& slot : clients)
+                if (!slot.isFree()) slot.toJson(arr.add<JsonObject>());
+        }
+
+        [[nodiscard]] const char* getStateFields() const override
+        {
+            return "webSocket";
+        }
+
+        [[nodiscard]] ChangeBus::Mask getStateTopics() const override
+        {
+            return 0;
+        }
+
     private:
         // --------------------  Message Sending --------------------
 
+        /**
+         * Adds the message to the broadcast batch, or unthrottled to the given
+         * snapshot. Returns false when the topic has to be retried later: the
+         * value changed but was throttled, or the batch is full.
+         */
         template <typename TState, typename TMessage, typename TThrottle>
-        void sendThrottledMessage(const TState& state, TThrottle& throttle, const unsigned long now,
-                                  AsyncWebSocketClient* client = nullptr)
+        bool sendThrottledMessage(const TState& state, TThrottle& throttle, const unsigned long now,
+                                  Batch* target = nullptr)
         {
-            if (!throttle.shouldSend(now, state) && !client)
-                return;
+            if (target)
+                return target->append(TMessage(state));
+            if (const bool due = bypassThrottle ? throttle.hasChanged(state) : throttle.shouldSend(now, state); !due)
+                return !throttle.hasChanged(state);
+            if (!batch.append(TMessage(state)))
+                return false;
+            throttle.setLastSent(now, state);
+            return true;
+        }
 
-            const TMessage message(state);
-            const auto data = reinterpret_cast<const uint8_t*>(&message);
-            constexpr size_t len = sizeof(TMessage);
+        /**
+         * Clients keeping up get this tick's batch as is. Backed-up clients
+         * only remember which topics they missed; once their queue drains
+         * they get one frame rebuilt from the current state instead.
+         */
+        void flushClients(const unsigned long now)
+        {
+            if (batch.empty() && !clientsBehind) return;
+            std::lock_guard lock(clientsMutex);
+            clientsBehind = false;
+            for (auto& slot : clients)
+            {
+                if (slot.isFree()) continue;
+                if (!slot.isReady())
+                {
+                    slot.defer(batchTopics);
+                    continue;
+                }
+                if (!slot.hasPending())
+                {
+                    if (!batch.empty() && !slot.send(batch.data(), batch.length()))
+                        slot.defer(batchTopics);
+                    continue;
+                }
+                const auto topics = slot.takePending() | batchTopics;
+                buildSnapshot(now, topics);
+                if (!slot.send(snapshot.data(), snapshot.length()))
+                    slot.defer(topics);
+            }
+            for (const auto& slot : clients)
+                clientsBehind |= !slot.isFree() && slot.hasPending();
+            batch.clear();
+            batchTopics = 0;
+        }
 
-            if (client)
+        void buildSnapshot(const unsigned long now, const ChangeBus::Mask topics)
+        {
+            snapshot.clear();
+            if (topics & HEAP_INFO)
+                snapshot.append(HeapMessage(esp_get_free_heap_size()));
+            for (uint8_t i = 0; i < static_cast<uint8_t>(ChangeBus::Topic::COUNT); ++i)
             {
-                client->binary(data, len);
+                const auto topic = static_cast<ChangeBus::Topic>(i);
+                if (topics & ChangeBus::maskOf(topic))
+                    sendTopicMessage(topic, now, &snapshot);
             }
-            else if (AsyncWebSocket::SendStatus::ENQUEUED == ws.binaryAll(data, len))
+        }
+
+        void sendChangedMessages(const unsigned long now, const ChangeBus::Mask dirty)
+        {
+            auto retry = sendTopicMessages(now, dirty);
+            // A frame goes out this tick anyway, so throttled topics ride along
+            // instead of costing a frame of their own a few ticks later.
+            if (retry && !batch.empty())
             {
-                throttle.setLastSent(now, state);
+                bypassThrottle = true;
+                retry = sendTopicMessages(now, retry);
+                bypassThrottle = false;
             }
+            if (retry)
+                changes.mark(retry);
         }
 
-        void sendAllMessages(const unsigned long now, AsyncWebSocketClient* client = nullptr)
+        ChangeBus::Mask sendTopicMessages(const unsigned long now, const ChangeBus::Mask topics)
         {
-            sendHeapInfoMessage(now);
-            sendOutputColorMessage(now, client);
-            sendBleStatusMessage(now, client);
-            sendDeviceNameMessage(now, client);
-            sendOtaProgressMessage(now, client);
-            sendEspNowDevicesMessage(now, client);
-            sendEspNowControllerMessage(now, client);
-            sendFirmwareVersionMessage(now, client);
-            sendWiFiDetailsMessage(now, client);
-            sendWiFiStatusMessage(now, client);
-            sendAlexaIntegrationSettingsMessage(now, client);
+            ChangeBus::Mask retry = 0;
+            for (uint8_t i = 0; i < static_cast<uint8_t>(ChangeBus::Topic::COUNT); ++i)
+            {
+                const auto topic = static_cast<ChangeBus::Topic>(i);
+                if (!(topics & ChangeBus::maskOf(topic))) continue;
+                const auto queued = batch.messageCount();
+                if (!sendTopicMessage(topic, now))
+                    retry |= ChangeBus::maskOf(topic);
+                if (batch.messageCount() != queued)
+                    batchTopics |= ChangeBus::maskOf(topic);
+            }
+            return retry;
         }
 
-        void sendOutputColorMessage(const unsigned long now, AsyncWebSocketClient* client = nullptr)
+        void connectClient(const unsigned long now, AsyncWebSocketClient* client)
         {
-            if (outputManager == nullptr) return;
-            sendThrottledMessage<Output::State, ColorMessage>(
-                outputManager->getState(), outputThrottle, now, client);
+            std::lock_guard lock(clientsMutex);
+            const auto slot = std::find_if(clients.begin(), clients.end(),
+                                           [](const ClientSlot& s) { return s.isFree(); });
+            if (slot == clients.end())
+            {
+                ESP_LOGW(LOG_TAG, "Too many WebSocket clients, closing %u", client->id());
+                client->close();
+                return;
+            }
+            slot->assign(client);
+            buildSnapshot(now, ChangeBus::ALL_TOPICS | HEAP_INFO);
+            sendFirmwareVersionMessage();
+            slot->send(snapshot.data(), snapshot.length());
         }
 
-        void sendBleStatusMessage(const unsigned long now, AsyncWebSocketClient* client = nullptr)
+        void disconnectClient(const AsyncWebSocketClient* client)
         {
-            if (bleManager == nullptr) return;
-            sendThrottledMessage<BLE::Status, BleStatusMessage>(
-                bleManager->getStatus(), bleStatusThrottle, now, client);
+            std::lock_guard lock(clientsMutex);
+            for (auto& slot : clients)
+                if (slot.holds(client)) slot.release();
         }
 
-        void sendDeviceNameMessage(const unsigned long now, AsyncWebSocketClient* client = nullptr)
+        bool sendTopicMessage(const ChangeBus::Topic topic, const unsigned long now,
+                              Batch* target = nullptr)
         {
-            if (deviceManager == nullptr) return;
+            switch (topic)
+            {
+            case ChangeBus::Topic::Output:
+                return sendOutputColorMessage(now, target);
+            case ChangeBus::Topic::BleStatus:
+                return sendBleStatusMessage(now, target);
+            case ChangeBus::Topic::DeviceName:
+                return sendDeviceNameMessage(now, target);
+            case ChangeBus::Topic::OtaState:
+                return sendOtaProgressMessage(now, target);
+            case ChangeBus::Topic::EspNowDevices:
+                return sendEspNowDevicesMessage(now, target);
+            case ChangeBus::Topic::EspNowController:
+                return sendEspNowControllerMessage(now, target);
+            case ChangeBus::Topic::WiFiDetails:
+                return sendWiFiDetailsMessage(now, target);
+            case ChangeBus::Topic::WiFiStatus:
+                return sendWiFiStatusMessage(now, target);
+            case ChangeBus::Topic::AlexaSettings:
+                return sendAlexaIntegrationSettingsMessage(now, target);
+            default:
+                return true;
+            }
+        }
+
+        bool sendOutputColorMessage(const unsigned long now, Batch* target = nullptr)
+        {
+            if (outputManager == nullptr) return true;
+            return sendThrottledMessage<Output::State, ColorMessage>(
+                outputManager->getState(), outputThrottle, now, target);
+        }
+
+        bool sendBleStatusMessage(const unsigned long now, Batch* target = nullptr)
+        {
+            if (bleManager == nullptr) return true;
+            return sendThrottledMessage<BLE::Status, BleStatusMessage>(
+                bleManager->getStatus(), bleStatusThrottle, now, target);
+        }
+
+        bool sendDeviceNameMessage(const unsigned long now, Batch* target = nullptr)
+        {
+            if (deviceManager == nullptr) return true;
             const auto deviceName = deviceManager->getDeviceNameArray();
-            sendThrottledMessage<std::array<char, DeviceManager::DEVICE_NAME_TOTAL_LENGTH>, DeviceNameMessage>(
-                deviceName, deviceNameThrottle, now, client);
+            return sendThrottledMessage<std::array<char, DeviceManager::DEVICE_NAME_TOTAL_LENGTH>, DeviceNameMessage>(
+                deviceName, deviceNameThrottle, now, target);
         }
 
-        void sendOtaProgressMessage(const unsigned long now, AsyncWebSocketClient* client = nullptr)
+        bool sendOtaProgressMessage(const unsigned long now, Batch* target = nullptr)
         {
-            if (otaHandler == nullptr) return;
-            sendThrottledMessage<OTA::State, OtaProgressMessage>(
-                otaHandler->getState(), otaStateThrottle, now, client);
+            if (otaHandler == nullptr) return true;
+            return sendThrottledMessage<OTA::State, OtaProgressMessage>(
+                otaHandler->getState(), otaStateThrottle, now, target);
         }
 
         void sendHeapInfoMessage(const unsigned long now)
@@ -156,53 +341,90 @@ namespace WebSocket
             if (now - lastSentHeapInfo < HEAP_MESSAGE_INTERVAL_MS)
                 return;
             lastSentHeapInfo = now;
-            const auto freeHeap = esp_get_free_heap_size();
-            const HeapMessage message(freeHeap);
-            ws.binaryAll(reinterpret_cast<const uint8_t*>(&message), sizeof(HeapMessage));
+            if (batch.append(HeapMessage(esp_get_free_heap_size())))
+                batchTopics |= HEAP_INFO;
         }
 
-        void sendEspNowDevicesMessage(const unsigned long now, AsyncWebSocketClient* client = nullptr)
+        /**
+         * Periodic like the heap, so it is neither throttled nor replayed to
+         * clients that fell behind; they get the next one.
+         */
+        void sendLoopProfileMessage(const unsigned long now)
         {
-            if (controllerEspNowHandler == nullptr) return;
-            sendThrottledMessage<EspNow::DeviceData, EspNowDevicesMessage>(
-                controllerEspNowHandler->getDeviceData(), espNowDevicesThrottle, now, client);
+#if LOOP_PROFILER
+            if (now - lastSentLoopProfile < LOOP_PROFILE_INTERVAL_MS)
+                return;
+            lastSentLoopProfile = now;
+            const LoopProfileMessage message;
+            batch.append(reinterpret_cast<const uint8_t*>(&message), message.length());
+#else
+            (void)now;
+#endif
         }
 
-        void sendEspNowControllerMessage(const unsigned long now, AsyncWebSocketClient* client = nullptr)
+        /** Like sendThrottledMessage(), but the list goes out as all of its pages or not at all */
+        bool sendEspNowDevicesMessage(const unsigned long now, Batch* target = nullptr)
         {
-            if (remoteEspNowHandler == nullptr) return;
-            sendThrottledMessage<std::array<uint8_t, 6>, EspNowControllerMessage>(
-                remoteEspNowHandler->getControllerAddress(), espNowControllerThrottle, now, client);
+            if (controllerEspNowHandler == nullptr) return true;
+            const auto devices = controllerEspNowHandler->getDeviceData();
+            if (!target)
+            {
+                const bool due = bypassThrottle
+                                     ? espNowDevicesThrottle.hasChanged(devices)
+                                     : espNowDevicesThrottle.shouldSend(now, devices);
+                if (!due) return !espNowDevicesThrottle.hasChanged(devices);
+            }
+            auto& out = target ? *target : batch;
+
+            const auto pages = EspNow::DevicePage::pageCount(devices);
+            const size_t pageOverhead = sizeof(Batch::Length) + sizeof(Message) + EspNow::DevicePage::HEADER_SIZE;
+            if (pages * pageOverhead + devices.deviceCount * sizeof(EspNow::Device) > out.available())
+                return false;
+            for (uint8_t i = 0; i < pages; ++i)
+            {
+                const EspNowDevicesMessage message(EspNow::DevicePage::of(devices, i));
+                out.append(reinterpret_cast<const uint8_t*>(&message), message.length());
+            }
+            if (!target)
+                espNowDevicesThrottle.setLastSent(now, devices);
+            return true;
         }
 
-        void sendFirmwareVersionMessage(const unsigned long now, AsyncWebSocketClient* client = nullptr)
+        bool sendEspNowControllerMessage(const unsigned long now, Batch* target = nullptr)
+        {
+            if (remoteEspNowHandler == nullptr) return true;
+            return sendThrottledMessage<std::array<uint8_t, 6>, EspNowControllerMessage>(
+                remoteEspNowHandler->getControllerAddress(), espNowControllerThrottle, now, target);
+        }
+
+        /** The version never changes at runtime, so it is only sent to new clients */
+        void sendFirmwareVersionMessage()
         {
             std::array<char, 10> version = {};
             std::strncpy(version.data(), DeviceManager::FIRMWARE_VERSION, version.size() - 1);
             version[version.size() - 1] = '\0';
-            sendThrottledMessage<std::array<char, 10>, FirmwareVersionMessage>(
-                version, firmwareVersionThrottle, now, client);
+            snapshot.append(FirmwareVersionMessage(version));
         }
 
-        void sendWiFiDetailsMessage(const unsigned long now, AsyncWebSocketClient* client = nullptr)
+        bool sendWiFiDetailsMessage(const unsigned long now, Batch* target = nullptr)
         {
-            if (wifiManager == nullptr) return;
-            sendThrottledMessage<WiFiDetails, WiFiDetailsMessage>(
-                wifiManager->getWifiDetails(), wifiDetailsThrottle, now, client);
+            if (wifiManager == nullptr) return true;
+            return sendThrottledMessage<WiFiDetails, WiFiDetailsMessage>(
+                wifiManager->getWifiDetails(), wifiDetailsThrottle, now, target);
         }
 
-        void sendWiFiStatusMessage(const unsigned long now, AsyncWebSocketClient* client = nullptr)
+        bool sendWiFiStatusMessage(const unsigned long now, Batch* target = nullptr)
         {
-            if (wifiManager == nullptr) return;
-            sendThrottledMessage<WiFiStatus, WiFiStatusMessage>(
-                wifiManager->getStatus(), wifiStatusThrottle, now, client);
+            if (wifiManager == nullptr) return true;
+            return sendThrottledMessage<WiFiStatus, WiFiStatusMessage>(
+                wifiManager->getStatus(), wifiStatusThrottle, now, target);
         }
 
-        void sendAlexaIntegrationSettingsMessage(const unsigned long now, AsyncWebSocketClient* client = nullptr)
+        bool sendAlexaIntegrationSettingsMessage(const unsigned long now, Batch* target = nullptr)
         {
-            if (alexaIntegration == nullptr) return;
-            sendThrottledMessage<AlexaIntegration::Settings, AlexaIntegrationSettingsMessage>(
-                alexaIntegration->getSettings(), alexaSettingsThrottle, now, client);
+            if (alexaIntegration == nullptr) return true;
+            return sendThrottledMessage<AlexaIntegration::Settings, AlexaIntegrationSettingsMessage>(
+                alexaIntegration->getSettings(), alexaSettingsThrottle, now, target);
         }
 
         // --------------------  Message Handling --------------------
@@ -215,10 +437,11 @@ namespace WebSocket
             {
             case WS_EVT_CONNECT:
                 ESP_LOGD(LOG_TAG, "WebSocket client connected: %s", client->remoteIP().toString().c_str());
-                sendAllMessages(millis(), client);
+                connectClient(millis(), client);
                 break;
             case WS_EVT_DISCONNECT: // NOLINT
                 ESP_LOGD(LOG_TAG, "WebSocket client disconnected: %s", client->remoteIP().toString().c_str());
+                disconnectClient(client);
                 break;
             case WS_EVT_PONG:
                 ESP_LOGD(LOG_TAG, "WebSocket pong received from client");
@@ -254,14 +477,14 @@ namespace WebSocket
             }
             if (info->index != 0)
             {
-                ESP_LOGD(LOG_TAG, "Received fragmented  Message with index %lld, only index 0 is processed",
-                         info->index);
+                ESP_LOGD(LOG_TAG, "Received fragmented  Message with index %llu, only index 0 is processed",
+                         static_cast<unsigned long long>(info->index));
                 return;
             }
             if (info->len != len)
             {
-                ESP_LOGD(LOG_TAG, "Received  Message with unexpected length: expected %lld, got %d", info->len,
-                         len);
+                ESP_LOGD(LOG_TAG, "Received  Message with unexpected length: expected %llu, got %u",
+                         static_cast<unsigned long long>(info->len), static_cast<unsigned>(len));
                 return;
             }
             if (len < 1)
@@ -271,7 +494,7 @@ namespace WebSocket
             }
 
             const uint8_t messageTypeRaw = data[0];
-            if (messageTypeRaw > static_cast<uint8_t>(Message::Type::ON_ALEXA_INTEGRATION_SETTINGS))
+            if (messageTypeRaw > static_cast<uint8_t>(Message::Type::ON_LOOP_PROFILE))
             {
                 ESP_LOGD(LOG_TAG, "Received unknown  Message type: %d", messageTypeRaw);
                 return;
@@ -296,6 +519,10 @@ namespace WebSocket
                 handleColorMessage(data, len);
                 break;
 
+            case Message::Type::ON_COLOR_DELTA:
+                handleColorDeltaMessage(client, data, len);
+                break;
+
             case Message::Type::ON_HTTP_CREDENTIALS:
                 handleHttpCredentialsMessage(data, len);
                 break;
@@ -308,6 +535,10 @@ namespace WebSocket
                 ESP_LOGD(LOG_TAG, "Received HEAP message (ignored).");
                 break;
 
+            case Message::Type::ON_LOOP_PROFILE:
+                ESP_LOGD(LOG_TAG, "Received LOOP_PROFILE message (ignored).");
+                break;
+
             case Message::Type::ON_BLE_STATUS:
                 handleBleStatusMessage(data, len);
                 break;
@@ -347,6 +578,34 @@ namespace WebSocket
             outputManager->setState(message->state);
         }
 
+        void handleColorDeltaMessage(const AsyncWebSocketClient* client, const uint8_t* data, const size_t len)
+        {
+            if (outputManager == nullptr) return;
+            if (len < sizeof(ColorDeltaMessage)) return;
+            const auto* message = reinterpret_cast<const ColorDeltaMessage*>(data);
+            if (len < message->length()) return;
+            if (!acceptColorSequence(client, message->sequence))
+            {
+                ESP_LOGD(LOG_TAG, "Dropping out-of-order color delta %u", message->sequence);
+                return;
+            }
+            // Only the channels in the frame are posted; the snapshot just tells
+            // the throttle what the other clients will be sent next
+            auto state = outputManager->getState();
+            const auto transitionMs = message->applyTo(state);
+            outputThrottle.setLastSent(millis(), state);
+            outputManager->setChannels(state, message->flags & ColorDeltaMessage::CHANNELS,
+                                       transitionMs.value_or(Output::Manager::DEFAULT_TRANSITION_MS));
+        }
+
+        bool acceptColorSequence(const AsyncWebSocketClient* client, const uint16_t sequence)
+        {
+            std::lock_guard lock(clientsMutex);
+            for (auto& slot : clients)
+                if (slot.holds(client)) return slot.acceptColorSequence(sequence);
+            return true;
+        }
+
         void handleHttpCredentialsMessage(const uint8_t* data, const size_t len) const
         {
             if (webServerHandler == nullptr) return;
@@ -376,13 +635,13 @@ namespace WebSocket
                 async_call([this]
                 {
                     bleManager->start();
-                }, 4096, 0);
+                });
                 break;
             case BLE::Status::OFF:
                 async_call([this]
                 {
                     bleManager->stop();
-                }, 4096, 0);
+                });
                 break;
             default:
                 break;
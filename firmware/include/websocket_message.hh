@@ -1,9 +1,12 @@
 #pragma once
 
 #include <array>
+#include <cstring>
+#include <optional>
 #include "device_manager.hh"
 #include "ota_handler.hh"
 #include "esp_now_handler_controller.hh"
+#include "loop_profiler.hh"
 
 namespace WebSocket
 {
@@ -25,7 +28,10 @@ namespace WebSocket
             ON_OTA_PROGRESS,
             ON_ALEXA_INTEGRATION_SETTINGS,
             ON_ESP_NOW_DEVICES,
-            ON_ESP_NOW_CONTROLLER
+            ON_ESP_NOW_CONTROLLER,
+            ON_BATCH,
+            ON_COLOR_DELTA,
+            ON_LOOP_PROFILE
         };
 
         Type type;
@@ -45,6 +51,54 @@ namespace WebSocket
         }
     };
 
+    /**
+     * Compact ON_COLOR update for streaming. The header is followed by an
+     * optional uint16 transition time (HAS_TRANSITION) and a Light::State for
+     * each channel flagged in CHANNELS, in color order. The sequence number
+     * increases with every message so late frames can be dropped.
+     */
+    struct ColorDeltaMessage : Message
+    {
+        static constexpr uint8_t CHANNELS = 0x0F;
+        static constexpr uint8_t HAS_TRANSITION = 0x80;
+
+        uint16_t sequence;
+        uint8_t flags;
+
+        ColorDeltaMessage(const uint16_t sequence, const uint8_t flags)
+            : Message(Type::ON_COLOR_DELTA), sequence(sequence), flags(flags)
+        {
+        }
+
+        [[nodiscard]] size_t length() const
+        {
+            return sizeof(ColorDeltaMessage)
+                + (flags & HAS_TRANSITION ? sizeof(uint16_t) : 0)
+                + __builtin_popcount(flags & CHANNELS) * sizeof(Light::State);
+        }
+
+        /** Overlays the flagged channels onto the state; returns the transition time if one was given */
+        std::optional<uint16_t> applyTo(Output::State& state) const
+        {
+            auto payload = reinterpret_cast<const uint8_t*>(this) + sizeof(ColorDeltaMessage);
+            std::optional<uint16_t> transitionMs;
+            if (flags & HAS_TRANSITION)
+            {
+                uint16_t ms;
+                std::memcpy(&ms, payload, sizeof(ms));
+                payload += sizeof(ms);
+                transitionMs = ms;
+            }
+            for (size_t i = 0; i < state.values.size(); ++i)
+            {
+                if (!(flags & 1 << i)) continue;
+                std::memcpy(&state.values[i], payload, sizeof(Light::State));
+                payload += sizeof(Light::State);
+            }
+            return transitionMs;
+        }
+    };
+
     struct BleStatusMessage : Message
     {
         BLE::Status status;
@@ -145,14 +199,21 @@ namespace WebSocket
         }
     };
 
+    /** One page of the device list; a list of any length takes DevicePage::pageCount() of them */
     struct EspNowDevicesMessage : Message
     {
-        EspNow::DeviceData data;
+        EspNow::DevicePage page;
 
-        explicit EspNowDevicesMessage(const EspNow::DeviceData& data)
-            : Message(Type::ON_ESP_NOW_DEVICES), data(data)
+        explicit EspNowDevicesMessage(const EspNow::DevicePage& page)
+            : Message(Type::ON_ESP_NOW_DEVICES), page(page)
         {
         }
+
+        /** Only the devices on the page are sent */
+        [[nodiscard]] size_t length() const
+        {
+            return sizeof(Message) + page.size();
+        }
     };
 
     struct EspNowControllerMessage : Message
@@ -175,6 +236,107 @@ namespace WebSocket
         }
     };
 
+#if LOOP_PROFILER
+    /**
+     * Loop profiler summary: the CPU clock in MHz and a section count,
+     * followed by that many LoopProfiler::SectionStats. Only the filled
+     * entries are sent, see length().
+     */
+    struct LoopProfileMessage : Message
+    {
+        uint16_t cpuMhz = 0;
+        uint8_t sectionCount = 0;
+        std::array<LoopProfiler::SectionStats, LoopProfiler::MAX_SECTIONS> sections;
+
+        LoopProfileMessage() : Message(Type::ON_LOOP_PROFILE)
+        {
+            auto& registry = LoopProfiler::Registry::get();
+            sectionCount = registry.snapshot(sections);
+            cpuMhz = registry.getCpuFrequencyMhz();
+        }
 
+        [[nodiscard]] size_t length() const
+        {
+            return sizeof(Message) + sizeof(cpuMhz) + sizeof(sectionCount)
+                + sectionCount * sizeof(LoopProfiler::SectionStats);
+        }
+    };
+#endif
 #pragma pack(pop)
+
+    /**
+     * ON_BATCH envelope carrying several messages in a single frame. The type
+     * byte is followed by entries made of a little-endian uint16 length and a
+     * complete message, including its own type byte. A batch holding a single
+     * message is sent as that message alone.
+     */
+    class Batch
+    {
+    public:
+        using Length = uint16_t;
+        static constexpr size_t CAPACITY = 1536;
+        static constexpr size_t HEADER_SIZE = sizeof(Message::Type);
+
+    private:
+        std::array<uint8_t, CAPACITY> buffer = {static_cast<uint8_t>(Message::Type::ON_BATCH)};
+        size_t size = HEADER_SIZE;
+        uint8_t count = 0;
+
+    public:
+        template <typename TMessage>
+        bool append(const TMessage& message)
+        {
+            return append(reinterpret_cast<const uint8_t*>(&message), sizeof(TMessage));
+        }
+
+        bool append(const uint8_t* message, const size_t len)
+        {
+            if (size + sizeof(Length) + len > CAPACITY) return false;
+            buffer[size] = len & 0xFF;
+            buffer[size + 1] = len >> 8 & 0xFF;
+            std::memcpy(buffer.data() + size + sizeof(Length), message, len);
+            size += sizeof(Length) + len;
+            ++count;
+            return true;
+        }
+
+        void clear()
+        {
+            size = HEADER_SIZE;
+            count = 0;
+        }
+
+        [[nodiscard]] bool empty() const
+        {
+            return count == 0;
+        }
+
+        /** Bytes left for entries, their length prefixes included */
+        [[nodiscard]] size_t available() const
+        {
+            return CAPACITY - size;
+        }
+
+        [[nodiscard]] uint8_t messageCount() const
+        {
+            return count;
+        }
+
+        [[nodiscard]] const uint8_t* data() const
+        {
+            return count == 1 ? buffer.data() + HEADER_SIZE + sizeof(Length) : buffer.data();
+        }
+
+        [[nodiscard]] size_t length() const
+        {
+            return count == 1 ? size - HEADER_SIZE - sizeof(Length) : size;
+        }
+
+        /** Worst-case size of a batch holding one of each message */
+        template <typename... TMessages>
+        static constexpr size_t sizeFor()
+        {
+            return HEADER_SIZE + ((sizeof(Length) + sizeof(TMessages)) + ...);
+        }
+    };
 }
@@ -7,8 +7,13 @@
 #include <cstring>
 #include <atomic>
 #include <mutex>
+#include <optional>
 
+#include "async_call.hh"
 #include "ble_manager.hh"
+#include "change_bus.hh"
+#include "event_loop.hh"
+#include "inplace_function.hh"
 #include "state_json_filler.hh"
 #include "NimBLEServer.h"
 #include "NimBLEService.h"
@@ -33,7 +38,8 @@ class WiFiManager final : public BLE::Service, public StateJsonFiller
     NimBLECharacteristic* bleScanStatusCharacteristic = nullptr;
     NimBLECharacteristic* bleScanResultCharacteristic = nullptr;
 
-    std::function<void()> gotIpChanged;
+    InplaceFunction<void()> gotIpChanged;
+    std::optional<WiFiConnectionDetails> pendingConnection;
 
 public:
     void begin()
@@ -154,7 +160,7 @@ public:
         return scanResult;
     }
 
-    void setGotIpCallback(std::function<void()> cb)
+    void setGotIpCallback(InplaceFunction<void()> cb)
     {
         gotIpChanged = std::move(cb);
     }
@@ -225,6 +231,27 @@ public:
             connect(details.ssid.data(), details.credentials.simple);
     }
 
+    /**
+     * Connects from an async_call worker. The details are too large to be
+     * captured, so they wait here; a newer request replaces an older one.
+     */
+    void connectLater(const WiFiConnectionDetails& details)
+    {
+        {
+            std::lock_guard lock(getPendingConnectionMutex());
+            pendingConnection = details;
+        }
+        async_call([this]
+        {
+            std::optional<WiFiConnectionDetails> details;
+            {
+                std::lock_guard lock(getPendingConnectionMutex());
+                details.swap(pendingConnection);
+            }
+            if (details) connect(details.value());
+        });
+    }
+
 private:
     static bool isEap(const WiFiConnectionDetails& details)
     {
@@ -276,6 +303,7 @@ private:
                  wifiStatusString(wifiStatus.load()), wifiStatusString(newStatus));
         wifiStatus = newStatus;
         fillWiFiDetails();
+        ChangeBus::publish(ChangeBus::Topic::WiFiStatus);
 
         std::lock_guard bleLock(getBleMutex());
         if (bleStatusCharacteristic)
@@ -303,12 +331,14 @@ private:
         wifiDetails.gateway = static_cast<uint32_t>(WiFi.gatewayIP());
         wifiDetails.subnet = static_cast<uint32_t>(WiFi.subnetMask());
         wifiDetails.dns = static_cast<uint32_t>(WiFi.dnsIP());
+        ChangeBus::publish(ChangeBus::Topic::WiFiDetails);
     }
 
     void setScanStatus(const WifiScanStatus status)
     {
         if (status == scanStatus) return;
         this->scanStatus = status;
+        EventLoop::wake();
         std::lock_guard bleLock(getBleMutex());
         if (bleScanStatusCharacteristic)
         {
@@ -338,6 +368,12 @@ private:
         return mutex;
     }
 
+    static std::mutex& getPendingConnectionMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
     static void connect(const char* ssid, const WiFiConnectionDetails::SimpleWiFiConnectionCredentials& details)
     {
         esp_wifi_sta_wpa2_ent_disable();
@@ -429,6 +465,16 @@ public:
         wifi["status"] = wifiStatusString(wifiStatus);
     }
 
+    [[nodiscard]] const char* getStateFields() const override
+    {
+        return "wifi";
+    }
+
+    [[nodiscard]] ChangeBus::Mask getStateTopics() const override
+    {
+        return ChangeBus::maskOf(ChangeBus::Topic::WiFiDetails, ChangeBus::Topic::WiFiStatus);
+    }
+
     void createServiceAndCharacteristics(NimBLEServer* server) override
     {
         std::lock_guard bleLock(getBleMutex());
@@ -512,15 +558,12 @@ public:
             WiFiConnectionDetails details = {};
             if (pCharacteristic->getValue().size() != sizeof(WiFiConnectionDetails))
             {
-                ESP_LOGE(LOG_TAG, "Received invalid WiFi connection details length: %d",
-                         pCharacteristic->getValue().size());
+                ESP_LOGE(LOG_TAG, "Received invalid WiFi connection details length: %u",
+                         static_cast<unsigned>(pCharacteristic->getValue().size()));
                 return;
             }
             memcpy(&details, pCharacteristic->getValue().data(), sizeof(WiFiConnectionDetails));
-            async_call([details, this]
-            {
-                wifiManager->connect(details);
-            }, 4096, 0);
+            wifiManager->connectLater(details);
         }
     };
 
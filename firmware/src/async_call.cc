@@ -1,36 +1,195 @@
 #include "async_call.hh"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
 #include <esp32-hal.h>
 #include <esp_system.h>
 #include <freertos/FreeRTOS.h> // NOLINT
+#include <freertos/queue.h>
 #include <freertos/task.h>
 
 constexpr auto ASYNC_CALL_TAG = "AsyncCall";
 
-struct AsyncCallArgs
+namespace
 {
-    std::function<void()> callback;
-    uint32_t delayMs;
-};
+    constexpr uint8_t NONE = 0xFF;
+    /** Queued instead of a job index to make a worker look at the timer wheel */
+    constexpr uint8_t WAKE_UP = 0xFE;
+    constexpr uint8_t WHEEL_SIZE = 32;
 
-void doCall(void* args)
+    static_assert(AsyncCall::MAX_PENDING < WAKE_UP, "Job indices must not collide with markers");
+
+    struct Job
+    {
+        AsyncCall::Callback callback;
+        uint32_t dueUs = 0;
+        uint32_t rounds = 0;
+        uint8_t next = NONE;
+    };
+
+    /**
+     * Jobs live in a fixed table. Ready ones are handed to the workers as
+     * table indices through a queue; delayed ones hang off a hashed timer
+     * wheel of TICK_MS buckets, advanced by whichever worker wakes up.
+     */
+    class Pool
+    {
+        std::mutex mutex;
+        std::array<Job, AsyncCall::MAX_PENDING> jobs;
+        uint8_t freeList = 0;
+
+        std::array<uint8_t, WHEEL_SIZE> wheel = {};
+        std::atomic<uint8_t> timers = 0;
+        uint32_t wheelTick = 0;
+        unsigned long wheelTime = 0;
+
+        // Every job holds at most one index and one wake-up in the queue
+        QueueHandle_t ready = xQueueCreate(AsyncCall::MAX_PENDING * 2, sizeof(uint8_t));
+        AsyncCall::Stats stats;
+
+    public:
+        Pool()
+        {
+            for (size_t i = 0; i < jobs.size(); ++i)
+                jobs[i].next = i + 1 < jobs.size() ? static_cast<uint8_t>(i + 1) : NONE;
+            wheel.fill(NONE);
+            wheelTime = millis();
+            for (uint8_t i = 0; i < AsyncCall::WORKER_COUNT; ++i)
+                if (xTaskCreate(work, "AsyncCall", AsyncCall::WORKER_STACK_SIZE, this, 1, nullptr) != pdPASS)
+                    ESP_LOGE(ASYNC_CALL_TAG, "Failed to create worker task");
+        }
+
+        bool schedule(AsyncCall::Callback&& callback, const uint32_t delayMs)
+        {
+            uint8_t index;
+            {
+                std::lock_guard lock(mutex);
+                if (freeList == NONE)
+                {
+                    ++stats.rejected;
+                    return false;
+                }
+                index = freeList;
+                auto& job = jobs[index];
+                freeList = job.next;
+                job.callback = std::move(callback);
+                job.dueUs = micros() + delayMs * 1000;
+                stats.maxPending = std::max(++stats.pending, stats.maxPending);
+                if (delayMs != 0)
+                {
+                    addTimer(index, delayMs);
+                    index = WAKE_UP;
+                }
+            }
+            xQueueSend(ready, &index, 0);
+            return true;
+        }
+
+        AsyncCall::Stats getStats()
+        {
+            std::lock_guard lock(mutex);
+            return stats;
+        }
+
+    private:
+        [[noreturn]] static void work(void* arg)
+        {
+            auto* pool = static_cast<Pool*>(arg);
+            for (;;)
+            {
+                uint8_t index;
+                const auto timeout = pool->timers.load() ? pdMS_TO_TICKS(AsyncCall::TICK_MS) : portMAX_DELAY;
+                if (xQueueReceive(pool->ready, &index, timeout) == pdTRUE && index != WAKE_UP)
+                    pool->run(index);
+                std::lock_guard lock(pool->mutex);
+                pool->advance(millis());
+            }
+        }
+
+        void run(const uint8_t index)
+        {
+            AsyncCall::Callback callback;
+            {
+                std::lock_guard lock(mutex);
+                auto& job = jobs[index];
+                callback = std::move(job.callback);
+                job.callback = nullptr;
+                const auto late = static_cast<int32_t>(micros() - job.dueUs);
+                stats.lastLatencyUs = std::max<int32_t>(late, 0);
+                stats.maxLatencyUs = std::max(stats.lastLatencyUs, stats.maxLatencyUs);
+            }
+            callback();
+            std::lock_guard lock(mutex);
+            jobs[index].next = freeList;
+            freeList = index;
+            --stats.pending;
+            ++stats.executed;
+        }
+
+        /**
+         * One extra tick covers the part of the current one that already
+         * went by, so a timer never fires early.
+         */
+        void addTimer(const uint8_t index, const uint32_t delayMs)
+        {
+            advance(millis());
+            const uint32_t ticks = (delayMs + AsyncCall::TICK_MS - 1) / AsyncCall::TICK_MS + 1;
+            const auto bucket = (wheelTick + ticks) % WHEEL_SIZE;
+            jobs[index].rounds = (ticks - 1) / WHEEL_SIZE;
+            jobs[index].next = wheel[bucket];
+            wheel[bucket] = index;
+            ++timers;
+        }
+
+        /** Moves timers that came due up to now to the ready queue */
+        void advance(const unsigned long now)
+        {
+            while (now - wheelTime >= AsyncCall::TICK_MS)
+            {
+                wheelTime += AsyncCall::TICK_MS;
+                if (!timers.load())
+                {
+                    wheelTick += (now - wheelTime) / AsyncCall::TICK_MS + 1;
+                    wheelTime += (now - wheelTime) / AsyncCall::TICK_MS * AsyncCall::TICK_MS;
+                    return;
+                }
+                auto* link = &wheel[++wheelTick % WHEEL_SIZE];
+                while (*link != NONE)
+                {
+                    auto& job = jobs[*link];
+                    if (job.rounds != 0)
+                    {
+                        --job.rounds;
+                        link = &job.next;
+                        continue;
+                    }
+                    const uint8_t index = *link;
+                    *link = job.next;
+                    --timers;
+                    xQueueSend(ready, &index, 0);
+                }
+            }
+        }
+    };
+
+    Pool& getPool()
+    {
+        static Pool pool;
+        return pool;
+    }
+}
+
+AsyncCall::Stats AsyncCall::getStats()
 {
-    const auto* callArgs = static_cast<AsyncCallArgs*>(args);
-    delay(callArgs->delayMs);
-    callArgs->callback();
-    delete callArgs;
-    vTaskDelete(nullptr); // Delete this task
+    return getPool().getStats();
 }
 
-void async_call(
-    std::function<void()> callback,
-    const uint32_t usStackDepth,
-    const uint32_t delayMs)
+bool async_call(AsyncCall::Callback callback, const uint32_t delayMs)
 {
-    if (auto* args = new AsyncCallArgs{std::move(callback), delayMs};
-        xTaskCreate(doCall, "AsyncCallTask", usStackDepth, args, 1, nullptr) != pdPASS)
-    {
-        ESP_LOGE(ASYNC_CALL_TAG, "Failed to create task");
-        delete args;
-    }
+    if (getPool().schedule(std::move(callback), delayMs))
+        return true;
+    ESP_LOGE(ASYNC_CALL_TAG, "Too many pending calls, dropping one");
+    return false;
 }
@@ -7,19 +7,31 @@
 #include "alexa_integration.hh"
 #include "device_manager.hh"
 #include "esp_now_handler_controller.hh"
+#include "event_loop.hh"
+#include "loop_profiler_handler.hh"
 #include "output_manager.hh"
 #include "push_button.hh"
+#include "realtime_receiver.hh"
 #include "ota_handler.hh"
 #include "state_rest_handler.hh"
+#include "state_events_handler.hh"
 #include "rotary_encoder_manager.hh"
 #include "websocket_handler.hh"
 #include "esp_now_handler.hh"
 
 void beginAlexaAndWebServer();
+EventLoop::Deadline handleOutput(unsigned long now);
+EventLoop::Deadline handleServices(unsigned long now);
 void onDataReceived(const uint8_t* mac, const uint8_t* incomingData, int len);
+void onEspNowMessage(const EspNow::Message* message);
 
 static constexpr auto LOG_TAG = "Controller";
 
+/** Inputs and PWM on the app core, above everything else there */
+static constexpr EventLoop::TaskConfig OUTPUT_TASK = {"output", 4096, 5, 1};
+/** The rest on the protocol core, next to the Wi-Fi and BLE stacks it talks to */
+static constexpr EventLoop::TaskConfig SERVICE_TASK = {"service", 8192, 1, 0};
+
 BoardLED boardLED(ControllerHardware::Pin::BoardLed::RED,
                   ControllerHardware::Pin::BoardLed::GREEN,
                   ControllerHardware::Pin::BoardLed::BLUE);
@@ -29,7 +41,8 @@ PushButton boardButton(ControllerHardware::Pin::Button::BUTTON1);
 Output::Manager outputManager(ControllerHardware::Pin::Output::RED,
                               ControllerHardware::Pin::Output::GREEN,
                               ControllerHardware::Pin::Output::BLUE,
-                              ControllerHardware::Pin::Output::WHITE);
+                              ControllerHardware::Pin::Output::WHITE,
+                              Light::PWM_12_BIT);
 
 PushButton rotaryEncoderButton(ControllerHardware::Pin::Header::H1::P3);
 RotaryEncoderManager rotaryEncoderManager(ControllerHardware::Pin::Header::H1::P1,
@@ -42,6 +55,7 @@ DeviceManager deviceManager;
 EspNow::ControllerHandler espNowHandler;
 AlexaIntegration alexaIntegration(outputManager);
 OTA::Handler otaHandler(httpManager.getAuthenticationMiddleware());
+Realtime::Receiver realtimeReceiver(outputManager);
 
 std::array<uint8_t, 4> advertisementData =
     BLE::Manager::buildAdvertisementData(54321, 0xAA, 0xAA);
@@ -74,28 +88,39 @@ StateRestHandler stateRestHandler({
     &outputManager,
     &otaHandler,
     &alexaIntegration,
-    &espNowHandler
+    &espNowHandler,
+    &realtimeReceiver,
+    &webSocketHandler
 });
 
+StateEventsHandler stateEventsHandler(stateRestHandler);
+
+#if LOOP_PROFILER
+LoopProfiler::RestHandler loopProfilerHandler;
+#endif
+
 void setup()
 {
     ESP_LOGI(LOG_TAG, "Starting controller");
+    EventLoop::begin(true);
 
     boardLED.begin();
     outputManager.begin();
     deviceManager.begin();
     esp_now_init();
+    espNowHandler.onMessage([](const EspNow::Message& message) { onEspNowMessage(&message); });
     esp_now_register_recv_cb(onDataReceived);
     espNowHandler.begin();
 
     wifiManager.begin();
     wifiManager.setGotIpCallback(beginAlexaAndWebServer);
 
-    boardButton.setLongPressCallback([] { bleManager.start(); });
+    // Buttons run on the output task, which must not wait for the BLE stack
+    boardButton.setLongPressCallback([] { async_call([] { bleManager.start(); }); });
     boardButton.setShortPressCallback([] { outputManager.toggleAll(); });
     boardButton.begin();
 
-    rotaryEncoderButton.setLongPressCallback([] { bleManager.start(); });
+    rotaryEncoderButton.setLongPressCallback([] { async_call([] { bleManager.start(); }); });
     rotaryEncoderButton.setShortPressCallback([] { outputManager.toggleAll(); });
     rotaryEncoderButton.begin();
 
@@ -108,43 +133,91 @@ void setup()
         wifiManager.connect(credentials.value());
     else
         bleManager.start();
+
+    EventLoop::run(EventLoop::Task::Output, OUTPUT_TASK, handleOutput);
+    EventLoop::run(EventLoop::Task::Service, SERVICE_TASK, handleServices);
     ESP_LOGI(LOG_TAG, "Startup complete");
 }
 
 void loop()
 {
-    const auto now = millis();
+    // setup() handed everything over to the output and service tasks
+    vTaskDelete(nullptr);
+}
+
+/**
+ * One pass of the output task: inputs, ESP-NOW commands, realtime frames
+ * and the commands queued for the output manager, rendered to PWM.
+ */
+EventLoop::Deadline handleOutput(const unsigned long now)
+{
+    LOOP_PROFILE_SCOPE("outputLoop");
 
-    bleManager.handle(now);
-    boardButton.handle(now);
-    rotaryEncoderButton.handle(now);
-    deviceManager.handle(now);
-    outputManager.handle(now);
-    webSocketHandler.handle(now);
-    alexaIntegration.handle(now);
+    LOOP_PROFILE("button", boardButton.handle(now));
+    LOOP_PROFILE("encoderButton", rotaryEncoderButton.handle(now));
+    LOOP_PROFILE("espNow", espNowHandler.handle(now));
+    LOOP_PROFILE("realtime", realtimeReceiver.handle(now));
+    LOOP_PROFILE("output", outputManager.handle(now));
 
-    boardLED.handle(
+    EventLoop::Deadline next(now);
+    boardButton.schedule(next);
+    rotaryEncoderButton.schedule(next);
+    espNowHandler.schedule(next);
+    realtimeReceiver.schedule(next);
+    outputManager.schedule(next);
+    return next;
+}
+
+/** One pass of the service task: network, BLE, storage and status */
+EventLoop::Deadline handleServices(const unsigned long now)
+{
+    LOOP_PROFILE_SCOPE("loop");
+
+    LOOP_PROFILE("ble", bleManager.handle(now));
+    LOOP_PROFILE("device", deviceManager.handle(now));
+    LOOP_PROFILE("outputBle", outputManager.handleBle(now));
+    LOOP_PROFILE("webSocket", webSocketHandler.handle(now));
+    LOOP_PROFILE("stateRest", stateRestHandler.handle(now));
+    LOOP_PROFILE("stateEvents", stateEventsHandler.handle(now));
+    LOOP_PROFILE("alexa", alexaIntegration.handle(now));
+
+    LOOP_PROFILE("boardLed", boardLED.handle(
         now,
         bleManager.getStatus(),
         wifiManager.getScanStatus(),
         wifiManager.getStatus(),
         otaHandler.getStatus() == OTA::Status::Started
-    );
-    vTaskDelay(pdMS_TO_TICKS(1));
+    ));
+
+    EventLoop::Deadline next(now);
+    bleManager.schedule(next);
+    deviceManager.schedule(next);
+    outputManager.scheduleBle(next);
+    webSocketHandler.schedule(next);
+    stateRestHandler.schedule(next);
+    stateEventsHandler.schedule(next);
+    alexaIntegration.schedule(next);
+    boardLED.schedule(next);
+    return next;
 }
 
 void beginAlexaAndWebServer()
 {
     alexaIntegration.begin();
+    realtimeReceiver.begin();
     httpManager.begin(
         alexaIntegration.createAsyncWebHandler(),
         {
             &webSocketHandler,
             &otaHandler,
             &stateRestHandler,
+            &stateEventsHandler,
             &bleManager,
             &deviceManager,
-            &outputManager
+            &outputManager,
+#if LOOP_PROFILER
+            &loopProfilerHandler,
+#endif
         }
     );
 }
@@ -180,23 +253,28 @@ void onEspNowMessage(const EspNow::Message* message)
     case EspNow::Message::Type::DecreaseBrightness:
         outputManager.decreaseBrightness();
         break;
+    case EspNow::Message::Type::SetBrightness:
+        outputManager.setValues({message->values[0], message->values[0], message->values[0], message->values[0]},
+                                message->channels);
+        break;
+    case EspNow::Message::Type::SetColor:
+        outputManager.setValues(message->values, message->channels);
+        break;
+    case EspNow::Message::Type::SetState:
+        {
+            Output::State state;
+            for (size_t i = 0; i < state.values.size(); ++i)
+                state.values[i] = {(message->on & 1 << i) != 0, message->values[i]};
+            outputManager.setChannels(state, message->channels);
+        }
+        break;
+    case EspNow::Message::Type::StepBrightness:
+        outputManager.stepBrightness(message->steps);
+        break;
     }
 }
 
 void onDataReceived(const uint8_t* mac, const uint8_t* incomingData, const int len)
 {
-    ESP_LOGI(LOG_TAG, "Data received from %02X:%02X:%02X:%02X:%02X:%02X, length: %d",
-             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], len);
-
-    if (!espNowHandler.isMacAllowed(mac))
-    {
-        ESP_LOGW(LOG_TAG, "MAC address not allowed, ignoring packet");
-        return;
-    }
-
-    if (len != sizeof(EspNow::Message)) return;
-
-    const auto message = reinterpret_cast<EspNow::Message*>(const_cast<uint8_t*>(incomingData));
-
-    onEspNowMessage(message);
+    espNowHandler.onDataReceived(mac, incomingData, len);
 }
@@ -0,0 +1,1142 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp_now.h>
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+
+#include "wifi_manager.hh"
+#include "alexa_integration.hh"
+#include "device_manager.hh"
+#include "esp_now_handler_controller.hh"
+#include "output_manager.hh"
+#include "ota_handler.hh"
+#include "websocket_handler.hh"
+#include "state_rest_handler.hh"
+#include "state_events_handler.hh"
+#include "moving_average.hh"
+#include "realtime_receiver.hh"
+#include "inplace_function.hh"
+#include "event_loop.hh"
+#include "push_button.hh"
+#include "loop_profiler.hh"
+#include "seqlock.hh"
+
+/**
+ * Host-side microbenchmarks for the hot paths of the controller firmware.
+ * Build and run with `pio run -e native -t exec`. Timings are informational;
+ * the checks along the way make the run exit non-zero when one fails.
+ */
+namespace Benchmark
+{
+    uint32_t failures = 0;
+
+    void check(const bool passed, const char* what)
+    {
+        if (passed) return;
+        std::fprintf(stderr, "FAILED: %s\n", what);
+        ++failures;
+    }
+
+    template <typename T>
+    void doNotOptimize(const T& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    template <typename Body>
+    void run(const char* name, const uint32_t iterations, Body&& body)
+    {
+        for (uint32_t i = 0; i < iterations / 10; ++i)
+            body(i);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; ++i)
+            body(i);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        const auto ns = std::chrono::duration<double, std::nano>(elapsed).count();
+        std::printf("%-52s %12" PRIu32 " iterations %10.1f ns/op\n", name, iterations, ns / iterations);
+    }
+}
+
+Output::Manager outputManager(ControllerHardware::Pin::Output::RED,
+                              ControllerHardware::Pin::Output::GREEN,
+                              ControllerHardware::Pin::Output::BLUE,
+                              ControllerHardware::Pin::Output::WHITE,
+                              Light::PWM_12_BIT);
+
+WiFiManager wifiManager;
+HTTP::Manager httpManager;
+DeviceManager deviceManager;
+EspNow::ControllerHandler espNowHandler;
+EspNow::RemoteHandler remoteEspNowHandler;
+AlexaIntegration alexaIntegration(outputManager);
+OTA::Handler otaHandler(httpManager.getAuthenticationMiddleware());
+
+std::array<uint8_t, 4> advertisementData =
+    BLE::Manager::buildAdvertisementData(54321, 0xAA, 0xAA);
+
+BLE::Manager bleManager(advertisementData, deviceManager, {&outputManager});
+
+WebSocket::Handler webSocketHandler(&outputManager,
+                                    &otaHandler,
+                                    &wifiManager,
+                                    &httpManager,
+                                    &alexaIntegration,
+                                    &bleManager,
+                                    &deviceManager,
+                                    &espNowHandler,
+                                    nullptr);
+
+StateRestHandler stateRestHandler({
+    &deviceManager,
+    &wifiManager,
+    &bleManager,
+    &outputManager,
+    &otaHandler,
+    &alexaIntegration,
+    &espNowHandler,
+    &webSocketHandler
+});
+
+StateEventsHandler stateEventsHandler(stateRestHandler);
+
+Realtime::Receiver realtimeReceiver(outputManager);
+
+static uint32_t ledcWrites()
+{
+    uint32_t writes = 0;
+    for (uint8_t channel = 0; channel < NativeHal::LEDC_CHANNELS; ++channel)
+        writes += NativeHal::getLedcChannel(channel).writes;
+    return writes;
+}
+
+static uint32_t ledcDutySum()
+{
+    uint32_t sum = 0;
+    for (uint8_t channel = 0; channel < NativeHal::LEDC_CHANNELS; ++channel)
+        sum += NativeHal::getLedcChannel(channel).duty;
+    return sum;
+}
+
+/**
+ * The pow()-based step Light used before the gamma table, kept as a baseline.
+ */
+static uint8_t perceptualBrightnessStepPow(const uint8_t currentValue, const bool increase)
+{
+    float linear = pow(static_cast<float>(currentValue) / 255.0f, 1.0f / 2.2f);
+    linear += increase ? 0.05f : -0.05f;
+    linear = std::clamp(linear, 0.0f, 1.0f);
+    const auto value = lround(pow(linear, 2.2f) * 255.0f);
+    return std::clamp(static_cast<uint8_t>(value), Light::MIN_BRIGHTNESS, Light::MAX_BRIGHTNESS);
+}
+
+static void benchmarkGamma()
+{
+    using Perceptual = Gamma::Perceptual;
+    bool tablesMatch = true;
+    bool stepsMatch = true;
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        const double x = i / 255.0;
+        tablesMatch &= Perceptual::TO_DUTY[i] == lround(pow(x, Perceptual::GAMMA) * 255.0)
+            && Perceptual::TO_PERCEPTUAL[i] == lround(pow(x, 1.0 / Perceptual::GAMMA) * 255.0)
+            && Perceptual::TO_DUTY_16[i] == lround(pow(x, Perceptual::GAMMA) * 65535.0)
+            && Perceptual::TO_LEVEL[i] == lround(pow(x, 1.0 / Perceptual::GAMMA) * Perceptual::MAX_LEVEL);
+        for (const bool increase : {true, false})
+        {
+            const double perceptual = std::clamp(pow(x, 1.0 / 2.2) + (increase ? 0.05 : -0.05), 0.0, 1.0);
+            const auto expected = lround(pow(perceptual, 2.2) * 255.0);
+            stepsMatch &= (increase ? Light::Steps::UP[i] : Light::Steps::DOWN[i]) == expected;
+        }
+    }
+    Benchmark::check(tablesMatch, "Gamma::Perceptual tables equal pow()");
+    Benchmark::check(stepsMatch, "Gamma::BrightnessSteps equal pow()");
+
+    volatile uint8_t value = 128;
+
+    Benchmark::run("perceptualBrightnessStep (pow)", 10000000, [&](const uint32_t i)
+    {
+        value = perceptualBrightnessStepPow(static_cast<uint8_t>(i), i & 1);
+    });
+
+    Benchmark::run("perceptualBrightnessStep (Gamma::BrightnessSteps)", 10000000, [&](const uint32_t i)
+    {
+        const auto current = static_cast<uint8_t>(i);
+        value = std::clamp(i & 1 ? Light::Steps::UP[current] : Light::Steps::DOWN[current],
+                           Light::MIN_BRIGHTNESS, Light::MAX_BRIGHTNESS);
+    });
+}
+
+static void benchmarkLight()
+{
+    Light light(ControllerHardware::Pin::Output::RED);
+    light.setup();
+
+    Benchmark::run("Light::setState", 1000000, [&](const uint32_t i)
+    {
+        light.setState({true, static_cast<uint8_t>(i)});
+    });
+
+    Benchmark::run("Light::increase/decreaseBrightness", 1000000, [&](const uint32_t i)
+    {
+        if (i % 64 < 32)
+            light.increaseBrightness();
+        else
+            light.decreaseBrightness();
+    });
+}
+
+static void benchmarkOutputManager()
+{
+    outputManager.begin();
+
+    // Mutators only queue a command; handing them over every 16 keeps the queue from filling up
+    Benchmark::run("Output::Manager::setState (applied every 16)", 1000000, [](const uint32_t i)
+    {
+        const auto v = static_cast<uint8_t>(i);
+        outputManager.setState({{{{true, v}, {true, v}, {false, v}, {true, v}}}});
+        if (i % 16 == 15)
+            outputManager.handle(millis());
+    });
+
+    Benchmark::run("Output::Manager::increase/decreaseBrightness (every 16)", 1000000, [](const uint32_t i)
+    {
+        if (i % 64 < 32)
+            outputManager.increaseBrightness();
+        else
+            outputManager.decreaseBrightness();
+        if (i % 16 == 15)
+            outputManager.handle(millis());
+    });
+
+    Benchmark::run("Output::Manager::stepBrightness (16 steps each)", 62500, [](const uint32_t i)
+    {
+        outputManager.stepBrightness(i % 4 < 2 ? 16 : -16);
+        outputManager.handle(millis());
+    });
+
+    NativeHal::setTime(0);
+    NativeHal::resetLedcCounters();
+    const auto writesBefore = NativeHal::getNvsWriteCount();
+    Benchmark::run("Output::Manager::handle (1ms ticks)", 100000, [](const uint32_t i)
+    {
+        NativeHal::advanceTime(1);
+        outputManager.setValue(static_cast<uint8_t>(i / 100), Color::Red);
+        outputManager.handle(millis());
+    });
+    delay(10);
+    const auto stats = outputManager.getPersistenceStats();
+    std::printf("%-52s %12" PRIu32 " NVS writes for %" PRIu32 " changes, %" PRIu32 " PWM writes\n", "",
+                NativeHal::getNvsWriteCount() - writesBefore, stats.changes, ledcWrites());
+
+    NativeHal::resetLedcCounters();
+    Benchmark::run("Output::Manager fade 0-255 (1ms ticks)", 100000, [](const uint32_t i)
+    {
+        NativeHal::advanceTime(1);
+        if (i % 1000 == 0)
+            outputManager.setState({{{{true, 0}, {true, 255}, {true, 0}, {true, 255}}}}, 500);
+        else if (i % 1000 == 500)
+            outputManager.setState({{{{true, 255}, {true, 0}, {true, 255}, {true, 0}}}}, 500);
+        outputManager.handle(millis());
+    });
+    std::printf("%-52s %12" PRIu32 " PWM writes\n", "", ledcWrites());
+    NativeHal::useRealTime();
+}
+
+static void benchmarkWebSocket()
+{
+    auto* ws = static_cast<AsyncWebSocket*>(webSocketHandler.createAsyncWebHandler());
+    auto* client = ws->connect();
+    client->takeFrames();
+
+    WebSocket::ColorMessage message({});
+    Benchmark::run("WebSocket::Handler ColorMessage", 1000000, [&](const uint32_t i)
+    {
+        const auto v = static_cast<uint8_t>(i);
+        message.state = {{{{true, v}, {true, v}, {true, v}, {true, v}}}};
+        ws->receiveBinary(client, reinterpret_cast<const uint8_t*>(&message), sizeof(message));
+        if (i % 16 == 15)
+            outputManager.handle(millis());
+    });
+
+    struct
+    {
+        WebSocket::ColorDeltaMessage header{0, 1 << static_cast<uint8_t>(Color::Red)};
+        Light::State red;
+    } delta;
+    Benchmark::run("WebSocket::Handler ColorDeltaMessage (1 channel)", 1000000, [&](const uint32_t i)
+    {
+        delta.header.sequence = static_cast<uint16_t>(i + 1);
+        delta.red = {true, static_cast<uint8_t>(i)};
+        ws->receiveBinary(client, reinterpret_cast<const uint8_t*>(&delta), sizeof(delta));
+        if (i % 16 == 15)
+            outputManager.handle(millis());
+    });
+
+    NativeHal::setTime(0);
+    Benchmark::run("WebSocket::Handler::handle (1ms ticks)", 100000, [&](const uint32_t i)
+    {
+        NativeHal::advanceTime(1);
+        outputManager.setValue(static_cast<uint8_t>(i), Color::Green);
+        outputManager.handle(millis());
+        webSocketHandler.handle(millis());
+    });
+    std::printf("%-52s %12zu frames, %zu bytes\n", "", client->getFrameCount(), client->getBytesSent());
+
+    client->takeFrames();
+    EspNow::DeviceData devices;
+    Benchmark::run("WebSocket::Handler::handle 3 topics (1ms ticks)", 100000, [&](const uint32_t i)
+    {
+        NativeHal::advanceTime(1);
+        outputManager.setValue(static_cast<uint8_t>(i), Color::Blue);
+        outputManager.handle(millis());
+        deviceManager.setDeviceName(i % 2 ? "rgbw-ctrl-a" : "rgbw-ctrl-b");
+        devices.deviceCount = i % 2;
+        espNowHandler.setDeviceData(devices);
+        webSocketHandler.handle(millis());
+    });
+    std::printf("%-52s %12zu frames, %zu bytes\n", "", client->getFrameCount(), client->getBytesSent());
+
+    client->takeFrames();
+    auto* slowClient = ws->connect();
+    slowClient->setStalled(true);
+    slowClient->takeFrames();
+    Benchmark::run("WebSocket::Handler::handle w/ stalled client (1ms)", 100000, [&](const uint32_t i)
+    {
+        NativeHal::advanceTime(1);
+        outputManager.setValue(static_cast<uint8_t>(i), Color::Red);
+        outputManager.handle(millis());
+        if (i % 1000 == 0)
+            slowClient->drain();
+        webSocketHandler.handle(millis());
+    });
+    std::printf("%-52s %12zu frames, %zu bytes (stalled: %zu frames, %zu bytes)\n", "",
+                client->getFrameCount(), client->getBytesSent(),
+                slowClient->getFrameCount(), slowClient->getBytesSent());
+    ws->disconnect(slowClient);
+
+    client->takeFrames();
+    Benchmark::run("WebSocket::Handler::handle idle (1ms ticks)", 1000000, [&](const uint32_t)
+    {
+        NativeHal::advanceTime(1);
+        webSocketHandler.handle(millis());
+    });
+    std::printf("%-52s %12zu frames, %zu bytes\n", "", client->getFrameCount(), client->getBytesSent());
+    NativeHal::useRealTime();
+    ws->disconnect(client);
+}
+
+static void benchmarkStateRest()
+{
+    const std::unique_ptr<AsyncWebHandler> handler(stateRestHandler.createAsyncWebHandler());
+    size_t bytes = 0;
+    Benchmark::run("StateRestHandler GET /state", 10000, [&](const uint32_t)
+    {
+        AsyncWebServerRequest request(HTTP_GET, HTTP::Endpoints::STATE);
+        handler->handleRequest(&request);
+        bytes = request.getResponse()->body().length();
+    });
+    std::printf("%-52s %12zu bytes\n", "", bytes);
+
+    Benchmark::run("StateRestHandler GET /state?fields=output", 10000, [&](const uint32_t)
+    {
+        AsyncWebServerRequest request(HTTP_GET, HTTP::Endpoints::STATE);
+        request.addParam("fields", "output");
+        handler->handleRequest(&request);
+        bytes = request.getResponse()->body().length();
+    });
+    std::printf("%-52s %12zu bytes\n", "", bytes);
+
+    String etag;
+    {
+        AsyncWebServerRequest request(HTTP_GET, HTTP::Endpoints::STATE);
+        handler->handleRequest(&request);
+        for (const auto& [name, value] : request.getResponse()->getHeaders())
+            if (name == "ETag") etag = value;
+    }
+    int code = 0;
+    Benchmark::run("StateRestHandler GET /state If-None-Match", 10000, [&](const uint32_t)
+    {
+        AsyncWebServerRequest request(HTTP_GET, HTTP::Endpoints::STATE);
+        request.addHeader("If-None-Match", etag.c_str());
+        handler->handleRequest(&request);
+        code = request.getResponse()->getCode();
+    });
+    std::printf("%-52s %12d status\n", "", code);
+
+    const StateFields output("output");
+    Benchmark::run("StateRestHandler GET /state?wait= (output change)", 10000, [&](const uint32_t i)
+    {
+        AsyncWebServerRequest request(HTTP_GET, HTTP::Endpoints::STATE);
+        request.addParam("fields", "output");
+        request.addParam("wait", String(static_cast<unsigned long>(stateRestHandler.getVersion(output))).c_str());
+        handler->handleRequest(&request);
+        outputManager.setValue(static_cast<uint8_t>(i), Color::White);
+        outputManager.handle(millis());
+        stateRestHandler.handle(millis());
+        bytes = request.getResponse()->body().length();
+    });
+    std::printf("%-52s %12zu bytes\n", "", bytes);
+}
+
+static void benchmarkStateEvents()
+{
+    auto* events = static_cast<AsyncEventSource*>(stateEventsHandler.createAsyncWebHandler());
+    auto* client = events->connect();
+    std::printf("%-52s %12zu events, %zu bytes on connect\n", "", client->getEventCount(), client->getBytesSent());
+    client->takeEvents();
+
+    NativeHal::setTime(0);
+    Benchmark::run("StateEventsHandler::handle (1ms ticks)", 100000, [&](const uint32_t i)
+    {
+        NativeHal::advanceTime(1);
+        outputManager.setValue(static_cast<uint8_t>(i), Color::Green);
+        outputManager.handle(millis());
+        stateEventsHandler.handle(millis());
+    });
+    std::printf("%-52s %12zu events, %zu bytes\n", "", client->getEventCount(), client->getBytesSent());
+
+    client->takeEvents();
+    Benchmark::run("StateEventsHandler::handle idle (1ms ticks)", 1000000, [&](const uint32_t)
+    {
+        NativeHal::advanceTime(1);
+        stateEventsHandler.handle(millis());
+    });
+    std::printf("%-52s %12zu events, %zu bytes\n", "", client->getEventCount(), client->getBytesSent());
+    NativeHal::useRealTime();
+    events->disconnect(client);
+}
+
+static void benchmarkRealtime()
+{
+    std::array<uint8_t, Realtime::DDP::HEADER_SIZE + 4> ddp = {
+        Realtime::DDP::VERSION_1 | Realtime::DDP::FLAG_PUSH, 0, 0x1B, Realtime::DDP::DEFAULT_OUTPUT,
+        0, 0, 0, 0, 0, 4
+    };
+    NativeHal::setTime(0);
+    NativeHal::resetLedcCounters();
+    Benchmark::run("Realtime::Receiver DDP frame to PWM (1ms ticks)", 100000, [&](const uint32_t i)
+    {
+        NativeHal::advanceTime(1);
+        ddp[1] = static_cast<uint8_t>(i % 15 + 1);
+        ddp[Realtime::DDP::HEADER_SIZE] = static_cast<uint8_t>(i);
+        // Every 100th packet is lost on the way
+        if (i % 100 != 0)
+            realtimeReceiver.receiveDdp(ddp.data(), ddp.size());
+        realtimeReceiver.handle(millis());
+        outputManager.handle(millis());
+    });
+    auto stats = realtimeReceiver.getStats();
+    std::printf("%-52s %12" PRIu32 " frames, %" PRIu32 " fps, %" PRIu32 " dropped, %" PRIu32 " PWM writes\n", "",
+                stats.frames, stats.frameRate, stats.dropped, ledcWrites());
+
+    std::array<uint8_t, Realtime::E131::HEADER_SIZE + 4> e131 = {0x00, 0x10};
+    std::copy(Realtime::E131::PACKET_IDENTIFIER.begin(), Realtime::E131::PACKET_IDENTIFIER.end(),
+              e131.begin() + Realtime::E131::PACKET_IDENTIFIER_OFFSET);
+    e131[Realtime::E131::ROOT_VECTOR_OFFSET + 3] = Realtime::E131::VECTOR_ROOT_E131_DATA;
+    e131[Realtime::E131::FRAMING_VECTOR_OFFSET + 3] = Realtime::E131::VECTOR_E131_DATA_PACKET;
+    e131[Realtime::E131::UNIVERSE_OFFSET + 1] = Realtime::Receiver::DEFAULT_UNIVERSE;
+    e131[Realtime::E131::DMP_VECTOR_OFFSET] = Realtime::E131::VECTOR_DMP_SET_PROPERTY;
+    e131[Realtime::E131::PROPERTY_COUNT_OFFSET + 1] = 5;
+    Benchmark::run("Realtime::Receiver E1.31 packet (1ms ticks)", 100000, [&](const uint32_t i)
+    {
+        NativeHal::advanceTime(1);
+        e131[Realtime::E131::SEQUENCE_OFFSET] = static_cast<uint8_t>(i);
+        e131[Realtime::E131::START_CODE_OFFSET + 1] = static_cast<uint8_t>(i);
+        // Every 50th packet arrives twice
+        realtimeReceiver.receiveE131(e131.data(), e131.size());
+        if (i % 50 == 0)
+            realtimeReceiver.receiveE131(e131.data(), e131.size());
+        realtimeReceiver.handle(millis());
+    });
+    stats = realtimeReceiver.getStats();
+    std::printf("%-52s %12" PRIu32 " frames, %" PRIu32 " late, %" PRIu32 " invalid\n", "",
+                stats.frames, stats.late, stats.invalid);
+    NativeHal::useRealTime();
+}
+
+static void benchmarkAsyncCall()
+{
+    std::atomic<uint32_t> done = 0;
+    Benchmark::run("async_call round trip", 10000, [&](const uint32_t)
+    {
+        const auto target = done.load() + 1;
+        async_call([&done] { ++done; });
+        while (done.load() < target)
+            std::this_thread::yield();
+    });
+    auto stats = AsyncCall::getStats();
+    std::printf("%-52s %12" PRIu32 " us max latency, %u max pending\n", "", stats.maxLatencyUs, stats.maxPending);
+
+    Benchmark::run("async_call burst of 16, 20 ms delay", 20, [&](const uint32_t)
+    {
+        const auto target = done.load() + AsyncCall::MAX_PENDING;
+        for (uint8_t i = 0; i < AsyncCall::MAX_PENDING; ++i)
+            async_call([&done] { ++done; }, 20);
+        while (done.load() < target)
+            std::this_thread::yield();
+    });
+    stats = AsyncCall::getStats();
+    std::printf("%-52s %12" PRIu32 " us last latency, %" PRIu32 " rejected\n", "", stats.lastLatencyUs,
+                stats.rejected);
+}
+
+static void benchmarkCallbacks()
+{
+    uint32_t count = 0;
+    auto increment = [&count](const uint32_t step) { count += step; };
+
+    std::function<void(uint32_t)> function = increment;
+    Benchmark::run("std::function invoke", 10000000, [&](const uint32_t i)
+    {
+        function(i);
+        Benchmark::doNotOptimize(count);
+    });
+    InplaceFunction<void(uint32_t)> inplace = increment;
+    Benchmark::run("InplaceFunction invoke", 10000000, [&](const uint32_t i)
+    {
+        inplace(i);
+        Benchmark::doNotOptimize(count);
+    });
+
+    // Too large for std::function's local buffer, so that one allocates
+    const Output::State state;
+    Benchmark::run("std::function construct + invoke, 24 byte capture", 1000000, [&](const uint32_t i)
+    {
+        const std::function<void()> callback = [&count, state, i] { count += state.values[0].value + i; };
+        callback();
+        Benchmark::doNotOptimize(count);
+    });
+    Benchmark::run("InplaceFunction construct + invoke, 24 byte capture", 1000000, [&](const uint32_t i)
+    {
+        const AsyncCall::Callback callback = [&count, state, i] { count += state.values[0].value + i; };
+        callback();
+        Benchmark::doNotOptimize(count);
+    });
+}
+
+static void benchmarkEventLoop()
+{
+    EventLoop::begin(false);
+
+    const auto collect = [](const unsigned long now)
+    {
+        EventLoop::Deadline next(now);
+        bleManager.schedule(next);
+        deviceManager.schedule(next);
+        realtimeReceiver.schedule(next);
+        outputManager.schedule(next);
+        webSocketHandler.schedule(next);
+        stateRestHandler.schedule(next);
+        stateEventsHandler.schedule(next);
+        alexaIntegration.schedule(next);
+        return next.getRemaining();
+    };
+
+    // Idle: run the loop on simulated time until earlier benchmarks settled,
+    // then measure how far apart passes are with nothing changing
+    unsigned long now = 10000000;
+    unsigned long waited = 0;
+    constexpr uint32_t passes = 200;
+    for (uint32_t pass = 0; pass < passes * 2; ++pass)
+    {
+        NativeHal::setTime(now);
+        bleManager.handle(now);
+        deviceManager.handle(now);
+        realtimeReceiver.handle(now);
+        outputManager.handle(now);
+        webSocketHandler.handle(now);
+        stateRestHandler.handle(now);
+        stateEventsHandler.handle(now);
+        alexaIntegration.handle(now);
+        const auto wait = std::max<unsigned long>(collect(now), 1);
+        if (pass >= passes) waited += wait;
+        now += wait;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    std::printf("%-52s %12.1f ms between idle passes, 1 ms before\n", "EventLoop idle wait",
+                static_cast<double>(waited) / passes);
+
+    Benchmark::run("EventLoop deadline collection", 1000000, [&](const uint32_t i)
+    {
+        Benchmark::doNotOptimize(collect(now + i % 10));
+    });
+    NativeHal::useRealTime();
+
+    constexpr auto pin = ControllerHardware::Pin::Button::BUTTON1;
+    PushButton button(pin);
+    button.begin();
+    // Drop the wake-ups queued by the change bus so far
+    EventLoop::Deadline drain(millis());
+    drain.in(0);
+    EventLoop::wait(drain);
+
+    constexpr uint32_t presses = 200;
+    std::atomic<uint64_t> pressedAt = 0;
+    uint64_t totalLatencyUs = 0;
+    for (uint32_t i = 0; i < presses; ++i)
+    {
+        std::thread press([&pressedAt, i]
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            pressedAt = micros();
+            NativeHal::setDigitalInput(pin, i % 2 ? HIGH : LOW);
+        });
+        EventLoop::Deadline idle(millis());
+        EventLoop::wait(idle);
+        totalLatencyUs += micros() - pressedAt;
+        press.join();
+    }
+    NativeHal::setDigitalInput(pin, HIGH);
+    std::printf("%-52s %12" PRIu32 " edges %10.1f us/wake\n", "EventLoop GPIO edge to loop wake-up", presses,
+                static_cast<double>(totalLatencyUs) / presses);
+}
+
+/**
+ * Runs the output task the way the controller does and measures from a
+ * button release, or a command queued by another task, to the PWM write
+ * that shows it.
+ */
+static void benchmarkOutputTask()
+{
+    constexpr auto pin = ControllerHardware::Pin::Button::BUTTON1;
+    static PushButton button(pin);
+    button.setShortPressCallback([] { outputManager.toggleAll(0); });
+    button.begin();
+    EventLoop::run(EventLoop::Task::Output, {"output", 4096, 5, 1}, [](const unsigned long now)
+    {
+        LOOP_PROFILE_SCOPE("outputLoop");
+        button.handle(now);
+        outputManager.handle(now);
+        EventLoop::Deadline next(now);
+        button.schedule(next);
+        outputManager.schedule(next);
+        return next;
+    });
+
+    const auto waitForDutyChange = [](const uint32_t before)
+    {
+        while (ledcDutySum() == before)
+            std::this_thread::yield();
+    };
+
+    constexpr uint32_t presses = 20;
+    uint64_t totalLatencyUs = 0;
+    uint32_t maxLatencyUs = 0;
+    for (uint32_t i = 0; i < presses; ++i)
+    {
+        NativeHal::setDigitalInput(pin, LOW);
+        delay(60);
+        const auto before = ledcDutySum();
+        const auto releasedAt = micros();
+        NativeHal::setDigitalInput(pin, HIGH);
+        waitForDutyChange(before);
+        const uint32_t latency = micros() - releasedAt;
+        totalLatencyUs += latency;
+        maxLatencyUs = std::max(maxLatencyUs, latency);
+        delay(60);
+    }
+    std::printf("%-52s %12" PRIu32 " presses %10.1f us avg, %" PRIu32 " us max\n",
+                "Output task button release to PWM", presses,
+                static_cast<double>(totalLatencyUs) / presses, maxLatencyUs);
+
+    constexpr uint32_t commands = 1000;
+    totalLatencyUs = 0;
+    maxLatencyUs = 0;
+    for (uint32_t i = 0; i < commands; ++i)
+    {
+        const auto before = ledcDutySum();
+        const auto queuedAt = micros();
+        outputManager.setAll(static_cast<uint8_t>(i % 2 ? 64 : 192), true, 0);
+        waitForDutyChange(before);
+        const uint32_t latency = micros() - queuedAt;
+        totalLatencyUs += latency;
+        maxLatencyUs = std::max(maxLatencyUs, latency);
+    }
+    const auto stats = outputManager.getCommandStats();
+    std::printf("%-52s %12" PRIu32 " commands %9.1f us avg, %" PRIu32 " us max (%" PRIu32 " dropped)\n",
+                "Output task command from another task to PWM", commands,
+                static_cast<double>(totalLatencyUs) / commands, maxLatencyUs, stats.dropped);
+    Benchmark::check(stats.dropped == 0, "Output commands posted one at a time are never dropped");
+
+    // Three more tasks post at once, each through a ring of its own
+    constexpr uint32_t postsPerTask = 100000;
+    const auto appliedBefore = stats.applied;
+    const auto droppedBefore = stats.dropped;
+    const auto start = std::chrono::steady_clock::now();
+    std::array<std::thread, 3> producers;
+    for (uint8_t t = 0; t < producers.size(); ++t)
+        producers[t] = std::thread([t]
+        {
+            for (uint32_t i = 0; i < postsPerTask; ++i)
+            {
+                outputManager.setValue(static_cast<uint8_t>(i), static_cast<Color>(t));
+                if (i % 8 == 7)
+                    std::this_thread::sleep_for(std::chrono::microseconds(20));
+            }
+        });
+    for (auto& producer : producers)
+        producer.join();
+    const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    delay(20);
+    const auto after = outputManager.getCommandStats();
+    std::printf("%-52s %12" PRIu32 " commands %9.1f ms, %" PRIu32 " applied, %" PRIu32 " dropped\n",
+                "Output task 3 producers posting at once", postsPerTask * 3, elapsedMs,
+                after.applied - appliedBefore, after.dropped - droppedBefore);
+    Benchmark::check(after.applied - appliedBefore + after.dropped - droppedBefore == postsPerTask * 3,
+                     "Output commands from 3 producers are all applied or counted as dropped");
+    std::array<Output::Manager::ProducerStats, Output::Manager::MAX_PRODUCERS> producerStats;
+    const auto count = outputManager.getProducerStats(producerStats);
+    for (uint8_t i = 0; i < count; ++i)
+        std::printf("%-52s %12" PRIu32 " high water, %" PRIu32 " dropped\n", producerStats[i].task,
+                    producerStats[i].highWater, producerStats[i].dropped);
+}
+
+static void benchmarkLoopProfiler()
+{
+#if LOOP_PROFILER
+    LoopProfiler::Histogram histogram;
+    Benchmark::run("LoopProfiler::Histogram::record", 10000000, [&](const uint32_t i)
+    {
+        histogram.record(i * 2654435761u >> 12);
+    });
+    Benchmark::doNotOptimize(histogram.percentile(99));
+
+    Benchmark::run("LOOP_PROFILE around an empty statement", 10000000, [&](const uint32_t i)
+    {
+        LOOP_PROFILE("empty", Benchmark::doNotOptimize(i));
+    });
+
+    Benchmark::run("WebSocket::LoopProfileMessage", 100000, [&](const uint32_t)
+    {
+        const WebSocket::LoopProfileMessage message;
+        Benchmark::doNotOptimize(message.length());
+    });
+
+    std::array<LoopProfiler::SectionStats, LoopProfiler::MAX_SECTIONS> stats;
+    const auto count = LoopProfiler::Registry::get().snapshot(stats);
+    for (uint8_t i = 0; i < count; ++i)
+        std::printf("%-52s %12" PRIu32 " samples  min %" PRIu32 " avg %" PRIu32 " p99 %" PRIu32 " max %" PRIu32 " us\n",
+                    stats[i].name.data(), stats[i].count, stats[i].minUs, stats[i].avgUs, stats[i].p99Us,
+                    stats[i].maxUs);
+#endif
+}
+
+static void benchmarkSeqLock()
+{
+    SeqLock<Output::State> snapshot;
+    Benchmark::run("SeqLock<Output::State>::load", 10000000, [&](const uint32_t)
+    {
+        Benchmark::doNotOptimize(snapshot.load());
+    });
+
+    // One writer keeps publishing states whose four channels agree; a read
+    // mixing two of them would be torn
+    std::atomic<bool> stop = false;
+    std::thread writer([&]
+    {
+        for (uint8_t v = 0; !stop.load(std::memory_order_relaxed); ++v)
+            snapshot.store({{{{true, v}, {true, v}, {true, v}, {true, v}}}});
+    });
+    uint32_t torn = 0;
+    Benchmark::run("SeqLock<Output::State>::load while written", 1000000, [&](const uint32_t)
+    {
+        const auto state = snapshot.load();
+        if (state.values[0] != state.values[3]) ++torn;
+    });
+    stop = true;
+    writer.join();
+    std::printf("%-52s %12" PRIu32 " torn reads\n", "", torn);
+    Benchmark::check(torn == 0, "SeqLock<Output::State> never returns a torn read");
+}
+
+static void benchmarkThrottledValue()
+{
+    ThrottledValue<Output::State> throttle(200);
+    Output::State state;
+
+    Benchmark::run("ThrottledValue<Output::State>::shouldSend", 10000000, [&](const uint32_t i)
+    {
+        state.values[i % 4].value = static_cast<uint8_t>(i);
+        const auto send = throttle.shouldSend(i, state);
+        if (send)
+            throttle.setLastSent(i, state);
+        Benchmark::doNotOptimize(send);
+    });
+}
+
+static void benchmarkMovingAverage()
+{
+    MovingAverage<uint32_t, 32> average(0);
+
+    Benchmark::run("MovingAverage<uint32_t, 32> add + read", 10000000, [&](const uint32_t i)
+    {
+        average += i;
+        Benchmark::doNotOptimize(static_cast<uint32_t>(average));
+    });
+}
+
+static void benchmarkEspNowAllowlist()
+{
+    EspNow::DeviceData data;
+    data.deviceCount = EspNow::DeviceData::MAX_DEVICES;
+    for (uint8_t i = 0; i < data.deviceCount; ++i)
+        data.devices[i] = {{"remote"}, {0x24, 0x0A, 0xC4, 0x00, 0x00, i}};
+    espNowHandler.setDeviceData(data);
+
+    // Half of the lookups miss, as frames from remotes nearby but not paired do
+    Benchmark::run("EspNow::ControllerHandler::isMacAllowed (32 devices)", 10000000, [](const uint32_t i)
+    {
+        const uint8_t mac[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, static_cast<uint8_t>(i % 64)};
+        Benchmark::doNotOptimize(espNowHandler.isMacAllowed(mac));
+    });
+
+    // Another task rewriting the list while lookups run: the table never shows half of it
+    std::atomic<bool> stop = false;
+    std::thread writer([&]
+    {
+        auto reversed = data;
+        std::reverse(reversed.devices.begin(), reversed.devices.begin() + reversed.deviceCount);
+        for (uint32_t n = 0; !stop.load(std::memory_order_relaxed); ++n)
+            espNowHandler.setDeviceData(n % 2 ? data : reversed);
+    });
+    uint32_t misses = 0;
+    for (uint32_t i = 0; i < 1000000; ++i)
+    {
+        const uint8_t mac[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, static_cast<uint8_t>(i % 32)};
+        misses += !espNowHandler.isMacAllowed(mac);
+    }
+    stop = true;
+    writer.join();
+    espNowHandler.setDeviceData(data);
+    std::printf("%-52s %12u lookups, %" PRIu32 " wrongly missed\n", "EspNow allowlist while the list changes",
+                1000000, misses);
+    Benchmark::check(misses == 0, "EspNow allowlist never misses a paired remote while the list changes");
+}
+
+namespace EspNowPeers
+{
+    uint32_t acks = 0;
+
+    void countAck(const uint8_t*, const uint8_t* data, const size_t len)
+    {
+        EspNow::AckFrame ack;
+        if (len != sizeof(ack)) return;
+        std::memcpy(&ack, data, sizeof(ack));
+        acks += ack.header.kind == EspNow::FrameHeader::Kind::Ack;
+    }
+}
+
+/**
+ * More remotes than ESP-NOW takes peers, each acked twice through the
+ * receive callback: the controller recycles peers and keeps hearing all.
+ */
+static void checkEspNowPeers()
+{
+    esp_now_init();
+    esp_now_register_recv_cb([](const uint8_t* mac, const uint8_t* data, const int len)
+    {
+        espNowHandler.onDataReceived(mac, data, len);
+    });
+    NativeHal::setEspNowSendHook(EspNowPeers::countAck);
+    EspNowPeers::acks = 0;
+
+    const auto before = espNowHandler.getDeliveryStats();
+    const auto remotes = espNowHandler.getDeviceData();
+    static_assert(EspNow::DeviceData::MAX_DEVICES > ESP_NOW_MAX_TOTAL_PEER_NUM);
+    for (uint16_t round = 1; round <= 2; ++round)
+    {
+        for (uint8_t i = 0; i < remotes.deviceCount; ++i)
+        {
+            EspNow::CommandFrame frame = {{}, {EspNow::Message::Type::ToggleAll}};
+            frame.header.remoteId = 0xBEEF0000 + i;
+            frame.header.sequence = round;
+            NativeHal::injectEspNowFrame(remotes.devices[i].address.data(), reinterpret_cast<const uint8_t*>(&frame),
+                                         sizeof(frame));
+            espNowHandler.handle(millis());
+        }
+    }
+    const auto stats = espNowHandler.getDeliveryStats();
+    std::printf("%-52s %12u remotes: %" PRIu32 " acks, %" PRIu32 " ack failures\n",
+                "EspNow acks past the peer limit", remotes.deviceCount, EspNowPeers::acks,
+                stats.ackFailures - before.ackFailures);
+    Benchmark::check(EspNowPeers::acks == 2u * remotes.deviceCount && stats.ackFailures == before.ackFailures,
+                     "EspNow keeps receiving and acking with more remotes than peers");
+
+    esp_now_register_recv_cb(nullptr);
+    NativeHal::setEspNowSendHook(nullptr);
+}
+
+/**
+ * Loops ESP-NOW frames between the remote and the controller handler in
+ * this process, losing one in lossInterval frames at random in either
+ * direction.
+ */
+namespace EspNowLink
+{
+    constexpr std::array<uint8_t, 6> CONTROLLER = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01};
+    constexpr std::array<uint8_t, 6> REMOTE = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x02};
+
+    uint32_t lossInterval = 0;
+    uint32_t applied = 0;
+
+    void route(const uint8_t* mac, const uint8_t* data, const size_t len)
+    {
+        if (lossInterval != 0 && random(0, static_cast<long>(lossInterval)) == 0) return;
+        if (std::equal(CONTROLLER.begin(), CONTROLLER.end(), mac))
+        {
+            if (espNowHandler.receive(REMOTE.data(), data, len))
+                ++applied;
+        }
+        else
+        {
+            remoteEspNowHandler.onDataReceived(CONTROLLER.data(), data, static_cast<int>(len));
+        }
+    }
+}
+
+static void benchmarkEspNowDelivery()
+{
+    esp_now_init();
+    NativeHal::setEspNowSendHook(EspNowLink::route);
+    remoteEspNowHandler.begin();
+    remoteEspNowHandler.setControllerAddress(EspNowLink::CONTROLLER);
+
+    {
+        const auto before = remoteEspNowHandler.getDeliveryStats();
+        EspNowLink::applied = 0;
+        Benchmark::run("EspNow command to controller and ack back", 100000, [](const uint32_t)
+        {
+            remoteEspNowHandler.send(EspNow::Message::Type::ToggleAll);
+        });
+        const auto stats = remoteEspNowHandler.getDeliveryStats();
+        Benchmark::check(stats.sent - before.sent == EspNowLink::applied
+                         && stats.delivered - before.delivered == EspNowLink::applied,
+                         "EspNow commands on a lossless link are each applied and acked once");
+    }
+
+    // Lossy link on simulated time: the remote's loop retries what was not acked
+    const auto run = [](const uint32_t lossInterval)
+    {
+        const auto before = remoteEspNowHandler.getDeliveryStats();
+        const auto controllerBefore = espNowHandler.getDeliveryStats();
+        EspNowLink::lossInterval = lossInterval;
+        EspNowLink::applied = 0;
+        constexpr uint32_t commands = 10000;
+        NativeHal::setTime(0);
+        for (uint32_t i = 0; i < commands; ++i)
+        {
+            remoteEspNowHandler.send(EspNow::Message::Type::ToggleAll);
+            for (;;)
+            {
+                const auto stats = remoteEspNowHandler.getDeliveryStats();
+                if (stats.delivered + stats.failed == stats.sent) break;
+                NativeHal::advanceTime(1);
+                remoteEspNowHandler.handle(millis());
+            }
+        }
+        NativeHal::useRealTime();
+        const auto stats = remoteEspNowHandler.getDeliveryStats();
+        const auto controller = espNowHandler.getDeliveryStats();
+        char label[64];
+        std::snprintf(label, sizeof(label), "EspNow delivery, 1 in %" PRIu32 " frames lost", lossInterval);
+        std::printf("%-52s %12" PRIu32 " commands: %" PRIu32 " applied, %" PRIu32 " retries, %" PRIu32
+                    " failed, %" PRIu32 " duplicates, %" PRIu32 " us max\n", label, commands,
+                    EspNowLink::applied, stats.retries - before.retries, stats.failed - before.failed,
+                    controller.duplicates - controllerBefore.duplicates, stats.maxLatencyUs);
+        // A command given up on may still have been applied, only its acks were lost
+        Benchmark::check(EspNowLink::applied <= commands
+                         && EspNowLink::applied >= commands - (stats.failed - before.failed),
+                         "EspNow commands on a lossy link are applied once unless given up on");
+    };
+    run(10);
+    run(3);
+
+    // A fast knob spin, one detent every 2 ms, summed into StepBrightness commands
+    {
+        const auto before = remoteEspNowHandler.getDeliveryStats();
+        EspNowLink::lossInterval = 0;
+        EspNowLink::applied = 0;
+        constexpr uint32_t detents = 1000;
+        NativeHal::setTime(0);
+        for (uint32_t i = 0; i < detents; ++i)
+        {
+            remoteEspNowHandler.stepBrightness(i % 100 < 50 ? 1 : -1);
+            NativeHal::advanceTime(2);
+            remoteEspNowHandler.handle(millis());
+        }
+        NativeHal::advanceTime(EspNow::RemoteHandler::STEP_WINDOW_MS);
+        remoteEspNowHandler.handle(millis());
+        NativeHal::useRealTime();
+        const auto stats = remoteEspNowHandler.getDeliveryStats();
+        std::printf("%-52s %12" PRIu32 " detents: %" PRIu32 " commands, %" PRIu32 " applied\n",
+                    "EspNow knob spin, 2 ms per detent", stats.steps - before.steps,
+                    stats.sent - before.sent, EspNowLink::applied);
+        Benchmark::check(EspNowLink::applied == stats.sent - before.sent, "EspNow knob steps are all applied");
+    }
+
+    // The controller's receive path: the Wi-Fi task only queues, the output task drains
+    {
+        static EspNow::CommandFrame frame = {{}, {EspNow::Message::Type::ToggleAll}};
+        frame.header.remoteId = 0xC0FFEE;
+        const auto receive = []
+        {
+            ++frame.header.sequence;
+            espNowHandler.onDataReceived(EspNowLink::REMOTE.data(), reinterpret_cast<const uint8_t*>(&frame),
+                                         sizeof(frame));
+        };
+        Benchmark::run("EspNow receive queued, handled every 16", 1000000, [&](const uint32_t i)
+        {
+            receive();
+            if (i % 16 == 15)
+                espNowHandler.handle(millis());
+        });
+
+        const auto before = espNowHandler.getDeliveryStats();
+        for (uint32_t i = 0; i < 64; ++i)
+            receive();
+        espNowHandler.handle(millis());
+        const auto stats = espNowHandler.getDeliveryStats();
+        std::printf("%-52s %12u frames: %" PRIu32 " queued at most, %" PRIu32 " dropped, %" PRIu32 " applied\n",
+                    "EspNow receive burst before the output task runs", 64, stats.queueHighWater,
+                    stats.queueDropped - before.queueDropped, stats.received - before.received);
+        Benchmark::check(stats.queueDropped - before.queueDropped + stats.received - before.received == 64,
+                         "EspNow frames in a burst are all applied or counted as dropped");
+    }
+    NativeHal::setEspNowSendHook(nullptr);
+}
+
+/**
+ * A dozen controllers subscribed to one group, each missing one in
+ * lossInterval broadcasts on its own. Times are in simulated milliseconds.
+ */
+namespace EspNowGroup
+{
+    constexpr uint8_t GROUP = 3;
+    constexpr uint32_t NONE = UINT32_MAX;
+
+    std::array<EspNow::ControllerHandler, 12> controllers;
+    std::array<uint32_t, 12> receivedUs;
+    std::array<uint32_t, 12> appliedUs;
+    uint32_t lossInterval = 0;
+
+    void route(const uint8_t* mac, const uint8_t* data, const size_t len)
+    {
+        if (!std::equal(EspNow::BROADCAST_ADDRESS.begin(), EspNow::BROADCAST_ADDRESS.end(), mac)) return;
+        for (size_t i = 0; i < controllers.size(); ++i)
+        {
+            if (lossInterval != 0 && random(0, static_cast<long>(lossInterval)) == 0) continue;
+            if (receivedUs[i] == NONE)
+                receivedUs[i] = micros();
+            controllers[i].onDataReceived(EspNowLink::REMOTE.data(), data, static_cast<int>(len));
+        }
+    }
+
+    uint32_t spread(const std::array<uint32_t, 12>& times)
+    {
+        uint32_t first = NONE;
+        uint32_t last = 0;
+        for (const auto time : times)
+        {
+            if (time == NONE) continue;
+            first = std::min(first, time);
+            last = std::max(last, time);
+        }
+        return first == NONE ? 0 : last - first;
+    }
+}
+
+static void benchmarkEspNowGroup()
+{
+    using namespace EspNowGroup;
+
+    EspNow::DeviceData data;
+    data.deviceCount = 1;
+    data.devices[0] = {{"remote"}, EspNowLink::REMOTE};
+    for (size_t i = 0; i < controllers.size(); ++i)
+    {
+        controllers[i].setDeviceData(data);
+        controllers[i].setGroups(1u << (GROUP - 1));
+        controllers[i].onMessage([i](const EspNow::Message&) { appliedUs[i] = micros(); });
+    }
+    esp_now_init();
+    NativeHal::setEspNowSendHook(route);
+    remoteEspNowHandler.setGroup(GROUP);
+
+    // Lost copies make controllers hear a command up to two repeats apart; they still apply it together
+    const auto run = [](const uint32_t loss)
+    {
+        lossInterval = loss;
+        constexpr uint32_t commands = 1000;
+        uint32_t applied = 0;
+        uint32_t appliedSpread = 0;
+        uint32_t receivedSpread = 0;
+        NativeHal::setTime(0);
+        for (uint32_t n = 0; n < commands; ++n)
+        {
+            receivedUs.fill(NONE);
+            appliedUs.fill(NONE);
+            remoteEspNowHandler.send(EspNow::Message::Type::ToggleAll);
+            for (uint32_t ms = 0; ms < EspNow::RemoteHandler::GROUP_APPLY_DELAY_US / 1000 + 5; ++ms)
+            {
+                NativeHal::advanceTime(1);
+                remoteEspNowHandler.handle(millis());
+                for (auto& controller : controllers)
+                    controller.handle(millis());
+            }
+            applied += std::count_if(appliedUs.begin(), appliedUs.end(), [](const uint32_t t) { return t != NONE; });
+            appliedSpread = std::max(appliedSpread, spread(appliedUs));
+            receivedSpread = std::max(receivedSpread, spread(receivedUs));
+        }
+        NativeHal::useRealTime();
+        char label[64];
+        std::snprintf(label, sizeof(label), "EspNow group of 12, 1 in %" PRIu32 " frames lost", loss);
+        std::printf("%-52s %12" PRIu32 " commands: %" PRIu32 " of %" PRIu32 " applied, %" PRIu32
+                    " us apart at most, %" PRIu32 " us if applied on receipt\n", label, commands, applied,
+                    commands * static_cast<uint32_t>(controllers.size()), appliedSpread, receivedSpread);
+        Benchmark::check(applied <= commands * controllers.size() && appliedSpread == 0,
+                         "EspNow group members apply each command once and at the same time");
+    };
+    run(10);
+    run(3);
+
+    remoteEspNowHandler.setGroup(0);
+    NativeHal::setEspNowSendHook(nullptr);
+}
+
+int main()
+{
+    benchmarkGamma();
+    benchmarkLight();
+    benchmarkOutputManager();
+    benchmarkWebSocket();
+    benchmarkStateRest();
+    benchmarkStateEvents();
+    benchmarkRealtime();
+    benchmarkAsyncCall();
+    benchmarkCallbacks();
+    benchmarkEventLoop();
+    benchmarkOutputTask();
+    benchmarkLoopProfiler();
+    benchmarkSeqLock();
+    benchmarkThrottledValue();
+    benchmarkMovingAverage();
+    benchmarkEspNowAllowlist();
+    benchmarkEspNowDelivery();
+    benchmarkEspNowGroup();
+    // Last, as it leaves the peer table the remote handler shares on the host full
+    checkEspNowPeers();
+    if (Benchmark::failures != 0)
+    {
+        std::fprintf(stderr, "%" PRIu32 " checks failed\n", Benchmark::failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "esp32-hal.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#ifndef __unused
+#define __unused __attribute__((unused))
+#endif
+
+class String
+{
+    std::string value;
+
+public:
+    String() = default;
+    String(const char* value) : value(value ? value : "") {} // NOLINT
+    String(std::string value) : value(std::move(value)) {} // NOLINT
+    explicit String(const long number) : value(std::to_string(number)) {}
+    explicit String(const int number) : value(std::to_string(number)) {}
+    explicit String(const unsigned number) : value(std::to_string(number)) {}
+    explicit String(const unsigned long number) : value(std::to_string(number)) {}
+
+    [[nodiscard]] const char* c_str() const { return value.c_str(); }
+    [[nodiscard]] unsigned length() const { return value.length(); }
+    [[nodiscard]] bool isEmpty() const { return value.empty(); }
+    [[nodiscard]] long toInt() const { return std::strtol(value.c_str(), nullptr, 10); }
+
+    [[nodiscard]] String substring(const unsigned from, const unsigned to) const
+    {
+        return value.substr(from, to - from);
+    }
+
+    String& operator+=(const String& other)
+    {
+        value += other.value;
+        return *this;
+    }
+
+    friend String operator+(String lhs, const String& rhs) { return lhs += rhs; }
+    friend String operator+(String lhs, const char* rhs) { return lhs += String(rhs); }
+
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator!=(const String& other) const { return value != other.value; }
+    bool operator==(const char* other) const { return value == (other ? other : ""); }
+    bool operator!=(const char* other) const { return !(*this == other); }
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+#include <ArduinoJson.h>
+
+#include "ESPAsyncWebServer.h"
+
+class AsyncJsonResponse final : public AsyncWebServerResponse
+{
+    JsonDocument document;
+    JsonVariant root;
+
+public:
+    explicit AsyncJsonResponse(const bool isArray = false)
+        : AsyncWebServerResponse(200, "application/json"), root(document.to<JsonVariant>())
+    {
+        if (isArray)
+            root.to<JsonArray>();
+        else
+            root.to<JsonObject>();
+    }
+
+    JsonVariant& getRoot() { return root; }
+
+    size_t setLength() { return measureJson(root); }
+
+    String body() override
+    {
+        std::string json;
+        serializeJson(root, json);
+        return json;
+    }
+};
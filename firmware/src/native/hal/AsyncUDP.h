@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "WiFi.h"
+
+class AsyncUDPPacket
+{
+    uint8_t* packetData;
+    size_t packetLength;
+
+public:
+    AsyncUDPPacket(uint8_t* data, const size_t length) : packetData(data), packetLength(length)
+    {
+    }
+
+    [[nodiscard]] uint8_t* data() const { return packetData; }
+    [[nodiscard]] size_t length() const { return packetLength; }
+};
+
+using AuPacketHandlerFunction = std::function<void(AsyncUDPPacket& packet)>;
+
+class AsyncUDP
+{
+    AuPacketHandlerFunction handler;
+    uint16_t boundPort = 0;
+
+public:
+    void onPacket(AuPacketHandlerFunction callback) { handler = std::move(callback); }
+
+    bool listen(const uint16_t port)
+    {
+        boundPort = port;
+        return true;
+    }
+
+    bool listenMulticast(const IPAddress&, const uint16_t port, uint8_t = 1) // NOLINT
+    {
+        boundPort = port;
+        return true;
+    }
+
+    void close() { boundPort = 0; }
+
+    [[nodiscard]] bool connected() const { return boundPort != 0; }
+};
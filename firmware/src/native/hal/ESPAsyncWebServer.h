@@ -0,0 +1,581 @@
+#pragma once
+
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Arduino.h"
+#include "LittleFS.h"
+#include "WiFi.h"
+
+typedef enum
+{
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+
+typedef enum
+{
+    AUTH_NONE = 0,
+    AUTH_BASIC,
+    AUTH_DIGEST,
+    AUTH_BEARER,
+    AUTH_OTHER,
+    AUTH_DENIED
+} AsyncAuthType;
+
+class AsyncWebServerRequest;
+using AsyncWebServerRequestPtr = std::weak_ptr<AsyncWebServerRequest>;
+
+class AsyncWebParameter
+{
+    String parameterName;
+    String parameterValue;
+
+public:
+    AsyncWebParameter(String name, String value)
+        : parameterName(std::move(name)), parameterValue(std::move(value))
+    {
+    }
+
+    [[nodiscard]] const String& name() const { return parameterName; }
+    [[nodiscard]] const String& value() const { return parameterValue; }
+};
+
+class AsyncWebServerResponse
+{
+protected:
+    int code;
+    String contentType;
+    String content;
+    std::vector<std::pair<String, String>> headers;
+
+public:
+    explicit AsyncWebServerResponse(const int code = 200, String contentType = "", String content = "")
+        : code(code), contentType(std::move(contentType)), content(std::move(content))
+    {
+    }
+
+    virtual ~AsyncWebServerResponse() = default;
+
+    void setCode(const int code) { this->code = code; }
+    void setContentType(const char* type) { contentType = type; }
+
+    bool addHeader(const char* name, const char* value, bool = true)
+    {
+        headers.emplace_back(name, value);
+        return true;
+    }
+
+    [[nodiscard]] int getCode() const { return code; }
+    [[nodiscard]] const String& getContentType() const { return contentType; }
+    [[nodiscard]] const std::vector<std::pair<String, String>>& getHeaders() const { return headers; }
+
+    /**
+     * Renders the full response body, as the TCP stack would see it.
+     */
+    [[nodiscard]] virtual String body() { return content; }
+};
+
+using AwsResponseFiller = std::function<size_t(uint8_t* buffer, size_t maxLen, size_t index)>;
+
+class AsyncChunkedResponse final : public AsyncWebServerResponse
+{
+    AwsResponseFiller filler;
+
+public:
+    /** Roughly the space AsyncTCP offers per call */
+    static constexpr size_t CHUNK_SIZE = 1436;
+
+    AsyncChunkedResponse(String contentType, AwsResponseFiller filler)
+        : AsyncWebServerResponse(200, std::move(contentType)), filler(std::move(filler))
+    {
+    }
+
+    String body() override
+    {
+        std::string result;
+        uint8_t buffer[CHUNK_SIZE];
+        while (const auto len = filler(buffer, sizeof(buffer), result.size()))
+            result.append(reinterpret_cast<const char*>(buffer), len);
+        return result;
+    }
+};
+
+class AsyncMiddleware
+{
+public:
+    virtual ~AsyncMiddleware() = default;
+};
+
+class AsyncAuthenticationMiddleware : public AsyncMiddleware
+{
+    String username;
+    String password;
+
+public:
+    void setUsername(const char* value) { username = value; }
+    void setPassword(const char* value) { password = value; }
+    void setRealm(const char*) {} // NOLINT
+    void setAuthFailureMessage(const char*) {} // NOLINT
+    void setAuthType(AsyncAuthType) {} // NOLINT
+    bool generateHash() { return true; } // NOLINT
+    bool allowed(AsyncWebServerRequest*) const { return true; } // NOLINT
+};
+
+class AsyncWebServerRequest
+{
+    WebRequestMethod requestMethod;
+    String requestUrl;
+    std::vector<AsyncWebParameter> params;
+    std::map<std::string, String> requestHeaders;
+    std::map<std::string, bool> attributes;
+    std::vector<std::function<void()>> disconnectCallbacks;
+    std::unique_ptr<AsyncWebServerResponse> response;
+    /** Non-owning handle given out by pause(); expires with the request */
+    std::shared_ptr<AsyncWebServerRequest> self;
+
+public:
+    AsyncWebServerRequest(const WebRequestMethod method, String url)
+        : requestMethod(method), requestUrl(std::move(url))
+    {
+    }
+
+    ~AsyncWebServerRequest()
+    {
+        self.reset();
+        for (const auto& callback : disconnectCallbacks)
+            callback();
+    }
+
+    AsyncWebServerRequest& addParam(const char* name, const char* value)
+    {
+        params.emplace_back(name, value);
+        return *this;
+    }
+
+    AsyncWebServerRequest& addHeader(const char* name, const char* value)
+    {
+        requestHeaders[name] = value;
+        return *this;
+    }
+
+    [[nodiscard]] WebRequestMethod method() const { return requestMethod; }
+    [[nodiscard]] const String& url() const { return requestUrl; }
+
+    [[nodiscard]] bool hasParam(const char* name, bool = false, bool = false) const
+    {
+        return getParam(name) != nullptr;
+    }
+
+    [[nodiscard]] const AsyncWebParameter* getParam(const char* name, bool = false, bool = false) const
+    {
+        for (const auto& param : params)
+            if (param.name() == name) return &param;
+        return nullptr;
+    }
+
+    [[nodiscard]] bool hasHeader(const char* name) const { return requestHeaders.count(name) != 0; }
+
+    [[nodiscard]] String header(const char* name) const
+    {
+        const auto it = requestHeaders.find(name);
+        return it == requestHeaders.end() ? String() : it->second;
+    }
+
+    void setAttribute(const char* name, const bool value) { attributes[name] = value; }
+    [[nodiscard]] bool hasAttribute(const char* name) const { return attributes.count(name) != 0; }
+
+    void onDisconnect(std::function<void()> callback) { disconnectCallbacks.push_back(std::move(callback)); }
+
+    void send(AsyncWebServerResponse* response) { this->response.reset(response); }
+
+    /**
+     * Keeps the request open without a response; it can be sent later from
+     * another task through the returned handle, as long as it is alive.
+     */
+    AsyncWebServerRequestPtr pause()
+    {
+        if (!self) self = std::shared_ptr<AsyncWebServerRequest>(this, [](AsyncWebServerRequest*) {});
+        return self;
+    }
+
+    [[nodiscard]] bool isPaused() const { return self != nullptr && response == nullptr; }
+
+    void send(const int code, const char* contentType = "", const String& content = "")
+    {
+        send(new AsyncWebServerResponse(code, contentType, content));
+    }
+
+    AsyncWebServerResponse* beginResponse(const int code, const char* contentType = "", const String& content = "")
+    {
+        return new AsyncWebServerResponse(code, contentType, content);
+    }
+
+    AsyncWebServerResponse* beginChunkedResponse(const char* contentType, AwsResponseFiller callback)
+    {
+        return new AsyncChunkedResponse(contentType, std::move(callback));
+    }
+
+    void redirect(const char* url)
+    {
+        auto* redirect = new AsyncWebServerResponse(302);
+        redirect->addHeader("Location", url);
+        send(redirect);
+    }
+
+    void requestAuthentication(AsyncAuthType, const char*, const char* message)
+    {
+        send(401, "text/plain", message);
+    }
+
+    [[nodiscard]] AsyncWebServerResponse* getResponse() const { return response.get(); }
+};
+
+class AsyncWebHandler
+{
+    std::vector<AsyncMiddleware*> middlewares;
+
+public:
+    virtual ~AsyncWebHandler() = default;
+
+    virtual bool canHandle(AsyncWebServerRequest* request) const { return false; }
+    virtual void handleRequest(AsyncWebServerRequest* request) {}
+
+    virtual void handleUpload(AsyncWebServerRequest* request, const String& filename, size_t index,
+                              uint8_t* data, size_t len, bool final)
+    {
+    }
+
+    virtual void handleBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total)
+    {
+    }
+
+    void addMiddleware(AsyncMiddleware* middleware) { middlewares.push_back(middleware); }
+};
+
+class AsyncStaticWebHandler final : public AsyncWebHandler
+{
+public:
+    AsyncStaticWebHandler& setDefaultFile(const char*) { return *this; } // NOLINT
+    AsyncStaticWebHandler& setTryGzipFirst(bool) { return *this; } // NOLINT
+    AsyncStaticWebHandler& setCacheControl(const char*) { return *this; } // NOLINT
+};
+
+typedef enum
+{
+    WS_EVT_CONNECT,
+    WS_EVT_DISCONNECT,
+    WS_EVT_PING,
+    WS_EVT_PONG,
+    WS_EVT_ERROR,
+    WS_EVT_DATA
+} AwsEventType;
+
+typedef enum
+{
+    WS_CONTINUATION,
+    WS_TEXT,
+    WS_BINARY,
+    WS_DISCONNECT = 0x08,
+    WS_PING,
+    WS_PONG
+} AwsFrameType;
+
+typedef struct
+{
+    uint8_t message_opcode;
+    uint32_t num;
+    uint8_t final;
+    uint8_t masked;
+    uint8_t opcode;
+    uint64_t len;
+    uint8_t mask[4];
+    uint64_t index;
+} AwsFrameInfo;
+
+#ifndef WS_MAX_QUEUED_MESSAGES
+#define WS_MAX_QUEUED_MESSAGES 32
+#endif
+
+class AsyncWebSocketClient
+{
+    uint32_t clientId;
+    std::vector<std::vector<uint8_t>> frames;
+    size_t bytesSent = 0;
+    size_t queued = 0;
+    bool stalled = false;
+    bool closed = false;
+
+public:
+    explicit AsyncWebSocketClient(const uint32_t id) : clientId(id)
+    {
+    }
+
+    [[nodiscard]] uint32_t id() const { return clientId; }
+    [[nodiscard]] IPAddress remoteIP() const { return IPAddress(0x0100007F); }
+    [[nodiscard]] bool canSend() const { return queued < WS_MAX_QUEUED_MESSAGES; }
+    [[nodiscard]] size_t queueLen() const { return queued; }
+
+    bool binary(const uint8_t* data, const size_t len)
+    {
+        if (closed || !canSend()) return false;
+        frames.emplace_back(data, data + len);
+        bytesSent += len;
+        if (stalled) ++queued;
+        return true;
+    }
+
+    void close() { closed = true; }
+    [[nodiscard]] bool isClosed() const { return closed; }
+
+    /**
+     * Simulates a client on a bad link: frames stay queued until drain().
+     */
+    void setStalled(const bool value) { stalled = value; }
+    void drain() { queued = 0; }
+
+    bool text(const char* message)
+    {
+        return binary(reinterpret_cast<const uint8_t*>(message), std::strlen(message));
+    }
+
+    [[nodiscard]] size_t getBytesSent() const { return bytesSent; }
+    [[nodiscard]] size_t getFrameCount() const { return frames.size(); }
+
+    std::vector<std::vector<uint8_t>> takeFrames() { return std::exchange(frames, {}); }
+};
+
+class AsyncWebSocket;
+
+using AwsEventHandler = std::function<void(AsyncWebSocket*, AsyncWebSocketClient*, AwsEventType,
+                                           void*, uint8_t*, size_t)>;
+
+class AsyncWebSocket final : public AsyncWebHandler
+{
+    String socketUrl;
+    AwsEventHandler eventHandler;
+    std::list<AsyncWebSocketClient> clients;
+    uint32_t nextId = 1;
+
+public:
+    enum SendStatus
+    {
+        DISCARDED = 0,
+        ENQUEUED = 1,
+        PARTIALLY_ENQUEUED = 2,
+    };
+
+    explicit AsyncWebSocket(const char* url) : socketUrl(url)
+    {
+    }
+
+    void onEvent(AwsEventHandler handler) { eventHandler = std::move(handler); }
+
+    void cleanupClients(uint16_t = 8) {} // NOLINT
+
+    [[nodiscard]] size_t count() const { return clients.size(); }
+
+    SendStatus binaryAll(const uint8_t* data, const size_t len)
+    {
+        if (clients.empty()) return DISCARDED;
+        for (auto& client : clients)
+            client.binary(data, len);
+        return ENQUEUED;
+    }
+
+    SendStatus textAll(const char* message)
+    {
+        return binaryAll(reinterpret_cast<const uint8_t*>(message), std::strlen(message));
+    }
+
+    void _handleEvent(AsyncWebSocketClient* client, const AwsEventType type, void* arg, uint8_t* data,
+                      const size_t len)
+    {
+        if (eventHandler) eventHandler(this, client, type, arg, data, len);
+    }
+
+    /**
+     * Simulates a new client connecting, firing WS_EVT_CONNECT.
+     */
+    AsyncWebSocketClient* connect()
+    {
+        auto* client = &clients.emplace_back(nextId++);
+        _handleEvent(client, WS_EVT_CONNECT, nullptr, nullptr, 0);
+        return client;
+    }
+
+    void disconnect(AsyncWebSocketClient* client)
+    {
+        _handleEvent(client, WS_EVT_DISCONNECT, nullptr, nullptr, 0);
+        clients.remove_if([client](const AsyncWebSocketClient& c) { return &c == client; });
+    }
+
+    /**
+     * Simulates a single, unfragmented binary frame arriving from a client.
+     */
+    void receiveBinary(AsyncWebSocketClient* client, const uint8_t* data, const size_t len)
+    {
+        AwsFrameInfo info = {};
+        info.message_opcode = WS_BINARY;
+        info.opcode = WS_BINARY;
+        info.final = 1;
+        info.len = len;
+        _handleEvent(client, WS_EVT_DATA, &info, const_cast<uint8_t*>(data), len);
+    }
+};
+
+#ifndef SSE_MAX_QUEUED_MESSAGES
+#define SSE_MAX_QUEUED_MESSAGES 32
+#endif
+
+class AsyncEventSourceClient
+{
+    uint32_t lastEventId;
+    std::vector<std::string> events;
+    size_t bytesSent = 0;
+    size_t queued = 0;
+    bool stalled = false;
+
+public:
+    explicit AsyncEventSourceClient(const uint32_t lastEventId) : lastEventId(lastEventId)
+    {
+    }
+
+    [[nodiscard]] uint32_t lastId() const { return lastEventId; }
+    [[nodiscard]] size_t packetsWaiting() const { return queued; }
+
+    bool send(const char* message, const char* event = nullptr, const uint32_t id = 0, const uint32_t reconnect = 0)
+    {
+        if (queued >= SSE_MAX_QUEUED_MESSAGES) return false;
+        std::string text;
+        if (reconnect) text += "retry: " + std::to_string(reconnect) + "\n";
+        if (id) text += "id: " + std::to_string(id) + "\n";
+        if (event) text += std::string("event: ") + event + "\n";
+        text += std::string("data: ") + message + "\n\n";
+        bytesSent += text.size();
+        events.push_back(std::move(text));
+        if (id) lastEventId = id;
+        if (stalled) ++queued;
+        return true;
+    }
+
+    /**
+     * Simulates a client on a bad link: events stay queued until drain().
+     */
+    void setStalled(const bool value) { stalled = value; }
+    void drain() { queued = 0; }
+
+    [[nodiscard]] size_t getBytesSent() const { return bytesSent; }
+    [[nodiscard]] size_t getEventCount() const { return events.size(); }
+
+    std::vector<std::string> takeEvents() { return std::exchange(events, {}); }
+};
+
+using ArEventHandlerFunction = std::function<void(AsyncEventSourceClient*)>;
+
+class AsyncEventSource final : public AsyncWebHandler
+{
+    String sourceUrl;
+    ArEventHandlerFunction connectHandler;
+    std::list<AsyncEventSourceClient> clients;
+
+public:
+    enum SendStatus
+    {
+        DISCARDED = 0,
+        ENQUEUED = 1,
+        PARTIALLY_ENQUEUED = 2,
+    };
+
+    explicit AsyncEventSource(const char* url) : sourceUrl(url)
+    {
+    }
+
+    void onConnect(ArEventHandlerFunction handler) { connectHandler = std::move(handler); }
+
+    [[nodiscard]] size_t count() const { return clients.size(); }
+
+    [[nodiscard]] size_t avgPacketsWaiting() const
+    {
+        if (clients.empty()) return 0;
+        size_t total = 0;
+        for (const auto& client : clients)
+            total += client.packetsWaiting();
+        return (total + clients.size() - 1) / clients.size();
+    }
+
+    SendStatus send(const char* message, const char* event = nullptr, const uint32_t id = 0,
+                    const uint32_t reconnect = 0)
+    {
+        size_t enqueued = 0;
+        for (auto& client : clients)
+            enqueued += client.send(message, event, id, reconnect);
+        return enqueued == 0 ? DISCARDED : enqueued == clients.size() ? ENQUEUED : PARTIALLY_ENQUEUED;
+    }
+
+    /**
+     * Simulates a client connecting, optionally resuming with Last-Event-ID.
+     */
+    AsyncEventSourceClient* connect(const uint32_t lastEventId = 0)
+    {
+        auto* client = &clients.emplace_back(lastEventId);
+        if (connectHandler) connectHandler(client);
+        return client;
+    }
+
+    void disconnect(AsyncEventSourceClient* client)
+    {
+        clients.remove_if([client](const AsyncEventSourceClient& c) { return &c == client; });
+    }
+};
+
+class AsyncWebServer
+{
+    std::vector<AsyncWebHandler*> handlers;
+    std::list<AsyncStaticWebHandler> staticHandlers;
+
+public:
+    explicit AsyncWebServer(uint16_t)
+    {
+    }
+
+    AsyncWebHandler& addHandler(AsyncWebHandler* handler)
+    {
+        handlers.push_back(handler);
+        return *handler;
+    }
+
+    AsyncStaticWebHandler& serveStatic(const char*, fs::FS&, const char*, const char* = nullptr)
+    {
+        return staticHandlers.emplace_back();
+    }
+
+    void begin() {} // NOLINT
+
+    /**
+     * Dispatches a request to the first registered handler that accepts it.
+     */
+    bool handle(AsyncWebServerRequest* request) const
+    {
+        for (auto* handler : handlers)
+        {
+            if (handler->canHandle(request))
+            {
+                handler->handleRequest(request);
+                return true;
+            }
+        }
+        return false;
+    }
+};
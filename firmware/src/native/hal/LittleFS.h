@@ -0,0 +1,12 @@
+#pragma once
+
+namespace fs
+{
+    class FS
+    {
+    public:
+        bool begin(const bool formatOnFail = false) { return true; } // NOLINT
+    };
+}
+
+extern fs::FS LittleFS;
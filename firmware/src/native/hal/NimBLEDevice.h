@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+typedef enum
+{
+    READ = 0x0002,
+    WRITE_NR = 0x0004,
+    WRITE = 0x0008,
+    NOTIFY = 0x0010,
+    INDICATE = 0x0020
+} NIMBLE_PROPERTY;
+
+class NimBLEConnInfo
+{
+};
+
+class NimBLEAttValue
+{
+    std::vector<uint8_t> value;
+
+public:
+    NimBLEAttValue() = default;
+    NimBLEAttValue(const uint8_t* data, const size_t length) : value(data, data + length) {}
+
+    [[nodiscard]] const uint8_t* data() const { return value.data(); }
+    [[nodiscard]] size_t size() const { return value.size(); }
+    [[nodiscard]] size_t length() const { return value.size(); }
+    [[nodiscard]] auto begin() const { return value.begin(); }
+    [[nodiscard]] auto end() const { return value.end(); }
+
+    bool operator==(const char* other) const
+    {
+        return value.size() == std::strlen(other) && std::memcmp(value.data(), other, value.size()) == 0;
+    }
+};
+
+class NimBLECharacteristic;
+
+class NimBLECharacteristicCallbacks
+{
+public:
+    virtual ~NimBLECharacteristicCallbacks() = default;
+    virtual void onRead(NimBLECharacteristic* characteristic, NimBLEConnInfo& connInfo) {}
+    virtual void onWrite(NimBLECharacteristic* characteristic, NimBLEConnInfo& connInfo) {}
+};
+
+class NimBLECharacteristic
+{
+    std::string uuid;
+    uint16_t properties;
+    NimBLEAttValue value;
+    NimBLECharacteristicCallbacks* callbacks = nullptr;
+    uint32_t notifications = 0;
+
+public:
+    NimBLECharacteristic(const char* uuid, const uint16_t properties) : uuid(uuid), properties(properties)
+    {
+    }
+
+    void setCallbacks(NimBLECharacteristicCallbacks* callbacks) { this->callbacks = callbacks; }
+
+    void setValue(const uint8_t* data, const size_t length) { value = NimBLEAttValue(data, length); }
+
+    void setValue(const char* data)
+    {
+        setValue(reinterpret_cast<const uint8_t*>(data), std::strlen(data));
+    }
+
+    [[nodiscard]] NimBLEAttValue getValue() const { return value; }
+    [[nodiscard]] size_t getLength() const { return value.size(); }
+    [[nodiscard]] const std::string& getUUID() const { return uuid; }
+
+    bool notify()
+    {
+        ++notifications;
+        return (properties & NOTIFY) != 0;
+    }
+
+    [[nodiscard]] uint32_t getNotificationCount() const { return notifications; }
+
+    /**
+     * Simulates a central writing to this characteristic.
+     */
+    void receiveWrite(const uint8_t* data, const size_t length)
+    {
+        setValue(data, length);
+        NimBLEConnInfo connInfo;
+        if (callbacks) callbacks->onWrite(this, connInfo);
+    }
+
+    /**
+     * Simulates a central reading this characteristic.
+     */
+    NimBLEAttValue receiveRead()
+    {
+        NimBLEConnInfo connInfo;
+        if (callbacks) callbacks->onRead(this, connInfo);
+        return value;
+    }
+};
+
+class NimBLEService
+{
+    std::string uuid;
+    std::vector<std::unique_ptr<NimBLECharacteristic>> characteristics;
+
+public:
+    explicit NimBLEService(const char* uuid) : uuid(uuid)
+    {
+    }
+
+    NimBLECharacteristic* createCharacteristic(const char* uuid, const uint16_t properties)
+    {
+        characteristics.push_back(std::make_unique<NimBLECharacteristic>(uuid, properties));
+        return characteristics.back().get();
+    }
+
+    [[nodiscard]] NimBLECharacteristic* getCharacteristic(const char* uuid) const
+    {
+        for (const auto& characteristic : characteristics)
+            if (characteristic->getUUID() == uuid) return characteristic.get();
+        return nullptr;
+    }
+
+    [[nodiscard]] const std::string& getUUID() const { return uuid; }
+
+    bool start() { return true; } // NOLINT
+};
+
+class NimBLEServer;
+
+class NimBLEServerCallbacks
+{
+public:
+    virtual ~NimBLEServerCallbacks() = default;
+    virtual void onConnect(NimBLEServer* server, NimBLEConnInfo& connInfo) {}
+    virtual void onDisconnect(NimBLEServer* server, NimBLEConnInfo& connInfo, int reason) {}
+};
+
+class NimBLEAdvertisementData
+{
+public:
+    void setName(const std::string&) {} // NOLINT
+};
+
+class NimBLEAdvertising
+{
+public:
+    void setScanResponseData(const NimBLEAdvertisementData&) {} // NOLINT
+    void setManufacturerData(const uint8_t*, size_t) {} // NOLINT
+    bool start() { return true; } // NOLINT
+};
+
+class NimBLEServer
+{
+    std::vector<std::unique_ptr<NimBLEService>> services;
+    NimBLEServerCallbacks* callbacks = nullptr;
+    NimBLEAdvertising advertising;
+
+public:
+    NimBLEService* createService(const char* uuid)
+    {
+        services.push_back(std::make_unique<NimBLEService>(uuid));
+        return services.back().get();
+    }
+
+    [[nodiscard]] NimBLEService* getServiceByUUID(const char* uuid) const
+    {
+        for (const auto& service : services)
+            if (service->getUUID() == uuid) return service.get();
+        return nullptr;
+    }
+
+    void setCallbacks(NimBLEServerCallbacks* callbacks) { this->callbacks = callbacks; }
+    NimBLEAdvertising* getAdvertising() { return &advertising; }
+    bool startAdvertising() { return advertising.start(); }
+
+    [[nodiscard]] std::vector<uint16_t> getPeerDevices() const { return {}; }
+    [[nodiscard]] uint8_t getConnectedCount() const { return 0; }
+    bool disconnect(uint16_t) { return true; } // NOLINT
+};
+
+class NimBLEDevice
+{
+    static std::unique_ptr<NimBLEServer>& server()
+    {
+        static std::unique_ptr<NimBLEServer> instance;
+        return instance;
+    }
+
+public:
+    static bool init(const std::string&) { return true; }
+
+    static NimBLEServer* createServer()
+    {
+        if (!server()) server() = std::make_unique<NimBLEServer>();
+        return server().get();
+    }
+
+    static NimBLEServer* getServer() { return server().get(); }
+
+    static bool deinit(bool = false)
+    {
+        server().reset();
+        return true;
+    }
+};
+
+using BLEDevice = NimBLEDevice;
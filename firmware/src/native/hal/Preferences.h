@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+/**
+ * In-memory replacement for the ESP32 NVS-backed Preferences.
+ * Namespaces are shared between instances, so a value written by one handle
+ * is visible to every other handle opened on the same namespace.
+ */
+class Preferences
+{
+    std::string name;
+    bool readOnly = true;
+    bool started = false;
+
+    size_t put(const char* key, const void* value, size_t length);
+    [[nodiscard]] const std::vector<uint8_t>* find(const char* key) const;
+
+    template <typename T>
+    size_t putValue(const char* key, const T value)
+    {
+        return put(key, &value, sizeof(value));
+    }
+
+    template <typename T>
+    T getValue(const char* key, const T defaultValue) const
+    {
+        const auto* stored = find(key);
+        if (stored == nullptr || stored->size() != sizeof(T))
+            return defaultValue;
+        T value;
+        std::memcpy(&value, stored->data(), sizeof(T));
+        return value;
+    }
+
+public:
+    bool begin(const char* name, bool readOnly = false);
+    void end();
+
+    bool remove(const char* key);
+    bool isKey(const char* key) const;
+
+    size_t putBool(const char* key, const bool value) { return putValue<uint8_t>(key, value); }
+    size_t putUChar(const char* key, const uint8_t value) { return putValue(key, value); }
+    size_t putUShort(const char* key, const uint16_t value) { return putValue(key, value); }
+    size_t putUInt(const char* key, const uint32_t value) { return putValue(key, value); }
+    size_t putFloat(const char* key, const float value) { return putValue(key, value); }
+    size_t putString(const char* key, const char* value) { return put(key, value, std::strlen(value) + 1); }
+    size_t putBytes(const char* key, const void* value, const size_t length) { return put(key, value, length); }
+
+    bool getBool(const char* key, const bool defaultValue = false) const
+    {
+        return getValue<uint8_t>(key, defaultValue) != 0;
+    }
+
+    uint8_t getUChar(const char* key, const uint8_t defaultValue = 0) const { return getValue(key, defaultValue); }
+    uint16_t getUShort(const char* key, const uint16_t defaultValue = 0) const { return getValue(key, defaultValue); }
+    uint32_t getUInt(const char* key, const uint32_t defaultValue = 0) const { return getValue(key, defaultValue); }
+    float getFloat(const char* key, const float defaultValue = NAN) const { return getValue(key, defaultValue); }
+
+    String getString(const char* key, const String& defaultValue = String()) const;
+    size_t getString(const char* key, char* value, size_t maxLength) const;
+    size_t getBytesLength(const char* key) const;
+    size_t getBytes(const char* key, void* buffer, size_t maxLength) const;
+};
+
+namespace NativeHal
+{
+    [[nodiscard]] uint32_t getNvsWriteCount();
+    void eraseNvs();
+}
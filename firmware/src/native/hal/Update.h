@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define U_FLASH 0
+#define U_SPIFFS 100
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+class UpdateClass
+{
+    size_t expected = 0;
+    size_t written = 0;
+    bool running = false;
+
+public:
+    bool begin(const size_t size, const int command = U_FLASH) // NOLINT
+    {
+        expected = size;
+        written = 0;
+        running = true;
+        return true;
+    }
+
+    size_t write(const uint8_t* data, const size_t length) // NOLINT
+    {
+        if (!running) return 0;
+        written += length;
+        return length;
+    }
+
+    bool end(const bool evenIfRemaining = false)
+    {
+        if (!running) return false;
+        running = false;
+        return evenIfRemaining || expected == UPDATE_SIZE_UNKNOWN || written == expected;
+    }
+
+    void abort() { running = false; }
+    bool setMD5(const char* md5) { return md5 != nullptr; } // NOLINT
+    [[nodiscard]] const char* errorString() const { return running ? "No Error" : "Not running"; }
+};
+
+extern UpdateClass Update;
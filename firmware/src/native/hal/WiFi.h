@@ -0,0 +1,122 @@
+#pragma once
+
+#include <functional>
+
+#include "Arduino.h"
+#include "esp_wpa2.h"
+
+typedef enum
+{
+    WIFI_MODE_NULL = 0,
+    WIFI_MODE_STA,
+    WIFI_MODE_AP,
+    WIFI_MODE_APSTA
+} wifi_mode_t;
+
+typedef enum
+{
+    WIFI_IF_STA = 0,
+    WIFI_IF_AP
+} wifi_interface_t;
+
+typedef enum
+{
+    WIFI_REASON_AUTH_FAIL = 202,
+    WIFI_REASON_NO_AP_FOUND = 201
+} wifi_err_reason_t;
+
+typedef enum
+{
+    ARDUINO_EVENT_WIFI_STA_CONNECTED,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP
+} WiFiEvent_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t reason;
+    } wifi_sta_disconnected;
+} WiFiEventInfo_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+class IPAddress
+{
+    uint32_t address = 0;
+
+public:
+    IPAddress() = default;
+    explicit IPAddress(const uint32_t address) : address(address) {}
+
+    IPAddress(const uint8_t a, const uint8_t b, const uint8_t c, const uint8_t d)
+        : address(a | b << 8 | c << 16 | static_cast<uint32_t>(d) << 24)
+    {
+    }
+
+    explicit operator uint32_t() const { return address; }
+
+    [[nodiscard]] String toString() const
+    {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u",
+                 address & 0xFF, address >> 8 & 0xFF, address >> 16 & 0xFF, address >> 24 & 0xFF);
+        return buffer;
+    }
+};
+
+class WiFiClass
+{
+    std::vector<std::function<void(WiFiEvent_t, const WiFiEventInfo_t&)>> handlers;
+
+public:
+    void persistent(bool) {} // NOLINT
+    bool mode(wifi_mode_t) { return true; } // NOLINT
+
+    void onEvent(std::function<void(WiFiEvent_t, const WiFiEventInfo_t&)> handler)
+    {
+        handlers.push_back(std::move(handler));
+    }
+
+    void emit(const WiFiEvent_t event, const WiFiEventInfo_t& info = {}) const
+    {
+        for (const auto& handler : handlers)
+            handler(event, info);
+    }
+
+    void begin(const char*, const char* = nullptr) {} // NOLINT
+    bool disconnect() { return true; } // NOLINT
+    bool reconnect() { return true; } // NOLINT
+
+    static bool setHostname(const char*) { return true; }
+
+    String SSID() const { return "native"; } // NOLINT
+    String SSID(uint8_t) const { return ""; } // NOLINT
+    uint8_t encryptionType(uint8_t) const { return 0; } // NOLINT
+
+    int16_t scanNetworks(bool = false) { return 0; } // NOLINT
+    int16_t scanComplete() const { return 0; } // NOLINT
+    void scanDelete() {} // NOLINT
+
+    uint8_t* macAddress(uint8_t* mac) const
+    {
+        constexpr uint8_t address[] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+        std::memcpy(mac, address, sizeof(address));
+        return mac;
+    }
+
+    String macAddress() const
+    {
+        return "02:00:00:00:00:01";
+    }
+
+    IPAddress localIP() const { return IPAddress(0x0100007F); } // NOLINT
+    IPAddress gatewayIP() const { return IPAddress(); } // NOLINT
+    IPAddress subnetMask() const { return IPAddress(0x000000FF); } // NOLINT
+    IPAddress dnsIP() const { return IPAddress(); } // NOLINT
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <tuple>
+
+namespace AsyncEspAlexaColorUtils
+{
+    static constexpr uint8_t ALEXA_MIN_BRI_VAL = 1;
+    static constexpr uint8_t ALEXA_MAX_BRI_VAL = 254;
+    static constexpr uint16_t ALEXA_MAX_HUE_VAL = 65535;
+    static constexpr uint8_t ALEXA_MAX_SAT_VAL = 254;
+
+    inline std::tuple<uint16_t, uint8_t, uint8_t> rgbToHsv(const uint8_t r, const uint8_t g, const uint8_t b)
+    {
+        const auto max = std::max({r, g, b});
+        const auto min = std::min({r, g, b});
+        const float delta = static_cast<float>(max - min);
+
+        float hue = 0;
+        if (delta > 0)
+        {
+            if (max == r) hue = 60.0f * static_cast<float>(g - b) / delta;
+            else if (max == g) hue = 60.0f * (2.0f + static_cast<float>(b - r) / delta);
+            else hue = 60.0f * (4.0f + static_cast<float>(r - g) / delta);
+            if (hue < 0) hue += 360.0f;
+        }
+        const float saturation = max == 0 ? 0.0f : delta / static_cast<float>(max);
+        return {
+            static_cast<uint16_t>(hue / 360.0f * ALEXA_MAX_HUE_VAL),
+            static_cast<uint8_t>(saturation * ALEXA_MAX_SAT_VAL),
+            std::clamp<uint8_t>(max, ALEXA_MIN_BRI_VAL, ALEXA_MAX_BRI_VAL)
+        };
+    }
+
+    inline std::tuple<uint16_t, uint8_t, uint8_t> rgbwToHsv(const uint8_t r, const uint8_t g, const uint8_t b,
+                                                            const uint8_t w)
+    {
+        return rgbToHsv(std::max(r, w), std::max(g, w), std::max(b, w));
+    }
+
+    inline std::array<uint8_t, 3> hsvToRgb(const uint16_t hue, const uint8_t saturation, const uint8_t value)
+    {
+        const float h = static_cast<float>(hue) / ALEXA_MAX_HUE_VAL * 6.0f;
+        const float s = static_cast<float>(saturation) / ALEXA_MAX_SAT_VAL;
+        const float v = static_cast<float>(value);
+        const int sector = static_cast<int>(h) % 6;
+        const float f = h - static_cast<float>(static_cast<int>(h));
+        const auto p = static_cast<uint8_t>(v * (1 - s));
+        const auto q = static_cast<uint8_t>(v * (1 - s * f));
+        const auto t = static_cast<uint8_t>(v * (1 - s * (1 - f)));
+        const auto m = static_cast<uint8_t>(v);
+        switch (sector)
+        {
+        case 0: return {m, t, p};
+        case 1: return {q, m, p};
+        case 2: return {p, m, t};
+        case 3: return {p, q, m};
+        case 4: return {t, p, m};
+        default: return {m, p, q};
+        }
+    }
+
+    inline std::array<uint8_t, 4> hsvToRgbw(const uint16_t hue, const uint8_t saturation, const uint8_t value)
+    {
+        const auto [r, g, b] = hsvToRgb(hue, saturation, value);
+        const auto w = std::min({r, g, b});
+        return {
+            static_cast<uint8_t>(r - w),
+            static_cast<uint8_t>(g - w),
+            static_cast<uint8_t>(b - w),
+            w
+        };
+    }
+
+    inline std::array<uint8_t, 4> ctToRgbw(const uint8_t brightness, const uint16_t colorTemperature)
+    {
+        const float warmth = std::clamp((static_cast<float>(colorTemperature) - 153.0f) / (500.0f - 153.0f),
+                                        0.0f, 1.0f);
+        return {
+            static_cast<uint8_t>(static_cast<float>(brightness) * warmth),
+            static_cast<uint8_t>(static_cast<float>(brightness) * warmth * 0.5f),
+            0,
+            brightness
+        };
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "ESPAsyncWebServer.h"
+
+class AsyncEspAlexaDevice
+{
+public:
+    static constexpr size_t MAX_DEVICE_NAME_LENGTH = 33;
+
+protected:
+    std::array<char, MAX_DEVICE_NAME_LENGTH> name = {};
+    bool on;
+    uint8_t brightness;
+
+public:
+    AsyncEspAlexaDevice(const char* name, const bool on, const uint8_t brightness)
+        : on(on), brightness(brightness)
+    {
+        std::snprintf(this->name.data(), this->name.size(), "%s", name);
+    }
+
+    virtual ~AsyncEspAlexaDevice() = default;
+
+    void setOn(const bool on) { this->on = on; }
+    void setBrightness(const uint8_t brightness) { this->brightness = brightness; }
+    [[nodiscard]] bool isOn() const { return on; }
+    [[nodiscard]] uint8_t getBrightness() const { return brightness; }
+};
+
+class AsyncEspAlexaDimmableDevice : public AsyncEspAlexaDevice
+{
+    std::function<void(bool, uint8_t)> brightnessCallback;
+
+public:
+    using AsyncEspAlexaDevice::AsyncEspAlexaDevice;
+
+    void setBrightnessCallback(std::function<void(bool, uint8_t)> callback)
+    {
+        brightnessCallback = std::move(callback);
+    }
+};
+
+class AsyncEspAlexaColorDevice : public AsyncEspAlexaDevice
+{
+    uint16_t hue;
+    uint8_t saturation;
+    std::function<void(bool, uint8_t, uint16_t, uint8_t)> colorCallback;
+
+public:
+    AsyncEspAlexaColorDevice(const char* name, const bool on, const uint8_t brightness,
+                             const uint16_t hue, const uint8_t saturation)
+        : AsyncEspAlexaDevice(name, on, brightness), hue(hue), saturation(saturation)
+    {
+    }
+
+    void setColor(const uint16_t hue, const uint8_t saturation)
+    {
+        this->hue = hue;
+        this->saturation = saturation;
+    }
+
+    void setColorCallback(std::function<void(bool, uint8_t, uint16_t, uint8_t)> callback)
+    {
+        colorCallback = std::move(callback);
+    }
+};
+
+class AsyncEspAlexaExtendedColorDevice : public AsyncEspAlexaColorDevice
+{
+    std::function<void(bool, uint8_t, uint16_t)> colorTemperatureCallback;
+
+public:
+    enum class ColorMode : uint8_t { none, hs, xy, ct };
+
+    AsyncEspAlexaExtendedColorDevice(const char* name, const bool on, const uint8_t brightness,
+                                     const uint16_t hue, const uint8_t saturation, uint16_t, ColorMode)
+        : AsyncEspAlexaColorDevice(name, on, brightness, hue, saturation)
+    {
+    }
+
+    void setColorTemperatureCallback(std::function<void(bool, uint8_t, uint16_t)> callback)
+    {
+        colorTemperatureCallback = std::move(callback);
+    }
+};
+
+class AsyncEspAlexaManager
+{
+    std::vector<std::unique_ptr<AsyncEspAlexaDevice>> devices;
+
+public:
+    void begin() {} // NOLINT
+    void loop() {} // NOLINT
+
+    void reserve(const size_t count) { devices.reserve(count); }
+    void addDevice(AsyncEspAlexaDevice* device) { devices.emplace_back(device); }
+    void deleteAllDevices() { devices.clear(); }
+
+    [[nodiscard]] AsyncWebHandler* createAlexaAsyncWebHandler() const { return new AsyncWebHandler(); }
+};
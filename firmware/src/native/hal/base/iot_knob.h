@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+typedef void* knob_handle_t;
+typedef void (*knob_cb_t)(void* handle, void* data);
+
+typedef enum
+{
+    KNOB_LEFT = 0,
+    KNOB_RIGHT,
+    KNOB_H_LIM,
+    KNOB_L_LIM,
+    KNOB_ZERO,
+    KNOB_EVENT_MAX,
+    KNOB_EVENT_NONE,
+} knob_event_t;
+
+typedef struct
+{
+    uint8_t default_direction;
+    uint8_t gpio_encoder_a;
+    uint8_t gpio_encoder_b;
+} knob_config_t;
+
+knob_handle_t iot_knob_create(const knob_config_t* config);
+int iot_knob_delete(knob_handle_t handle);
+int iot_knob_register_cb(knob_handle_t handle, knob_event_t event, knob_cb_t callback, void* data);
+
+namespace NativeHal
+{
+    /**
+     * Fires the callback registered for `event`, as one encoder detent would.
+     */
+    void turnKnob(knob_handle_t handle, knob_event_t event);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+
+#ifndef CORE_DEBUG_LEVEL
+#define CORE_DEBUG_LEVEL 0
+#endif
+
+#define NATIVE_HAL_LOG(level, letter, tag, format, ...)                                     \
+    do                                                                                      \
+    {                                                                                       \
+        if constexpr (CORE_DEBUG_LEVEL >= (level))                                          \
+            std::fprintf(stderr, "[" letter "][%s] " format "\n", tag, ##__VA_ARGS__);      \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) NATIVE_HAL_LOG(1, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) NATIVE_HAL_LOG(2, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) NATIVE_HAL_LOG(3, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) NATIVE_HAL_LOG(4, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) NATIVE_HAL_LOG(5, "V", tag, format, ##__VA_ARGS__)
+
+typedef enum : int8_t
+{
+    GPIO_NUM_NC = -1,
+    GPIO_NUM_0 = 0, GPIO_NUM_1, GPIO_NUM_2, GPIO_NUM_3, GPIO_NUM_4, GPIO_NUM_5, GPIO_NUM_6, GPIO_NUM_7,
+    GPIO_NUM_8, GPIO_NUM_9, GPIO_NUM_10, GPIO_NUM_11, GPIO_NUM_12, GPIO_NUM_13, GPIO_NUM_14, GPIO_NUM_15,
+    GPIO_NUM_16, GPIO_NUM_17, GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_20, GPIO_NUM_21, GPIO_NUM_22, GPIO_NUM_23,
+    GPIO_NUM_24, GPIO_NUM_25, GPIO_NUM_26, GPIO_NUM_27, GPIO_NUM_28, GPIO_NUM_29, GPIO_NUM_30, GPIO_NUM_31,
+    GPIO_NUM_32, GPIO_NUM_33, GPIO_NUM_34, GPIO_NUM_35, GPIO_NUM_36, GPIO_NUM_37, GPIO_NUM_38, GPIO_NUM_39,
+    GPIO_NUM_MAX
+} gpio_num_t;
+
+#define LOW 0x0
+#define HIGH 0x1
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+uint32_t analogReadMilliVolts(uint8_t pin);
+
+uint32_t ledcSetup(uint8_t channel, uint32_t frequency, uint8_t resolutionBits);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+
+long random(long min, long max);
+
+/**
+ * Host-side hooks into the simulated hardware, used by native benchmarks
+ * to drive inputs and inspect outputs without a board attached.
+ */
+namespace NativeHal
+{
+    static constexpr uint8_t LEDC_CHANNELS = 16;
+
+    struct LedcChannel
+    {
+        uint32_t frequency = 0;
+        uint8_t resolutionBits = 0;
+        uint32_t duty = 0;
+        uint32_t writes = 0;
+    };
+
+    void setTime(unsigned long ms);
+    void advanceTime(unsigned long ms);
+    void useRealTime();
+
+    void setDigitalInput(uint8_t pin, int value);
+    void setAnalogMilliVolts(uint8_t pin, uint32_t milliVolts);
+
+    [[nodiscard]] const LedcChannel& getLedcChannel(uint8_t channel);
+    void resetLedcCounters();
+}
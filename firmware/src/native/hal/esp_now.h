@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+#include "WiFi.h"
+#include "esp_system.h"
+
+#define ESP_NOW_ETH_ALEN 6
+#define ESP_NOW_KEY_LEN 16
+#define ESP_NOW_MAX_DATA_LEN 250
+#define ESP_NOW_MAX_TOTAL_PEER_NUM 20
+
+#define ESP_ERR_ESPNOW_BASE 0x3000
+#define ESP_ERR_ESPNOW_NOT_INIT (ESP_ERR_ESPNOW_BASE + 1)
+#define ESP_ERR_ESPNOW_ARG (ESP_ERR_ESPNOW_BASE + 2)
+#define ESP_ERR_ESPNOW_NO_MEM (ESP_ERR_ESPNOW_BASE + 3)
+#define ESP_ERR_ESPNOW_FULL (ESP_ERR_ESPNOW_BASE + 4)
+#define ESP_ERR_ESPNOW_NOT_FOUND (ESP_ERR_ESPNOW_BASE + 5)
+#define ESP_ERR_ESPNOW_INTERNAL (ESP_ERR_ESPNOW_BASE + 6)
+#define ESP_ERR_ESPNOW_EXIST (ESP_ERR_ESPNOW_BASE + 7)
+#define ESP_ERR_ESPNOW_IF (ESP_ERR_ESPNOW_BASE + 8)
+
+typedef enum
+{
+    ESP_NOW_SEND_SUCCESS = 0,
+    ESP_NOW_SEND_FAIL
+} esp_now_send_status_t;
+
+typedef struct
+{
+    uint8_t peer_addr[ESP_NOW_ETH_ALEN];
+    uint8_t lmk[ESP_NOW_KEY_LEN];
+    uint8_t channel;
+    wifi_interface_t ifidx;
+    bool encrypt;
+    void* priv;
+} esp_now_peer_info_t;
+
+typedef void (*esp_now_recv_cb_t)(const uint8_t* mac, const uint8_t* data, int len);
+typedef void (*esp_now_send_cb_t)(const uint8_t* mac, esp_now_send_status_t status);
+
+esp_err_t esp_now_init();
+esp_err_t esp_now_deinit();
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t callback);
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t callback);
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer);
+esp_err_t esp_now_del_peer(const uint8_t* address);
+bool esp_now_is_peer_exist(const uint8_t* address);
+esp_err_t esp_now_send(const uint8_t* address, const uint8_t* data, size_t len);
+
+namespace NativeHal
+{
+    /**
+     * Delivers a frame to the registered receive callback as if it had arrived over the air.
+     */
+    void injectEspNowFrame(const uint8_t* mac, const uint8_t* data, int len);
+
+    /**
+     * Invoked for every esp_now_send, after which the registered send callback
+     * is called with ESP_NOW_SEND_SUCCESS.
+     */
+    void setEspNowSendHook(void (*hook)(const uint8_t* mac, const uint8_t* data, size_t len));
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "esp_system.h"
+
+esp_err_t esp_sleep_enable_gpio_wakeup();
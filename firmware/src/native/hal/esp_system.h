@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL (-1)
+
+[[noreturn]] void esp_restart();
+uint32_t esp_get_free_heap_size();
+uint32_t esp_random();
+uint32_t getCpuFrequencyMhz();
+
+class EspClass
+{
+public:
+    [[nodiscard]] uint32_t getFreeHeap() const { return esp_get_free_heap_size(); }
+    /** Always runs on real time, ticking at getCpuFrequencyMhz() */
+    [[nodiscard]] uint32_t getCycleCount() const;
+};
+
+extern EspClass ESP;
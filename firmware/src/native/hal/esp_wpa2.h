@@ -0,0 +1,19 @@
+#pragma once
+
+#include "esp_system.h"
+
+typedef enum
+{
+    ESP_EAP_TTLS_PHASE2_EAP,
+    ESP_EAP_TTLS_PHASE2_MSCHAPV2,
+    ESP_EAP_TTLS_PHASE2_MSCHAP,
+    ESP_EAP_TTLS_PHASE2_PAP,
+    ESP_EAP_TTLS_PHASE2_CHAP
+} esp_eap_ttls_phase2_types;
+
+inline esp_err_t esp_wifi_sta_wpa2_ent_enable() { return ESP_OK; }
+inline esp_err_t esp_wifi_sta_wpa2_ent_disable() { return ESP_OK; }
+inline esp_err_t esp_wifi_sta_wpa2_ent_set_identity(const unsigned char*, int) { return ESP_OK; }
+inline esp_err_t esp_wifi_sta_wpa2_ent_set_username(const unsigned char*, int) { return ESP_OK; }
+inline esp_err_t esp_wifi_sta_wpa2_ent_set_password(const unsigned char*, int) { return ESP_OK; }
+inline esp_err_t esp_wifi_sta_wpa2_ent_set_ttls_phase2_method(esp_eap_ttls_phase2_types) { return ESP_OK; }
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define errQUEUE_FULL 0
+#define errQUEUE_EMPTY 0
+
+#define portMAX_DELAY static_cast<TickType_t>(0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) static_cast<TickType_t>(ms)
+#define portYIELD_FROM_ISR() do {} while (0)
+
+// Host threads are scheduled preemptively on every core, so a critical
+// section has nothing to hold off
+typedef struct
+{
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+#define portENTER_CRITICAL(mux) static_cast<void>(mux)
+#define portEXIT_CRITICAL(mux) static_cast<void>(mux)
@@ -0,0 +1,666 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "Arduino.h"
+#include "LittleFS.h"
+#include "Preferences.h"
+#include "Update.h"
+#include "WiFi.h"
+#include "esp_now.h"
+#include "nvs_flash.h"
+#include "base/iot_knob.h"
+#include "driver/gpio.h"
+#include "esp_sleep.h"
+
+constexpr auto LOG_TAG = "NativeHal";
+
+EspClass ESP;
+WiFiClass WiFi;
+UpdateClass Update;
+fs::FS LittleFS;
+
+// --------------------  Time --------------------
+
+namespace
+{
+    const auto bootTime = std::chrono::steady_clock::now();
+    std::atomic<bool> manualTime = false;
+    std::atomic<unsigned long> manualMillis = 0;
+
+    uint64_t elapsedMicros()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - bootTime).count();
+    }
+}
+
+unsigned long millis()
+{
+    return manualTime ? manualMillis.load() : static_cast<unsigned long>(elapsedMicros() / 1000);
+}
+
+unsigned long micros()
+{
+    return manualTime ? manualMillis * 1000 : static_cast<unsigned long>(elapsedMicros());
+}
+
+uint32_t getCpuFrequencyMhz()
+{
+    return 240;
+}
+
+uint32_t EspClass::getCycleCount() const
+{
+    const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - bootTime).count();
+    return static_cast<uint32_t>(nanos * getCpuFrequencyMhz() / 1000);
+}
+
+void delay(const uint32_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void NativeHal::setTime(const unsigned long ms)
+{
+    manualMillis = ms;
+    manualTime = true;
+}
+
+void NativeHal::advanceTime(const unsigned long ms)
+{
+    manualMillis += ms;
+    manualTime = true;
+}
+
+void NativeHal::useRealTime()
+{
+    manualTime = false;
+}
+
+// --------------------  GPIO, ADC & LEDC --------------------
+
+namespace
+{
+    std::array<int, GPIO_NUM_MAX> digitalInputs = [] { std::array<int, GPIO_NUM_MAX> a{}; a.fill(HIGH); return a; }();
+    std::array<uint32_t, GPIO_NUM_MAX> analogInputs = {};
+    std::array<NativeHal::LedcChannel, NativeHal::LEDC_CHANNELS> ledcChannels = {};
+
+    /** Level interrupts, fired when a simulated input changes to the armed level */
+    struct PinInterrupt
+    {
+        gpio_isr_t handler = nullptr;
+        void* arg = nullptr;
+        gpio_int_type_t type = GPIO_INTR_DISABLE;
+    };
+
+    std::array<PinInterrupt, GPIO_NUM_MAX> pinInterrupts = {};
+    std::mutex pinInterruptsMutex;
+}
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+int digitalRead(const uint8_t pin)
+{
+    return pin < GPIO_NUM_MAX ? digitalInputs[pin] : LOW;
+}
+
+void digitalWrite(uint8_t, uint8_t)
+{
+}
+
+uint32_t analogReadMilliVolts(const uint8_t pin)
+{
+    return pin < GPIO_NUM_MAX ? analogInputs[pin] : 0;
+}
+
+uint32_t ledcSetup(const uint8_t channel, const uint32_t frequency, const uint8_t resolutionBits)
+{
+    if (channel >= NativeHal::LEDC_CHANNELS) return 0;
+    ledcChannels[channel].frequency = frequency;
+    ledcChannels[channel].resolutionBits = resolutionBits;
+    return frequency;
+}
+
+void ledcAttachPin(uint8_t, uint8_t)
+{
+}
+
+void ledcWrite(const uint8_t channel, const uint32_t duty)
+{
+    if (channel >= NativeHal::LEDC_CHANNELS) return;
+    ledcChannels[channel].duty = duty;
+    ledcChannels[channel].writes++;
+}
+
+long random(const long min, const long max)
+{
+    static std::mt19937 generator(std::random_device{}());
+    return std::uniform_int_distribution<long>(min, max - 1)(generator);
+}
+
+void NativeHal::setDigitalInput(const uint8_t pin, const int value)
+{
+    if (pin >= GPIO_NUM_MAX) return;
+    digitalInputs[pin] = value;
+
+    PinInterrupt interrupt;
+    {
+        std::lock_guard lock(pinInterruptsMutex);
+        interrupt = pinInterrupts[pin];
+    }
+    const auto armed = value == LOW ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+    if (interrupt.handler && interrupt.type == armed)
+        interrupt.handler(interrupt.arg);
+}
+
+esp_err_t gpio_install_isr_service(int)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(const gpio_num_t pin, const gpio_isr_t handler, void* arg)
+{
+    if (pin < 0 || pin >= GPIO_NUM_MAX) return ESP_FAIL;
+    std::lock_guard lock(pinInterruptsMutex);
+    pinInterrupts[pin].handler = handler;
+    pinInterrupts[pin].arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_enable(const gpio_num_t pin, const gpio_int_type_t type)
+{
+    if (pin < 0 || pin >= GPIO_NUM_MAX) return ESP_FAIL;
+    std::lock_guard lock(pinInterruptsMutex);
+    pinInterrupts[pin].type = type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t)
+{
+    return ESP_OK;
+}
+
+int gpio_get_level(const gpio_num_t pin)
+{
+    return digitalRead(pin);
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup()
+{
+    return ESP_OK;
+}
+
+void NativeHal::setAnalogMilliVolts(const uint8_t pin, const uint32_t milliVolts)
+{
+    if (pin < GPIO_NUM_MAX) analogInputs[pin] = milliVolts;
+}
+
+const NativeHal::LedcChannel& NativeHal::getLedcChannel(const uint8_t channel)
+{
+    return ledcChannels.at(channel);
+}
+
+void NativeHal::resetLedcCounters()
+{
+    for (auto& channel : ledcChannels)
+        channel.writes = 0;
+}
+
+// --------------------  System --------------------
+
+void esp_restart()
+{
+    ESP_LOGW(LOG_TAG, "esp_restart() called, exiting");
+    std::exit(0);
+}
+
+uint32_t esp_get_free_heap_size()
+{
+    return 200000;
+}
+
+uint32_t esp_random()
+{
+    static std::mt19937 generator{std::random_device{}()};
+    return generator();
+}
+
+// --------------------  FreeRTOS --------------------
+
+struct NativeTask
+{
+    TaskFunction_t function;
+    void* parameters;
+    std::string name;
+
+    std::mutex mutex;
+    std::condition_variable notified;
+    uint32_t notifications = 0;
+};
+
+namespace
+{
+    struct TaskDeleted
+    {
+    };
+
+    /** Threads not started through xTaskCreate, like main(), get a handle on first use */
+    thread_local NativeTask* currentTask = nullptr;
+}
+
+BaseType_t xTaskCreate(const TaskFunction_t function, const char* name, uint32_t, void* parameters, UBaseType_t,
+                       TaskHandle_t* createdTask)
+{
+    auto* task = new NativeTask{function, parameters, name};
+    if (createdTask) *createdTask = task;
+    std::thread([task]
+    {
+        currentTask = task;
+        try
+        {
+            task->function(task->parameters);
+        }
+        catch (const TaskDeleted&)
+        {
+        }
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(const TaskFunction_t function, const char* name, const uint32_t stackDepth,
+                                   void* parameters, const UBaseType_t priority, TaskHandle_t* createdTask,
+                                   BaseType_t)
+{
+    return xTaskCreate(function, name, stackDepth, parameters, priority, createdTask);
+}
+
+void vTaskDelete(const TaskHandle_t task)
+{
+    if (task == nullptr)
+        throw TaskDeleted();
+    ESP_LOGW(LOG_TAG, "Deleting another task is not supported on the native HAL");
+}
+
+void vTaskDelay(const TickType_t ticks)
+{
+    delay(ticks * portTICK_PERIOD_MS);
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return static_cast<TickType_t>(millis() / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    if (currentTask == nullptr)
+        currentTask = new NativeTask{nullptr, nullptr, "thread"};
+    return currentTask;
+}
+
+char* pcTaskGetName(const TaskHandle_t task)
+{
+    return (task ? task : xTaskGetCurrentTaskHandle())->name.data();
+}
+
+BaseType_t xTaskNotifyGive(const TaskHandle_t task)
+{
+    std::lock_guard lock(task->mutex);
+    ++task->notifications;
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(const TaskHandle_t task, BaseType_t* higherPriorityTaskWoken)
+{
+    xTaskNotifyGive(task);
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(const BaseType_t clearCountOnExit, const TickType_t ticksToWait)
+{
+    auto* task = xTaskGetCurrentTaskHandle();
+    std::unique_lock lock(task->mutex);
+    if (ticksToWait == portMAX_DELAY)
+        task->notified.wait(lock, [task] { return task->notifications != 0; });
+    else
+        task->notified.wait_for(lock, std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS),
+                                [task] { return task->notifications != 0; });
+    const auto count = task->notifications;
+    if (count != 0)
+        task->notifications = clearCountOnExit ? 0 : count - 1;
+    return count;
+}
+
+struct NativeQueue
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+};
+
+namespace
+{
+    template <typename Predicate>
+    bool waitFor(std::unique_lock<std::mutex>& lock, std::condition_variable& cv,
+                 const TickType_t ticks, Predicate predicate)
+    {
+        if (ticks == portMAX_DELAY)
+        {
+            cv.wait(lock, predicate);
+            return true;
+        }
+        // A zero timeout never blocks, as in FreeRTOS; wait_for would still sleep for the timer slack
+        if (ticks == 0)
+            return predicate();
+        return cv.wait_for(lock, std::chrono::milliseconds(ticks * portTICK_PERIOD_MS), predicate);
+    }
+}
+
+QueueHandle_t xQueueCreate(const UBaseType_t length, const UBaseType_t itemSize)
+{
+    auto* queue = new NativeQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+void vQueueDelete(const QueueHandle_t queue)
+{
+    delete queue;
+}
+
+BaseType_t xQueueSend(const QueueHandle_t queue, const void* item, const TickType_t ticksToWait)
+{
+    std::unique_lock lock(queue->mutex);
+    if (!waitFor(lock, queue->changed, ticksToWait, [queue] { return queue->items.size() < queue->length; }))
+        return errQUEUE_FULL;
+    const auto* bytes = static_cast<const uint8_t*>(item);
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    queue->changed.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(const QueueHandle_t queue, void* buffer, const TickType_t ticksToWait)
+{
+    std::unique_lock lock(queue->mutex);
+    if (!waitFor(lock, queue->changed, ticksToWait, [queue] { return !queue->items.empty(); }))
+        return pdFALSE;
+    std::memcpy(buffer, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t queue)
+{
+    std::lock_guard lock(queue->mutex);
+    return queue->items.size();
+}
+
+struct NativeSemaphore
+{
+    std::timed_mutex mutex;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return new NativeSemaphore();
+}
+
+BaseType_t xSemaphoreTake(const SemaphoreHandle_t semaphore, const TickType_t ticksToWait)
+{
+    if (ticksToWait == portMAX_DELAY)
+    {
+        semaphore->mutex.lock();
+        return pdTRUE;
+    }
+    return semaphore->mutex.try_lock_for(std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS))
+               ? pdTRUE
+               : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(const SemaphoreHandle_t semaphore)
+{
+    semaphore->mutex.unlock();
+    return pdTRUE;
+}
+
+// --------------------  Preferences (NVS) --------------------
+
+namespace
+{
+    using Namespace = std::map<std::string, std::vector<uint8_t>>;
+
+    std::mutex nvsMutex;
+    std::map<std::string, Namespace> nvs;
+    uint32_t nvsWrites = 0;
+}
+
+bool Preferences::begin(const char* name, const bool readOnly)
+{
+    this->name = name;
+    this->readOnly = readOnly;
+    started = true;
+    return true;
+}
+
+void Preferences::end()
+{
+    started = false;
+}
+
+size_t Preferences::put(const char* key, const void* value, const size_t length)
+{
+    if (!started || readOnly) return 0;
+    std::lock_guard lock(nvsMutex);
+    const auto* bytes = static_cast<const uint8_t*>(value);
+    auto& stored = nvs[name][key];
+    if (stored.size() != length || !std::equal(stored.begin(), stored.end(), bytes))
+    {
+        // NVS skips the flash write when the stored value is unchanged
+        stored.assign(bytes, bytes + length);
+        nvsWrites++;
+    }
+    return length;
+}
+
+const std::vector<uint8_t>* Preferences::find(const char* key) const
+{
+    if (!started) return nullptr;
+    std::lock_guard lock(nvsMutex);
+    const auto space = nvs.find(name);
+    if (space == nvs.end()) return nullptr;
+    const auto entry = space->second.find(key);
+    return entry == space->second.end() ? nullptr : &entry->second;
+}
+
+bool Preferences::remove(const char* key)
+{
+    if (!started || readOnly) return false;
+    std::lock_guard lock(nvsMutex);
+    return nvs[name].erase(key) != 0;
+}
+
+bool Preferences::isKey(const char* key) const
+{
+    return find(key) != nullptr;
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) const
+{
+    const auto* stored = find(key);
+    if (stored == nullptr || stored->empty()) return defaultValue;
+    return String(reinterpret_cast<const char*>(stored->data()));
+}
+
+size_t Preferences::getString(const char* key, char* value, const size_t maxLength) const
+{
+    const auto* stored = find(key);
+    if (stored == nullptr || stored->size() > maxLength) return 0;
+    std::memcpy(value, stored->data(), stored->size());
+    return stored->size();
+}
+
+size_t Preferences::getBytesLength(const char* key) const
+{
+    const auto* stored = find(key);
+    return stored == nullptr ? 0 : stored->size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, const size_t maxLength) const
+{
+    const auto* stored = find(key);
+    if (stored == nullptr || stored->size() > maxLength) return 0;
+    std::memcpy(buffer, stored->data(), stored->size());
+    return stored->size();
+}
+
+uint32_t NativeHal::getNvsWriteCount()
+{
+    std::lock_guard lock(nvsMutex);
+    return nvsWrites;
+}
+
+void NativeHal::eraseNvs()
+{
+    std::lock_guard lock(nvsMutex);
+    nvs.clear();
+}
+
+esp_err_t nvs_flash_erase()
+{
+    NativeHal::eraseNvs();
+    return ESP_OK;
+}
+
+// --------------------  ESP-NOW --------------------
+
+namespace
+{
+    bool espNowInitialized = false;
+    esp_now_recv_cb_t espNowReceiveCallback = nullptr;
+    esp_now_send_cb_t espNowSendCallback = nullptr;
+    void (*espNowSendHook)(const uint8_t*, const uint8_t*, size_t) = nullptr;
+    std::set<std::array<uint8_t, ESP_NOW_ETH_ALEN>> espNowPeers;
+
+    std::array<uint8_t, ESP_NOW_ETH_ALEN> toMac(const uint8_t* address)
+    {
+        std::array<uint8_t, ESP_NOW_ETH_ALEN> mac = {};
+        std::copy_n(address, mac.size(), mac.begin());
+        return mac;
+    }
+}
+
+esp_err_t esp_now_init()
+{
+    espNowInitialized = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_deinit()
+{
+    espNowInitialized = false;
+    espNowPeers.clear();
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(const esp_now_recv_cb_t callback)
+{
+    espNowReceiveCallback = callback;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(const esp_now_send_cb_t callback)
+{
+    espNowSendCallback = callback;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer)
+{
+    if (!espNowInitialized) return ESP_ERR_ESPNOW_NOT_INIT;
+    if (esp_now_is_peer_exist(peer->peer_addr)) return ESP_ERR_ESPNOW_EXIST;
+    if (espNowPeers.size() >= ESP_NOW_MAX_TOTAL_PEER_NUM) return ESP_ERR_ESPNOW_FULL;
+    espNowPeers.insert(toMac(peer->peer_addr));
+    return ESP_OK;
+}
+
+esp_err_t esp_now_del_peer(const uint8_t* address)
+{
+    if (!espNowInitialized) return ESP_ERR_ESPNOW_NOT_INIT;
+    return espNowPeers.erase(toMac(address)) != 0 ? ESP_OK : ESP_ERR_ESPNOW_NOT_FOUND;
+}
+
+bool esp_now_is_peer_exist(const uint8_t* address)
+{
+    return espNowPeers.count(toMac(address)) != 0;
+}
+
+esp_err_t esp_now_send(const uint8_t* address, const uint8_t* data, const size_t len)
+{
+    if (!espNowInitialized) return ESP_ERR_ESPNOW_NOT_INIT;
+    if (data == nullptr || len == 0 || len > ESP_NOW_MAX_DATA_LEN) return ESP_ERR_ESPNOW_ARG;
+    if (address != nullptr && !esp_now_is_peer_exist(address)) return ESP_ERR_ESPNOW_NOT_FOUND;
+    if (espNowSendHook) espNowSendHook(address, data, len);
+    if (espNowSendCallback) espNowSendCallback(address, ESP_NOW_SEND_SUCCESS);
+    return ESP_OK;
+}
+
+void NativeHal::injectEspNowFrame(const uint8_t* mac, const uint8_t* data, const int len)
+{
+    if (espNowReceiveCallback) espNowReceiveCallback(mac, data, len);
+}
+
+void NativeHal::setEspNowSendHook(void (*hook)(const uint8_t*, const uint8_t*, size_t))
+{
+    espNowSendHook = hook;
+}
+
+// --------------------  Knob --------------------
+
+namespace
+{
+    struct NativeKnob
+    {
+        std::array<std::pair<knob_cb_t, void*>, KNOB_EVENT_MAX> callbacks = {};
+    };
+}
+
+knob_handle_t iot_knob_create(const knob_config_t*)
+{
+    return new NativeKnob();
+}
+
+int iot_knob_delete(const knob_handle_t handle)
+{
+    delete static_cast<NativeKnob*>(handle);
+    return ESP_OK;
+}
+
+int iot_knob_register_cb(const knob_handle_t handle, const knob_event_t event, const knob_cb_t callback, void* data)
+{
+    if (event >= KNOB_EVENT_MAX) return ESP_FAIL;
+    static_cast<NativeKnob*>(handle)->callbacks[event] = {callback, data};
+    return ESP_OK;
+}
+
+void NativeHal::turnKnob(const knob_handle_t handle, const knob_event_t event)
+{
+    if (event >= KNOB_EVENT_MAX) return;
+    if (const auto& [callback, data] = static_cast<NativeKnob*>(handle)->callbacks[event]; callback)
+        callback(handle, data);
+}
@@ -1,17 +1,24 @@
 #include <Arduino.h>
 #include <LittleFS.h>
+#include <esp_now.h>
 
 #include "wifi_manager.hh"
 #include "device_manager.hh"
 #include "esp_now_handler_remote.hh"
+#include "event_loop.hh"
+#include "loop_profiler_handler.hh"
 #include "push_button.hh"
 #include "ota_handler.hh"
 #include "remote_hardware.hh"
 #include "state_rest_handler.hh"
+#include "state_events_handler.hh"
 #include "rotary_encoder_manager.hh"
 #include "websocket_handler.hh"
 
 void beginWebServer();
+EventLoop::Deadline handleComponents(unsigned long now);
+void onDataSent(const uint8_t* mac, esp_now_send_status_t status);
+void onDataReceived(const uint8_t* mac, const uint8_t* incomingData, int len);
 
 static constexpr auto LOG_TAG = "Remote";
 
@@ -55,16 +62,28 @@ StateRestHandler stateRestHandler({
     &wifiManager,
     &bleManager,
     &otaHandler,
-    &remoteEspNowHandler
+    &remoteEspNowHandler,
+    &webSocketHandler
 });
 
+StateEventsHandler stateEventsHandler(stateRestHandler);
+
+#if LOOP_PROFILER
+LoopProfiler::RestHandler loopProfilerHandler;
+#endif
+
 void setup()
 {
     ESP_LOGI(LOG_TAG, "Starting controller");
+    EventLoop::begin(true);
     rotaryEncoderManager.begin();
+    boardButton.begin();
     rotaryEncoderButton.begin();
     wifiManager.begin();
     deviceManager.begin();
+    esp_now_init();
+    esp_now_register_send_cb(onDataSent);
+    esp_now_register_recv_cb(onDataReceived);
     remoteEspNowHandler.begin();
 
     wifiManager.setGotIpCallback(beginWebServer);
@@ -72,8 +91,8 @@ void setup()
     boardButton.setLongPressCallback([] { bleManager.start(); });
     boardButton.setShortPressCallback([] { remoteEspNowHandler.send(EspNow::Message::Type::ToggleAll); });
 
-    rotaryEncoderManager.onTurnLeft([] { remoteEspNowHandler.send(EspNow::Message::Type::DecreaseBrightness); });
-    rotaryEncoderManager.onTurnRight([] { remoteEspNowHandler.send(EspNow::Message::Type::IncreaseBrightness); });
+    rotaryEncoderManager.onTurnLeft([] { remoteEspNowHandler.stepBrightness(-1); });
+    rotaryEncoderManager.onTurnRight([] { remoteEspNowHandler.stepBrightness(1); });
 
     rotaryEncoderButton.setLongPressCallback([] { bleManager.start(); });
     rotaryEncoderButton.setShortPressCallback([] { remoteEspNowHandler.send(EspNow::Message::Type::ToggleAll); });
@@ -88,14 +107,33 @@ void setup()
 
 void loop()
 {
-    const auto now = millis();
-
-    bleManager.handle(now);
-    boardButton.handle(now);
-    deviceManager.handle(now);
-    webSocketHandler.handle(now);
-    rotaryEncoderButton.handle(now);
-    delay(1);
+    EventLoop::wait(handleComponents(millis()));
+}
+
+/** One busy pass of the loop; returns when the components next need it */
+EventLoop::Deadline handleComponents(const unsigned long now)
+{
+    LOOP_PROFILE_SCOPE("loop");
+
+    LOOP_PROFILE("ble", bleManager.handle(now));
+    LOOP_PROFILE("button", boardButton.handle(now));
+    LOOP_PROFILE("device", deviceManager.handle(now));
+    LOOP_PROFILE("espNow", remoteEspNowHandler.handle(now));
+    LOOP_PROFILE("webSocket", webSocketHandler.handle(now));
+    LOOP_PROFILE("stateRest", stateRestHandler.handle(now));
+    LOOP_PROFILE("stateEvents", stateEventsHandler.handle(now));
+    LOOP_PROFILE("encoderButton", rotaryEncoderButton.handle(now));
+
+    EventLoop::Deadline next(now);
+    bleManager.schedule(next);
+    boardButton.schedule(next);
+    deviceManager.schedule(next);
+    remoteEspNowHandler.schedule(next);
+    webSocketHandler.schedule(next);
+    stateRestHandler.schedule(next);
+    stateEventsHandler.schedule(next);
+    rotaryEncoderButton.schedule(next);
+    return next;
 }
 
 
@@ -107,8 +145,22 @@ void beginWebServer()
             &webSocketHandler,
             &otaHandler,
             &stateRestHandler,
+            &stateEventsHandler,
             &bleManager,
-            &deviceManager
+            &deviceManager,
+#if LOOP_PROFILER
+            &loopProfilerHandler,
+#endif
         }
     );
 }
+
+void onDataSent(const uint8_t* mac, const esp_now_send_status_t status)
+{
+    remoteEspNowHandler.onDataSent(mac, status);
+}
+
+void onDataReceived(const uint8_t* mac, const uint8_t* incomingData, const int len)
+{
+    remoteEspNowHandler.onDataReceived(mac, incomingData, len);
+}